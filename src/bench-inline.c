@@ -0,0 +1,131 @@
+
+/*
+ * Compares a call-heavy traversal through the exported reader functions
+ * against the same traversal through the inline variants. Built once
+ * against the shared library and once against the static one, which is
+ * compiled as a single translation unit with LTO if the 'single-tu'
+ * option is set.
+ */
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "c-json.h"
+#include "c-json-inline.h"
+
+#define N_RECORDS (256 * 1024)
+#define N_ROUNDS 8
+
+static uint64_t now_nsec(void) {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void report(const char *name, uint64_t nsec, size_t n_bytes) {
+        printf("%-28s %8.1f ms/round %10.1f MB/s\n",
+               name,
+               (double)nsec / N_ROUNDS / 1000000,
+               (double)n_bytes * N_ROUNDS * 1000 / nsec);
+}
+
+/* mostly tiny values, so the cost is dominated by calls per token */
+static char * build_document(size_t *n_documentp) {
+        _c_cleanup_(c_fclosep) FILE *stream = NULL;
+        char *document = NULL;
+        size_t n_document;
+
+        stream = open_memstream(&document, &n_document);
+        assert(stream);
+
+        fputc('[', stream);
+        for (size_t i = 0; i < N_RECORDS; i += 1)
+                fprintf(stream, "%s[%zu,true,null,[false,{}],{\"k\":[]}]", i ? "," : "", i % 10);
+        fputc(']', stream);
+
+        stream = c_fclose(stream);
+        *n_documentp = n_document;
+        return document;
+}
+
+static int read_value(CJsonReader *reader) {
+        switch (c_json_reader_peek(reader)) {
+        case C_JSON_TYPE_NULL:
+                return c_json_reader_read_null(reader);
+        case C_JSON_TYPE_BOOLEAN:
+                return c_json_reader_read_bool(reader, NULL);
+        case C_JSON_TYPE_NUMBER:
+                return c_json_reader_read_number(reader, NULL, NULL);
+        case C_JSON_TYPE_STRING:
+                return c_json_reader_read_string(reader, NULL);
+        case C_JSON_TYPE_ARRAY:
+                c_json_reader_enter_array(reader);
+                while (c_json_reader_more(reader))
+                        read_value(reader);
+                return c_json_reader_exit_array(reader);
+        case C_JSON_TYPE_OBJECT:
+                c_json_reader_enter_object(reader);
+                while (c_json_reader_more(reader))
+                        read_value(reader);
+                return c_json_reader_exit_object(reader);
+        default:
+                return C_JSON_E_INVALID_JSON;
+        }
+}
+
+static int read_value_inline(CJsonReader *reader) {
+        switch (c_json_reader_peek_inline(reader)) {
+        case C_JSON_TYPE_NULL:
+                return c_json_reader_read_null_inline(reader);
+        case C_JSON_TYPE_BOOLEAN:
+                return c_json_reader_read_bool_inline(reader, NULL);
+        case C_JSON_TYPE_NUMBER:
+                return c_json_reader_read_number(reader, NULL, NULL);
+        case C_JSON_TYPE_STRING:
+                return c_json_reader_read_string(reader, NULL);
+        case C_JSON_TYPE_ARRAY:
+                c_json_reader_enter_array_inline(reader);
+                while (c_json_reader_more_inline(reader))
+                        read_value_inline(reader);
+                return c_json_reader_exit_array_inline(reader);
+        case C_JSON_TYPE_OBJECT:
+                c_json_reader_enter_object_inline(reader);
+                while (c_json_reader_more_inline(reader))
+                        read_value_inline(reader);
+                return c_json_reader_exit_object_inline(reader);
+        default:
+                return C_JSON_E_INVALID_JSON;
+        }
+}
+
+int main(int argc, char **argv) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *document = NULL;
+        size_t n_document;
+        uint64_t start;
+
+        document = build_document(&n_document);
+        assert(!c_json_reader_new(&reader, 256));
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                c_json_reader_begin_read(reader, document);
+                assert(!read_value(reader));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_reader_*()", now_nsec() - start, n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                c_json_reader_begin_read(reader, document);
+                assert(!read_value_inline(reader));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_reader_*_inline()", now_nsec() - start, n_document);
+
+        return 0;
+}
@@ -0,0 +1,93 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "c-json.h"
+
+#define N_VALUES (1024 * 1024)
+
+static uint64_t random_next(uint64_t *state) {
+        *state ^= *state >> 12;
+        *state ^= *state << 25;
+        *state ^= *state >> 27;
+        return *state * UINT64_C(2685821657736338717);
+}
+
+static uint64_t now_nsec(void) {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void report(const char *name, uint64_t nsec, size_t n_bytes) {
+        printf("%-28s %8.1f ns/value %10.1f MB/s\n",
+               name,
+               (double)nsec / N_VALUES,
+               (double)n_bytes * 1000 / nsec);
+}
+
+static void bench_doubles(const double *values) {
+        char buffer[C_JSON_NUMBER_MAX + 32];
+        size_t n_bytes = 0;
+        uint64_t start;
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_VALUES; i += 1)
+                n_bytes += c_json_format_double(buffer, values[i]);
+        report("c_json_format_double()", now_nsec() - start, n_bytes);
+
+        n_bytes = 0;
+        start = now_nsec();
+        for (size_t i = 0; i < N_VALUES; i += 1)
+                n_bytes += snprintf(buffer, sizeof(buffer), "%.17g", values[i]);
+        report("snprintf(\"%.17g\")", now_nsec() - start, n_bytes);
+}
+
+static void bench_integers(const int64_t *values) {
+        char buffer[C_JSON_NUMBER_MAX];
+        size_t n_bytes = 0;
+        uint64_t start;
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_VALUES; i += 1)
+                n_bytes += c_json_format_int64(buffer, values[i]);
+        report("c_json_format_int64()", now_nsec() - start, n_bytes);
+
+        n_bytes = 0;
+        start = now_nsec();
+        for (size_t i = 0; i < N_VALUES; i += 1)
+                n_bytes += snprintf(buffer, sizeof(buffer), "%" PRId64, values[i]);
+        report("snprintf(\"%\" PRId64)", now_nsec() - start, n_bytes);
+}
+
+int main(int argc, char **argv) {
+        _c_cleanup_(c_freep) double *doubles = NULL;
+        _c_cleanup_(c_freep) int64_t *integers = NULL;
+        uint64_t state = 0x2545f4914f6cdd1d;
+
+        doubles = malloc(N_VALUES * sizeof(*doubles));
+        integers = malloc(N_VALUES * sizeof(*integers));
+        assert(doubles && integers);
+
+        for (size_t i = 0; i < N_VALUES; i += 1) {
+                uint64_t bits = random_next(&state);
+
+                memcpy(&doubles[i], &bits, sizeof(bits));
+                if (!isfinite(doubles[i]))
+                        doubles[i] = (double)bits;
+
+                /* mix of small and large magnitudes */
+                integers[i] = (int64_t)random_next(&state) >> (random_next(&state) % 64);
+        }
+
+        bench_doubles(doubles);
+        bench_integers(integers);
+
+        return 0;
+}
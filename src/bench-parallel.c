@@ -0,0 +1,99 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "c-json.h"
+
+#define N_RECORDS (512 * 1024)
+
+static uint64_t now_nsec(void) {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static char * build_document(void) {
+        _c_cleanup_(c_fclosep) FILE *stream = NULL;
+        char *document = NULL;
+        size_t n_document;
+
+        stream = open_memstream(&document, &n_document);
+        assert(stream);
+
+        fputs("[\n", stream);
+        for (size_t i = 0; i < N_RECORDS; i += 1) {
+                fprintf(stream,
+                        "  { \"id\": %zu, \"name\": \"user-%zu\", \"score\": %zu.%02zu, "
+                        "\"tags\": [ \"a\", \"b\\n\", \"\\u00e4\" ], \"parent\": null }%s\n",
+                        i, i, i % 1000, i % 100,
+                        i + 1 < N_RECORDS ? "," : "");
+        }
+        fputs("]\n", stream);
+
+        stream = c_fclose(stream);
+        return document;
+}
+
+static int read_value(CJsonReader *reader) {
+        switch (c_json_reader_peek(reader)) {
+        case C_JSON_TYPE_STRING: {
+                _c_cleanup_(c_freep) char *string = NULL;
+
+                return c_json_reader_read_string(reader, &string);
+        }
+        case C_JSON_TYPE_ARRAY:
+                c_json_reader_enter_array(reader);
+                while (c_json_reader_more(reader))
+                        read_value(reader);
+                return c_json_reader_exit_array(reader);
+        case C_JSON_TYPE_OBJECT:
+                c_json_reader_enter_object(reader);
+                while (c_json_reader_more(reader))
+                        read_value(reader);
+                return c_json_reader_exit_object(reader);
+        default:
+                return c_json_reader_skip(reader);
+        }
+}
+
+static int element_fn(void *userdata, CJsonReader *reader, size_t index, void **resultp) {
+        return read_value(reader);
+}
+
+int main(int argc, char **argv) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *document = NULL;
+        long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        uint64_t start, nsec;
+
+        document = build_document();
+        assert(!c_json_reader_new(&reader, 256));
+
+        start = now_nsec();
+        c_json_reader_begin_read(reader, document);
+        assert(!read_value(reader));
+        assert(!c_json_reader_end_read(reader));
+        nsec = now_nsec() - start;
+        printf("%-28s %8.1f ms %10.1f MB/s\n", "single reader",
+               (double)nsec / 1000000, (double)strlen(document) * 1000 / nsec);
+
+        for (size_t n_threads = 1; n_threads <= (size_t)c_max(n_cpus, 1L); n_threads *= 2) {
+                char name[64];
+
+                start = now_nsec();
+                assert(!c_json_read_array_parallel(document, 256, n_threads, 0, element_fn, NULL, NULL));
+                nsec = now_nsec() - start;
+
+                snprintf(name, sizeof(name), "parallel, %zu threads", n_threads);
+                printf("%-28s %8.1f ms %10.1f MB/s\n", name,
+                       (double)nsec / 1000000, (double)strlen(document) * 1000 / nsec);
+        }
+
+        return 0;
+}
@@ -0,0 +1,608 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "c-json.h"
+
+#define N_RECORDS (64 * 1024)
+#define N_ROUNDS 8
+
+static uint64_t now_nsec(void) {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void report(const char *name, uint64_t nsec, size_t n_bytes) {
+        printf("%-28s %8.1f ms/round %10.1f MB/s\n",
+               name,
+               (double)nsec / N_ROUNDS / 1000000,
+               (double)n_bytes * N_ROUNDS * 1000 / nsec);
+}
+
+/* an array of records with the usual mix of keys, strings and numbers */
+static char * build_document(size_t *n_documentp) {
+        _c_cleanup_(c_fclosep) FILE *stream = NULL;
+        char *document = NULL;
+        size_t n_document;
+
+        stream = open_memstream(&document, &n_document);
+        assert(stream);
+
+        fputs("[\n", stream);
+        for (size_t i = 0; i < N_RECORDS; i += 1) {
+                fprintf(stream,
+                        "  { \"id\": %zu, \"name\": \"user-%zu\", \"score\": %zu.%02zu, "
+                        "\"active\": %s, \"tags\": [ \"a\", \"b\\n\", \"\\u00e4\" ], "
+                        "\"note\": \"gr\xc3\xbc\xc3\x9f \xe2\x82\xac\", \"parent\": null }%s\n",
+                        i, i, i % 1000, i % 100,
+                        i % 2 ? "true" : "false",
+                        i + 1 < N_RECORDS ? "," : "");
+        }
+        fputs("]\n", stream);
+
+        stream = c_fclose(stream);
+        *n_documentp = n_document;
+        return document;
+}
+
+/* an array of strings in mixed scripts, mostly multi-byte sequences */
+static char * build_text_document(size_t *n_documentp) {
+        _c_cleanup_(c_fclosep) FILE *stream = NULL;
+        char *document = NULL;
+        size_t n_document;
+
+        stream = open_memstream(&document, &n_document);
+        assert(stream);
+
+        fputs("[\n", stream);
+        for (size_t i = 0; i < N_RECORDS; i += 1) {
+                fprintf(stream,
+                        "  \"\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e\xe3\x81\xae\xe3\x83\x86\xe3\x82\xad\xe3\x82\xb9\xe3\x83\x88 %zu "
+                        "\xf0\x9f\x98\x80\xf0\x9f\x8e\x89 \xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82\"%s\n",
+                        i, i + 1 < N_RECORDS ? "," : "");
+        }
+        fputs("]\n", stream);
+
+        stream = c_fclose(stream);
+        *n_documentp = n_document;
+        return document;
+}
+
+/* an array of JSON-in-JSON strings and \\u-escaped text */
+static char * build_escaped_document(size_t *n_documentp) {
+        _c_cleanup_(c_fclosep) FILE *stream = NULL;
+        char *document = NULL;
+        size_t n_document;
+
+        stream = open_memstream(&document, &n_document);
+        assert(stream);
+
+        fputs("[\n", stream);
+        for (size_t i = 0; i < N_RECORDS; i += 1) {
+                fprintf(stream,
+                        "  \"{\\\"id\\\":%zu,\\\"path\\\":\\\"C:\\\\\\\\tmp\\\\\\\\x\\\",\\\"text\\\":\\\"a\\\\nb\\\\tc\\\"}\", "
+                        "\"gr\\u00fc\\u00df \\u65e5\\u672c \\ud83d\\ude00 \\u20ac%zu\"%s\n",
+                        i, i, i + 1 < N_RECORDS ? "," : "");
+        }
+        fputs("]\n", stream);
+
+        stream = c_fclose(stream);
+        *n_documentp = n_document;
+        return document;
+}
+
+static int read_value(CJsonReader *reader) {
+        switch (c_json_reader_peek(reader)) {
+        case C_JSON_TYPE_NULL:
+                return c_json_reader_read_null(reader);
+        case C_JSON_TYPE_BOOLEAN:
+                return c_json_reader_read_bool(reader, NULL);
+        case C_JSON_TYPE_NUMBER:
+                return c_json_reader_read_number(reader, NULL, NULL);
+        case C_JSON_TYPE_STRING: {
+                _c_cleanup_(c_freep) char *string = NULL;
+
+                return c_json_reader_read_string(reader, &string);
+        }
+        case C_JSON_TYPE_ARRAY:
+                c_json_reader_enter_array(reader);
+                while (c_json_reader_more(reader))
+                        read_value(reader);
+                return c_json_reader_exit_array(reader);
+        case C_JSON_TYPE_OBJECT:
+                c_json_reader_enter_object(reader);
+                while (c_json_reader_more(reader))
+                        read_value(reader);
+                return c_json_reader_exit_object(reader);
+        default:
+                return C_JSON_E_INVALID_JSON;
+        }
+}
+
+static int read_in_place(CJsonReader *reader) {
+        char *string;
+
+        switch (c_json_reader_peek(reader)) {
+        case C_JSON_TYPE_STRING:
+                return c_json_reader_read_string_in_place(reader, &string);
+        case C_JSON_TYPE_ARRAY:
+                c_json_reader_enter_array(reader);
+                while (c_json_reader_more(reader))
+                        read_in_place(reader);
+                return c_json_reader_exit_array(reader);
+        case C_JSON_TYPE_OBJECT:
+                c_json_reader_enter_object(reader);
+                while (c_json_reader_more(reader))
+                        read_in_place(reader);
+                return c_json_reader_exit_object(reader);
+        default:
+                return read_value(reader);
+        }
+}
+
+/* includes copying the input, which in-place decoding destroys */
+static void bench_in_place(CJsonReader *reader, const char *name, const char *document, size_t n_document) {
+        _c_cleanup_(c_freep) char *buffer = NULL;
+        uint64_t start;
+
+        buffer = malloc(n_document + 1);
+        assert(buffer);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                memcpy(buffer, document, n_document + 1);
+                c_json_reader_begin_read_mutable(reader, buffer);
+                assert(!read_in_place(reader));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report(name, now_nsec() - start, n_document);
+}
+
+static int count_value(void *userdata) {
+        ++*(size_t *)userdata;
+        return 0;
+}
+
+static int count_string(void *userdata, const CJsonString *string) {
+        ++*(size_t *)userdata;
+        return 0;
+}
+
+static int count_number(void *userdata, const char *number, size_t n_number) {
+        ++*(size_t *)userdata;
+        return 0;
+}
+
+static int count_bool(void *userdata, bool b) {
+        ++*(size_t *)userdata;
+        return 0;
+}
+
+static const CJsonHandler count_handler = {
+        .key = count_string,
+        .string = count_string,
+        .number = count_number,
+        .boolean = count_bool,
+        .null = count_value,
+};
+
+/* parses in slices of 64 KiB, as an event loop would */
+static void bench_budget(CJsonReader *reader, const char *document, size_t n_document) {
+        uint64_t start, slice, max_slice = 0;
+        size_t n_slices = 0;
+        int r;
+
+        c_json_reader_set_budget(reader, 64 * 1024);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                size_t n_values = 0;
+
+                c_json_reader_begin_read(reader, document);
+                do {
+                        slice = now_nsec();
+                        r = c_json_reader_parse(reader, &count_handler, &n_values);
+                        slice = now_nsec() - slice;
+
+                        max_slice = slice > max_slice ? slice : max_slice;
+                        n_slices += 1;
+                } while (r == C_JSON_E_YIELD);
+                assert(!r);
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_reader_parse() 64K", now_nsec() - start, n_document);
+        printf("%-28s %8zu slices/round %7.1f us/slice max\n",
+               "", n_slices / N_ROUNDS, (double)max_slice / 1000);
+
+        c_json_reader_set_budget(reader, 0);
+}
+
+static int read_cached(CJsonCursor *cursor) {
+        switch (c_json_cursor_peek(cursor)) {
+        case C_JSON_TYPE_NULL:
+                return c_json_cursor_read_null(cursor);
+        case C_JSON_TYPE_BOOLEAN:
+                return c_json_cursor_read_bool(cursor, NULL);
+        case C_JSON_TYPE_NUMBER:
+                return c_json_cursor_read_number(cursor, NULL, NULL);
+        case C_JSON_TYPE_STRING:
+                return c_json_cursor_read_string_ref(cursor, NULL, NULL);
+        case C_JSON_TYPE_ARRAY:
+                c_json_cursor_enter_array(cursor);
+                while (c_json_cursor_more(cursor))
+                        read_cached(cursor);
+                return c_json_cursor_exit_array(cursor);
+        case C_JSON_TYPE_OBJECT:
+                c_json_cursor_enter_object(cursor);
+                while (c_json_cursor_more(cursor))
+                        read_cached(cursor);
+                return c_json_cursor_exit_object(cursor);
+        default:
+                return C_JSON_E_INVALID_JSON;
+        }
+}
+
+/* the document checked against a schema that constrains every member */
+static void bench_schema(const char *document, size_t n_document) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_json_schema_freep) CJsonSchema *schema = NULL;
+        uint64_t start;
+
+        assert(!c_json_reader_new(&reader, 256));
+        assert(!c_json_schema_new(&schema,
+                                  "{ \"type\": \"array\", \"items\": {"
+                                  "  \"type\": \"object\","
+                                  "  \"required\": [ \"id\", \"name\" ],"
+                                  "  \"additionalProperties\": false,"
+                                  "  \"properties\": {"
+                                  "    \"id\": { \"type\": \"integer\", \"minimum\": 0 },"
+                                  "    \"name\": { \"type\": \"string\", \"maxLength\": 64 },"
+                                  "    \"score\": { \"type\": \"number\", \"maximum\": 1000 },"
+                                  "    \"active\": { \"type\": \"boolean\" },"
+                                  "    \"tags\": { \"type\": \"array\", \"items\": { \"type\": \"string\" } },"
+                                  "    \"note\": { \"type\": \"string\" },"
+                                  "    \"parent\": { \"type\": [ \"integer\", \"null\" ] }"
+                                  "  }"
+                                  "} }"));
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                c_json_reader_begin_read(reader, document);
+                assert(!c_json_schema_check(schema, reader, NULL));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_schema_check()", now_nsec() - start, n_document);
+}
+
+/* the same document read from text and from its binary cache */
+static void bench_cache(const char *document, size_t n_document) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_json_cursor_freep) CJsonCursor *cursor = NULL;
+        _c_cleanup_(c_freep) char *data = NULL;
+        size_t n_data;
+        uint64_t start;
+
+        assert(!c_json_reader_new(&reader, 256));
+        assert(!c_json_cursor_new(&cursor, 256));
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                data = c_free(data);
+                c_json_reader_begin_read(reader, document);
+                assert(!c_json_cache_encode(reader, &data, &n_data));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_cache_encode()", now_nsec() - start, n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                c_json_cursor_begin_read(cursor, data, n_data);
+                assert(!read_cached(cursor));
+                assert(!c_json_cursor_end_read(cursor));
+        }
+        report("c_json_cursor_read_*()", now_nsec() - start, n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                c_json_cursor_begin_read(cursor, data, n_data);
+                assert(!c_json_cursor_skip(cursor));
+                assert(!c_json_cursor_end_read(cursor));
+        }
+        report("c_json_cursor_skip()", now_nsec() - start, n_document);
+}
+
+static int read_message(void *userdata, CJsonReader *reader, size_t index) {
+        return read_value(reader);
+}
+
+/* many tiny independent messages, one reader cycle each versus one batch */
+static void bench_messages(void) {
+        _c_cleanup_(c_freep) CJsonMessage *messages = NULL;
+        _c_cleanup_(c_freep) char *data = NULL, *copy = NULL;
+        _c_cleanup_(c_freep) int *results = NULL;
+        size_t n_data = 0, n_message;
+        char message[128];
+        uint64_t start;
+
+        messages = calloc(N_RECORDS, sizeof(*messages));
+        results = calloc(N_RECORDS, sizeof(*results));
+        data = malloc(N_RECORDS * sizeof(message));
+        copy = malloc(sizeof(message));
+        assert(messages && results && data && copy);
+
+        for (size_t i = 0; i < N_RECORDS; i += 1) {
+                n_message = snprintf(message, sizeof(message),
+                                     "{\"jsonrpc\":\"2.0\",\"method\":\"ping\",\"id\":%zu}", i);
+                memcpy(data + n_data, message, n_message);
+                messages[i] = (CJsonMessage){ .data = data + n_data, .n_data = n_message };
+                n_data += n_message;
+        }
+
+        start = now_nsec();
+        for (size_t round = 0; round < N_ROUNDS; round += 1) {
+                for (size_t i = 0; i < N_RECORDS; i += 1) {
+                        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+
+                        memcpy(copy, messages[i].data, messages[i].n_data);
+                        copy[messages[i].n_data] = '\0';
+
+                        assert(!c_json_reader_new(&reader, 256));
+                        c_json_reader_begin_read(reader, copy);
+                        assert(!read_value(reader));
+                        assert(!c_json_reader_end_read(reader));
+                }
+        }
+        report("messages, one by one", now_nsec() - start, n_data);
+
+        start = now_nsec();
+        for (size_t round = 0; round < N_ROUNDS; round += 1) {
+                _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+
+                assert(!c_json_reader_new(&reader, 256));
+                assert(!c_json_reader_read_batch(reader, messages, N_RECORDS, read_message, NULL, results));
+        }
+        report("messages, batched", now_nsec() - start, n_data);
+
+        start = now_nsec();
+        for (size_t round = 0; round < N_ROUNDS; round += 1) {
+                _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+
+                assert(!c_json_reader_new(&reader, 256));
+                assert(!c_json_reader_read_batch(reader, messages, N_RECORDS, NULL, NULL, results));
+        }
+        report("messages, batch validation", now_nsec() - start, n_data);
+}
+
+static void write_strings(CJsonWriter *writer, int fd, const char *string, size_t n_string, bool ref) {
+        c_json_writer_begin_write(writer, fd);
+        assert(!c_json_writer_enter_array(writer));
+        for (size_t i = 0; i < 64; i += 1) {
+                if (ref)
+                        assert(!c_json_writer_write_string_ref(writer, string, n_string));
+                else
+                        assert(!c_json_writer_write_string(writer, string, n_string));
+        }
+        assert(!c_json_writer_exit_array(writer));
+        assert(!c_json_writer_end_write(writer));
+}
+
+static void bench_writer(void) {
+        _c_cleanup_(c_json_writer_freep) CJsonWriter *writer = NULL, *async = NULL;
+        _c_cleanup_(c_freep) char *string = NULL;
+        size_t n_string = 1024 * 1024;
+        uint64_t start;
+        int fd;
+
+        string = malloc(n_string);
+        assert(string);
+        memset(string, 'x', n_string);
+
+        fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        assert(fd >= 0);
+
+        assert(!c_json_writer_new(&writer, 256, 0));
+        assert(!c_json_writer_new(&async, 256, C_JSON_WRITER_ASYNC));
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1)
+                write_strings(writer, fd, string, n_string, false);
+        report("c_json_writer_*() copied", now_nsec() - start, 64 * n_string);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1)
+                write_strings(writer, fd, string, n_string, true);
+        report("c_json_writer_*() referenced", now_nsec() - start, 64 * n_string);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1)
+                write_strings(async, fd, string, n_string, false);
+        report("c_json_writer_*() async", now_nsec() - start, 64 * n_string);
+
+        close(fd);
+}
+
+static void bench_document(void) {
+        _c_cleanup_(c_json_document_freep) CJsonDocument *document = NULL;
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *input = NULL;
+        _c_cleanup_(c_fclosep) FILE *stream = NULL;
+        size_t n_input, n_keys = 32 * 1024, n_lookups = 1024, value;
+        char key[32];
+        uint64_t start;
+
+        stream = open_memstream(&input, &n_input);
+        assert(stream);
+        fputc('{', stream);
+        for (size_t i = 0; i < n_keys; i += 1)
+                fprintf(stream, "%s\"id-%zu\": %zu", i ? "," : "", i, i);
+        fputc('}', stream);
+        stream = c_fclose(stream);
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        start = now_nsec();
+        for (size_t i = 0; i < n_lookups; i += 1) {
+                CJsonString name;
+
+                sprintf(key, "id-%zu", i * 31 % n_keys);
+                c_json_reader_begin_read(reader, input);
+                assert(!c_json_reader_enter_object(reader));
+                for (;;) {
+                        assert(!c_json_reader_read_string_lazy(reader, &name));
+                        if (!c_json_string_compare(&name, key))
+                                break;
+                        assert(!c_json_reader_skip(reader));
+                }
+                c_json_reader_end_read(reader);
+        }
+        printf("%-28s %8.2f us/lookup\n", "lookups, linear", (double)(now_nsec() - start) / n_lookups / 1000);
+
+        start = now_nsec();
+        assert(!c_json_document_new(&document, input, 256));
+        for (size_t i = 0; i < n_lookups; i += 1) {
+                sprintf(key, "id-%zu", i * 31 % n_keys);
+                assert(!c_json_document_lookup(document, c_json_document_root(document), key, &value));
+                assert(value != C_JSON_DOCUMENT_NONE);
+        }
+        printf("%-28s %8.2f us/lookup\n", "lookups, document", (double)(now_nsec() - start) / n_lookups / 1000);
+}
+
+int main(int argc, char **argv) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *document = NULL;
+        size_t n_document;
+        uint64_t start;
+
+        document = build_document(&n_document);
+        assert(!c_json_reader_new(&reader, 256));
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1)
+                assert(!c_json_validate(document, n_document, 256, NULL));
+        report("c_json_validate()", now_nsec() - start, n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                c_json_reader_begin_read(reader, document);
+                assert(!c_json_reader_skip(reader));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_reader_skip()", now_nsec() - start, n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                c_json_reader_begin_read(reader, document);
+                assert(!read_value(reader));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_reader_read_*()", now_nsec() - start, n_document);
+
+        bench_in_place(reader, "read_string_in_place()", document, n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                size_t n_values = 0;
+
+                c_json_reader_begin_read(reader, document);
+                assert(!c_json_reader_parse(reader, &count_handler, &n_values));
+                assert(!c_json_reader_end_read(reader));
+                assert(n_values > 0);
+        }
+        report("c_json_reader_parse()", now_nsec() - start, n_document);
+
+        bench_budget(reader, document, n_document);
+
+        c_json_reader_set_flags(reader, C_JSON_READER_TRUSTED);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                c_json_reader_begin_read(reader, document);
+                assert(!c_json_reader_skip(reader));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_reader_skip() trust", now_nsec() - start, n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                c_json_reader_begin_read(reader, document);
+                assert(!read_value(reader));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_reader_read_*() trust", now_nsec() - start, n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                size_t n_values = 0;
+
+                c_json_reader_begin_read(reader, document);
+                assert(!c_json_reader_parse(reader, &count_handler, &n_values));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_reader_parse() trust", now_nsec() - start, n_document);
+
+        c_json_reader_set_flags(reader, 0);
+
+        bench_schema(document, n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                uint8_t digest[C_JSON_HASH_SIZE];
+
+                c_json_reader_begin_read(reader, document);
+                assert(!c_json_canonical_hash(reader, digest));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_canonical_hash()", now_nsec() - start, n_document);
+
+        bench_cache(document, n_document);
+
+        document = c_free(document);
+        document = build_text_document(&n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1)
+                assert(!c_json_validate(document, n_document, 256, NULL));
+        report("c_json_validate() text", now_nsec() - start, n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                c_json_reader_begin_read(reader, document);
+                assert(!read_value(reader));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_reader_read_*() text", now_nsec() - start, n_document);
+
+        bench_in_place(reader, "read_string_in_place() text", document, n_document);
+
+        document = c_free(document);
+        document = build_escaped_document(&n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1)
+                assert(!c_json_validate(document, n_document, 256, NULL));
+        report("c_json_validate() escaped", now_nsec() - start, n_document);
+
+        start = now_nsec();
+        for (size_t i = 0; i < N_ROUNDS; i += 1) {
+                c_json_reader_begin_read(reader, document);
+                assert(!read_value(reader));
+                assert(!c_json_reader_end_read(reader));
+        }
+        report("c_json_reader_read_*() esc", now_nsec() - start, n_document);
+
+        bench_in_place(reader, "read_string_in_place() esc", document, n_document);
+
+        bench_messages();
+        bench_writer();
+        bench_document();
+
+        return 0;
+}
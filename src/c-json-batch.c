@@ -0,0 +1,119 @@
+
+#include <c-stdaux.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+/* messages up to this size are copied to the stack */
+#define C_JSON_BATCH_STACK_MAX 4096
+
+static int c_json_batch_skip(void *userdata, CJsonReader *reader, size_t index) {
+        return c_json_reader_skip(reader);
+}
+
+/* c_json_validate() only knows about the nesting depth */
+static bool c_json_batch_is_limited(CJsonReader *reader) {
+        return reader->limits.max_input < SIZE_MAX ||
+               reader->limits.max_string < SIZE_MAX ||
+               reader->limits.max_strings < SIZE_MAX ||
+               reader->limits.max_values < SIZE_MAX ||
+               reader->limits.max_number < SIZE_MAX ||
+               reader->limits.max_members < SIZE_MAX;
+}
+
+/**
+ * c_json_reader_read_batch() - read many independent messages in one call
+ * @reader              reader to use for all messages
+ * @messages            array of messages to read
+ * @n_messages          number of messages in @messages
+ * @fn                  callback run for each message, or NULL to only validate
+ * @userdata            user pointer passed to @fn
+ * @results             array of @n_messages result codes
+ *
+ * Reads every message in @messages, which do not need to be 0-terminated.
+ * For each message, @fn is called with @reader positioned at its start and
+ * must read exactly one value. Reading the message is then finished like
+ * with c_json_reader_end_read(), and the result is stored in the matching
+ * entry of @results: 0 on success, the return value of @fn if it failed,
+ * or the error of the reader otherwise.
+ *
+ * If @fn is NULL, messages are only validated, with c_json_validate() if
+ * the nesting depth of @reader allows for it and no limits are set.
+ *
+ * Messages are independent of each other: a malformed message does not
+ * stop the batch. Only fatal errors do, in which case the results of the
+ * remaining messages are left untouched. Setup is shared between all
+ * messages: a single scratch buffer is used to 0-terminate them, and no
+ * memory is allocated per message.
+ *
+ * @reader must not be in use, that is, c_json_reader_begin_read() must not
+ * have been called without a matching c_json_reader_end_read().
+ *
+ * Return: <0 on fatal error
+ *         0 on success, in which case @results holds the outcome of each message
+ */
+_c_public_ int c_json_reader_read_batch(CJsonReader *reader,
+                                       const CJsonMessage *messages,
+                                       size_t n_messages,
+                                       CJsonMessageFn fn,
+                                       void *userdata,
+                                       int *results) {
+        _c_cleanup_(c_freep) char *heap = NULL;
+        char stack[C_JSON_BATCH_STACK_MAX];
+        char *buffer = stack;
+        size_t n_max = 0;
+        int r;
+
+        if (!fn) {
+                if (reader->n_states <= C_JSON_VALIDATE_DEPTH_MAX && !c_json_batch_is_limited(reader)) {
+                        for (size_t i = 0; i < n_messages; i += 1) {
+                                r = c_json_validate(messages[i].data, messages[i].n_data, reader->n_states, NULL);
+                                if (r < 0)
+                                        return r;
+
+                                results[i] = r;
+                        }
+
+                        return 0;
+                }
+
+                fn = c_json_batch_skip;
+        }
+
+        for (size_t i = 0; i < n_messages; i += 1)
+                n_max = c_max(n_max, messages[i].n_data);
+
+        if (n_max >= sizeof(stack)) {
+                heap = malloc(n_max + 1);
+                if (!heap)
+                        return -ENOMEM;
+
+                buffer = heap;
+        }
+
+        for (size_t i = 0; i < n_messages; i += 1) {
+                int r_end;
+
+                memcpy(buffer, messages[i].data, messages[i].n_data);
+                buffer[messages[i].n_data] = '\0';
+
+                /* a 0-byte inside the message would end it early */
+                if (_c_unlikely_(memchr(buffer, '\0', messages[i].n_data))) {
+                        results[i] = C_JSON_E_INVALID_JSON;
+                        continue;
+                }
+
+                c_json_reader_begin_read(reader, buffer);
+                r = fn(userdata, reader, i);
+                r_end = c_json_reader_end_read(reader);
+
+                r = r ?: r_end;
+                if (r < 0)
+                        return r;
+
+                results[i] = r;
+        }
+
+        return 0;
+}
@@ -0,0 +1,775 @@
+
+#include <c-stdaux.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+/*
+ * Binary cache format
+ *
+ * A cache starts with the 8 byte magic C_JSON_CACHE_MAGIC, followed by
+ * exactly one encoded value. All integers are unaligned and in host byte
+ * order, since caches are meant to be local to a machine. Values start
+ * with a one byte tag:
+ *
+ *   'n', 't', 'f'      null, true and false, no payload
+ *
+ *   '"'                string: u32 length, the decoded UTF-8 bytes, and a
+ *                      0-terminator that is not included in the length
+ *
+ *   '0'                number: like a string, holding the number exactly
+ *                      as it was written in the JSON input
+ *
+ *   '[', '{'           container: u32 number of values, u64 number of
+ *                      bytes of the encoded values, and the values. The
+ *                      values of an object alternate between key strings
+ *                      and member values, and count twice per member.
+ */
+
+#define C_JSON_CACHE_MAGIC "CJSONBC1"
+#define C_JSON_CACHE_HEADER (1 + sizeof(uint32_t) + sizeof(uint64_t))
+
+typedef struct CJsonCacheEncoder CJsonCacheEncoder;
+typedef struct CJsonCursorLevel CJsonCursorLevel;
+
+struct CJsonCacheEncoder {
+        char *data;
+        size_t n_data;
+        size_t n_allocated;
+};
+
+struct CJsonCursorLevel {
+        char kind;
+        uint32_t n_remaining;
+        const char *end;
+};
+
+struct CJsonCursor {
+        const char *data;
+        const char *end;
+        const char *p;
+        int poison;
+
+        size_t n_levels;
+        size_t level;
+        CJsonCursorLevel levels[];
+};
+
+static int c_json_cache_reserve(CJsonCacheEncoder *encoder, size_t n) {
+        size_t n_allocated;
+        char *data;
+
+        if (encoder->n_data + n <= encoder->n_allocated)
+                return 0;
+
+        n_allocated = c_max(encoder->n_allocated * 2, encoder->n_data + n);
+        n_allocated = c_max(n_allocated, (size_t)4096);
+
+        data = realloc(encoder->data, n_allocated);
+        if (!data)
+                return -ENOMEM;
+
+        encoder->data = data;
+        encoder->n_allocated = n_allocated;
+
+        return 0;
+}
+
+static int c_json_cache_append(CJsonCacheEncoder *encoder, const void *p, size_t n) {
+        int r;
+
+        r = c_json_cache_reserve(encoder, n);
+        if (r)
+                return r;
+
+        memcpy(encoder->data + encoder->n_data, p, n);
+        encoder->n_data += n;
+
+        return 0;
+}
+
+static int c_json_cache_append_chunk(void *userdata, const char *chunk, size_t n_chunk) {
+        return c_json_cache_append(userdata, chunk, n_chunk);
+}
+
+static int c_json_cache_append_string(CJsonCacheEncoder *encoder, char tag, const char *string, size_t n_string) {
+        uint32_t n = n_string;
+        int r;
+
+        if (n_string > UINT32_MAX)
+                return -E2BIG;
+
+        r = c_json_cache_reserve(encoder, 1 + sizeof(n) + n_string + 1);
+        if (r)
+                return r;
+
+        encoder->data[encoder->n_data++] = tag;
+        memcpy(encoder->data + encoder->n_data, &n, sizeof(n));
+        encoder->n_data += sizeof(n);
+        memcpy(encoder->data + encoder->n_data, string, n_string);
+        encoder->n_data += n_string;
+        encoder->data[encoder->n_data++] = '\0';
+
+        return 0;
+}
+
+/*
+ * Encodes a string straight from the reader. The length is patched in
+ * once the string is complete, so it never exists as a separate copy.
+ */
+static int c_json_cache_encode_string(CJsonCacheEncoder *encoder, CJsonReader *reader) {
+        size_t start = encoder->n_data;
+        uint32_t n;
+        int r;
+
+        r = c_json_cache_append(encoder, "\"\0\0\0\0", 1 + sizeof(n));
+        if (r)
+                return r;
+
+        r = c_json_reader_read_string_chunked(reader, c_json_cache_append_chunk, encoder);
+        if (r)
+                return r;
+
+        if (encoder->n_data - start - 1 - sizeof(n) > UINT32_MAX)
+                return -E2BIG;
+
+        n = encoder->n_data - start - 1 - sizeof(n);
+        memcpy(encoder->data + start + 1, &n, sizeof(n));
+
+        return c_json_cache_append(encoder, "", 1);
+}
+
+/**
+ * c_json_cache_encode() - encode the next value of a reader into a binary cache
+ * @reader              reader to read the input from
+ * @datap               return location for the encoded cache
+ * @n_datap             return location for the size of the encoded cache
+ *
+ * Reads the next value from @reader and encodes it into the binary cache
+ * format, which can be read back with a CJsonCursor without parsing JSON
+ * text again. Strings are stored decoded and length-prefixed, numbers are
+ * stored as written in the input, and containers carry the number of
+ * values they hold and their encoded size, so they can be skipped at once.
+ *
+ * The encoding is not recursive. The returned buffer must be freed.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a reader function
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
+ */
+_c_public_ int c_json_cache_encode(CJsonReader *reader, char **datap, size_t *n_datap) {
+        _c_cleanup_(c_freep) size_t *starts = NULL;
+        _c_cleanup_(c_freep) uint32_t *counts = NULL;
+        CJsonCacheEncoder encoder = {};
+        size_t level = reader->level, depth = 0;
+        const char *number;
+        size_t n_number;
+        int r, type;
+        bool b;
+
+        starts = malloc((reader->n_states + 1) * sizeof(*starts));
+        counts = malloc((reader->n_states + 1) * sizeof(*counts));
+        if (!starts || !counts) {
+                r = -ENOMEM;
+                goto error;
+        }
+
+        r = c_json_cache_append(&encoder, C_JSON_CACHE_MAGIC, strlen(C_JSON_CACHE_MAGIC));
+        if (r)
+                goto error;
+
+        do {
+                if (depth > 0 && !c_json_reader_more(reader)) {
+                        char *header = encoder.data + starts[depth];
+                        uint64_t n_values = encoder.n_data - starts[depth] - C_JSON_CACHE_HEADER;
+
+                        memcpy(header + 1, &counts[depth], sizeof(counts[depth]));
+                        memcpy(header + 1 + sizeof(counts[depth]), &n_values, sizeof(n_values));
+
+                        if (*header == '[')
+                                r = c_json_reader_exit_array(reader);
+                        else
+                                r = c_json_reader_exit_object(reader);
+                        depth -= 1;
+                } else {
+                        if (depth > 0) {
+                                if (counts[depth] == UINT32_MAX) {
+                                        r = -E2BIG;
+                                        goto error;
+                                }
+                                counts[depth] += 1;
+                        }
+
+                        switch ((type = c_json_reader_peek(reader))) {
+                        case C_JSON_TYPE_NULL:
+                                r = c_json_reader_read_null(reader);
+                                if (!r)
+                                        r = c_json_cache_append(&encoder, "n", 1);
+                                break;
+                        case C_JSON_TYPE_BOOLEAN:
+                                r = c_json_reader_read_bool(reader, &b);
+                                if (!r)
+                                        r = c_json_cache_append(&encoder, b ? "t" : "f", 1);
+                                break;
+                        case C_JSON_TYPE_STRING:
+                                r = c_json_cache_encode_string(&encoder, reader);
+                                break;
+                        case C_JSON_TYPE_NUMBER:
+                                r = c_json_reader_read_number(reader, &number, &n_number);
+                                if (!r)
+                                        r = c_json_cache_append_string(&encoder, '0', number, n_number);
+                                break;
+                        case C_JSON_TYPE_ARRAY:
+                        case C_JSON_TYPE_OBJECT:
+                                if (type == C_JSON_TYPE_ARRAY)
+                                        r = c_json_reader_enter_array(reader);
+                                else
+                                        r = c_json_reader_enter_object(reader);
+                                if (r)
+                                        break;
+
+                                depth += 1;
+                                starts[depth] = encoder.n_data;
+                                counts[depth] = 0;
+
+                                /* count and size are patched in when the container is closed */
+                                r = c_json_cache_append(&encoder,
+                                                        type == C_JSON_TYPE_ARRAY ? "[" : "{",
+                                                        1);
+                                if (!r)
+                                        r = c_json_cache_append(&encoder,
+                                                                "\0\0\0\0\0\0\0\0\0\0\0\0",
+                                                                C_JSON_CACHE_HEADER - 1);
+                                break;
+                        default:
+                                r = reader->poison ?: (reader->poison = C_JSON_E_INVALID_JSON);
+                                break;
+                        }
+                }
+                if (r)
+                        goto error;
+        } while (depth > 0);
+
+        assert(reader->level == level);
+
+        *datap = encoder.data;
+        *n_datap = encoder.n_data;
+
+        return 0;
+
+error:
+        free(encoder.data);
+        return r;
+}
+
+/**
+ * c_json_cursor_new() - allocate a cursor over a binary cache
+ * @cursorp             return location
+ * @max_depth           maximum nesting depth
+ *
+ * Return: <0 on fatal failures
+ *         0 on success
+ */
+_c_public_ int c_json_cursor_new(CJsonCursor **cursorp, size_t max_depth) {
+        CJsonCursor *cursor;
+
+        cursor = calloc(1, sizeof(*cursor) + (max_depth + 1) * sizeof(*cursor->levels));
+        if (!cursor)
+                return -ENOMEM;
+
+        cursor->n_levels = max_depth;
+
+        *cursorp = cursor;
+
+        return 0;
+}
+
+/**
+ * c_json_cursor_free() - free a cursor
+ * @cursor              cursor to free
+ *
+ * Return: NULL
+ */
+_c_public_ CJsonCursor * c_json_cursor_free(CJsonCursor *cursor) {
+        if (!cursor)
+                return NULL;
+
+        free(cursor);
+
+        return NULL;
+}
+
+/**
+ * c_json_cursor_begin_read() - begin reading a binary cache
+ * @cursor              cursor object
+ * @data                cache, as returned by c_json_cache_encode()
+ * @n_data              size of @data in bytes
+ *
+ * The cursor reads @data in place, so it can point into a mapped file.
+ * Malformed caches are detected as they are read and reported as
+ * C_JSON_E_INVALID_JSON, the cursor never reads outside of @data.
+ *
+ * It is an error to call this function multiple times without calling
+ * c_json_cursor_end_read().
+ */
+_c_public_ void c_json_cursor_begin_read(CJsonCursor *cursor, const char *data, size_t n_data) {
+        assert(!cursor->data);
+
+        cursor->data = data;
+        cursor->end = data + n_data;
+        cursor->p = data + strlen(C_JSON_CACHE_MAGIC);
+        cursor->level = 0;
+        cursor->levels[0] = (CJsonCursorLevel){ .n_remaining = 1, .end = cursor->end };
+
+        if (n_data < strlen(C_JSON_CACHE_MAGIC) ||
+            memcmp(data, C_JSON_CACHE_MAGIC, strlen(C_JSON_CACHE_MAGIC)))
+                cursor->poison = C_JSON_E_INVALID_JSON;
+}
+
+/**
+ * c_json_cursor_end_read() - end reading
+ * @cursor              cursor object
+ *
+ * Ends reading. If there was a previous error, it is returned. The
+ * previous error is reset, so that the object can be reused.
+ *
+ * Return: 0 on success
+ *         the last error that occured in a cursor function
+ *         C_JSON_E_INVALID_TYPE if called before the cache was fully read
+ *         C_JSON_E_INVALID_JSON if the cache is malformed
+ */
+_c_public_ int c_json_cursor_end_read(CJsonCursor *cursor) {
+        int r = cursor->poison;
+
+        if (!r) {
+                if (cursor->level > 0 || cursor->levels[0].n_remaining > 0)
+                        r = C_JSON_E_INVALID_TYPE;
+                else if (cursor->p != cursor->end)
+                        r = C_JSON_E_INVALID_JSON;
+        }
+
+        cursor->data = NULL;
+        cursor->end = NULL;
+        cursor->p = NULL;
+        cursor->level = 0;
+        cursor->poison = 0;
+
+        return r;
+}
+
+static bool c_json_cursor_at_key(CJsonCursor *cursor) {
+        CJsonCursorLevel *level = &cursor->levels[cursor->level];
+
+        return level->kind == '{' && level->n_remaining % 2 == 0;
+}
+
+/* consumes one value of the current level, which must have one left */
+static int c_json_cursor_take(CJsonCursor *cursor) {
+        CJsonCursorLevel *level = &cursor->levels[cursor->level];
+
+        if (cursor->p >= level->end || level->n_remaining == 0)
+                return (cursor->poison = C_JSON_E_INVALID_JSON);
+
+        level->n_remaining -= 1;
+
+        return 0;
+}
+
+static int c_json_cursor_read_blob(CJsonCursor *cursor, char tag, const char **blobp, size_t *n_blobp) {
+        const char *end = cursor->levels[cursor->level].end;
+        uint32_t n;
+
+        if (_c_unlikely_(cursor->poison))
+                return cursor->poison;
+
+        if (cursor->p >= cursor->end || *cursor->p != tag)
+                return (cursor->poison = C_JSON_E_INVALID_TYPE);
+
+        if (tag != '"' && c_json_cursor_at_key(cursor))
+                return (cursor->poison = C_JSON_E_INVALID_TYPE);
+
+        if (cursor->p >= end || (size_t)(end - cursor->p) < 1 + sizeof(n))
+                return (cursor->poison = C_JSON_E_INVALID_JSON);
+
+        memcpy(&n, cursor->p + 1, sizeof(n));
+        if ((size_t)(end - cursor->p) - 1 - sizeof(n) <= n ||
+            cursor->p[1 + sizeof(n) + n] != '\0')
+                return (cursor->poison = C_JSON_E_INVALID_JSON);
+
+        if (c_json_cursor_take(cursor))
+                return cursor->poison;
+
+        *blobp = cursor->p + 1 + sizeof(n);
+        *n_blobp = n;
+        cursor->p += 1 + sizeof(n) + n + 1;
+
+        return 0;
+}
+
+/**
+ * c_json_cursor_peek() - peek at the next value
+ * @cursor              cursor object
+ *
+ * Return: -1 if the next value is invalid or when exiting a container
+ *         one of the C_JSON_TYPE_ values
+ */
+_c_public_ int c_json_cursor_peek(CJsonCursor *cursor) {
+        if (_c_unlikely_(cursor->poison))
+                return -1;
+
+        if (cursor->levels[cursor->level].n_remaining == 0 || cursor->p >= cursor->end)
+                return -1;
+
+        switch (*cursor->p) {
+        case '[':
+                return C_JSON_TYPE_ARRAY;
+        case '{':
+                return C_JSON_TYPE_OBJECT;
+        case '"':
+                return C_JSON_TYPE_STRING;
+        case '0':
+                return C_JSON_TYPE_NUMBER;
+        case 't':
+        case 'f':
+                return C_JSON_TYPE_BOOLEAN;
+        case 'n':
+                return C_JSON_TYPE_NULL;
+        default:
+                return -1;
+        }
+}
+
+/**
+ * c_json_cursor_more() - is another value available
+ * @cursor              cursor object
+ *
+ * Return: true if another value is available in the current container
+ *         false if no value is available or an error occured in a call to a previous function
+ */
+_c_public_ bool c_json_cursor_more(CJsonCursor *cursor) {
+        if (_c_unlikely_(cursor->poison))
+                return false;
+
+        return cursor->levels[cursor->level].n_remaining > 0;
+}
+
+/**
+ * c_json_cursor_read_null() - read `null` value
+ * @cursor              cursor object
+ *
+ * Return: 0 on success
+ *         the last error that occured in a cursor function
+ *         C_JSON_E_INVALID_TYPE if then next value is not `null`
+ *         C_JSON_E_INVALID_JSON if the cache is malformed
+ */
+_c_public_ int c_json_cursor_read_null(CJsonCursor *cursor) {
+        if (_c_unlikely_(cursor->poison))
+                return cursor->poison;
+
+        if (cursor->p >= cursor->end || *cursor->p != 'n' || c_json_cursor_at_key(cursor))
+                return (cursor->poison = C_JSON_E_INVALID_TYPE);
+
+        if (c_json_cursor_take(cursor))
+                return cursor->poison;
+
+        cursor->p += 1;
+
+        return 0;
+}
+
+/**
+ * c_json_cursor_read_bool() - read a boolean
+ * @cursor              cursor object
+ * @boolp               return location for the boolean
+ *
+ * Return: 0 on success
+ *         the last error that occured in a cursor function
+ *         C_JSON_E_INVALID_TYPE if then next value is not a boolean
+ *         C_JSON_E_INVALID_JSON if the cache is malformed
+ */
+_c_public_ int c_json_cursor_read_bool(CJsonCursor *cursor, bool *boolp) {
+        bool b;
+
+        if (_c_unlikely_(cursor->poison))
+                return cursor->poison;
+
+        if (cursor->p >= cursor->end || c_json_cursor_at_key(cursor))
+                return (cursor->poison = C_JSON_E_INVALID_TYPE);
+
+        switch (*cursor->p) {
+        case 't':
+                b = true;
+                break;
+        case 'f':
+                b = false;
+                break;
+        default:
+                return (cursor->poison = C_JSON_E_INVALID_TYPE);
+        }
+
+        if (c_json_cursor_take(cursor))
+                return cursor->poison;
+
+        cursor->p += 1;
+
+        if (boolp)
+                *boolp = b;
+
+        return 0;
+}
+
+/**
+ * c_json_cursor_read_string() - read a string
+ * @cursor              cursor object
+ * @stringp             return location for the string, or NULL
+ *
+ * The returned string must be freed. Use c_json_cursor_read_string_ref()
+ * to avoid the copy.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a cursor function
+ *         C_JSON_E_INVALID_TYPE if then next value is not a string
+ *         C_JSON_E_INVALID_JSON if the cache is malformed
+ */
+_c_public_ int c_json_cursor_read_string(CJsonCursor *cursor, char **stringp) {
+        const char *string;
+        size_t n_string;
+        char *copy;
+        int r;
+
+        r = c_json_cursor_read_blob(cursor, '"', &string, &n_string);
+        if (r)
+                return r;
+
+        if (stringp) {
+                copy = malloc(n_string + 1);
+                if (!copy)
+                        return (cursor->poison = -ENOMEM);
+
+                memcpy(copy, string, n_string + 1);
+                *stringp = copy;
+        }
+
+        return 0;
+}
+
+/**
+ * c_json_cursor_read_string_ref() - read a string without copying it
+ * @cursor              cursor object
+ * @stringp             return location for the string, or NULL
+ * @n_stringp           return location for the length of the string, or NULL
+ *
+ * Returns a pointer into the cache, which stays valid as long as the
+ * cache does. The string is 0-terminated, but may contain 0-bytes.
+ *
+ * Return: 0 on success
+ *         the last error that occured in a cursor function
+ *         C_JSON_E_INVALID_TYPE if then next value is not a string
+ *         C_JSON_E_INVALID_JSON if the cache is malformed
+ */
+_c_public_ int c_json_cursor_read_string_ref(CJsonCursor *cursor, const char **stringp, size_t *n_stringp) {
+        const char *string;
+        size_t n_string;
+        int r;
+
+        r = c_json_cursor_read_blob(cursor, '"', &string, &n_string);
+        if (r)
+                return r;
+
+        if (stringp)
+                *stringp = string;
+        if (n_stringp)
+                *n_stringp = n_string;
+
+        return 0;
+}
+
+/**
+ * c_json_cursor_read_number() - read a number
+ * @cursor              cursor object
+ * @numberp             return location for the number
+ * @n_numberp           return location for the length of the number
+ *
+ * Returns the number exactly as it was written in the JSON input.
+ *
+ * Return: 0 on success
+ *         the last error that occured in a cursor function
+ *         C_JSON_E_INVALID_TYPE if the next value is not a number
+ *         C_JSON_E_INVALID_JSON if the cache is malformed
+ */
+_c_public_ int c_json_cursor_read_number(CJsonCursor *cursor, const char **numberp, size_t *n_numberp) {
+        const char *number;
+        size_t n_number;
+        int r;
+
+        r = c_json_cursor_read_blob(cursor, '0', &number, &n_number);
+        if (r)
+                return r;
+
+        if (numberp)
+                *numberp = number;
+        if (n_numberp)
+                *n_numberp = n_number;
+
+        return 0;
+}
+
+static int c_json_cursor_enter(CJsonCursor *cursor, char kind) {
+        uint32_t n_values;
+        uint64_t n_bytes;
+
+        if (_c_unlikely_(cursor->poison))
+                return cursor->poison;
+
+        if (cursor->p >= cursor->end || *cursor->p != kind || c_json_cursor_at_key(cursor))
+                return (cursor->poison = C_JSON_E_INVALID_TYPE);
+
+        if (cursor->level >= cursor->n_levels)
+                return (cursor->poison = C_JSON_E_DEPTH_OVERFLOW);
+
+        if ((size_t)(cursor->levels[cursor->level].end - cursor->p) < C_JSON_CACHE_HEADER)
+                return (cursor->poison = C_JSON_E_INVALID_JSON);
+
+        memcpy(&n_values, cursor->p + 1, sizeof(n_values));
+        memcpy(&n_bytes, cursor->p + 1 + sizeof(n_values), sizeof(n_bytes));
+
+        if (n_bytes > (uint64_t)(cursor->levels[cursor->level].end - cursor->p - C_JSON_CACHE_HEADER) ||
+            (kind == '{' && n_values % 2))
+                return (cursor->poison = C_JSON_E_INVALID_JSON);
+
+        if (c_json_cursor_take(cursor))
+                return cursor->poison;
+
+        cursor->p += C_JSON_CACHE_HEADER;
+        cursor->levels[++cursor->level] = (CJsonCursorLevel){
+                .kind = kind,
+                .n_remaining = n_values,
+                .end = cursor->p + n_bytes,
+        };
+
+        return 0;
+}
+
+static int c_json_cursor_exit(CJsonCursor *cursor, char kind) {
+        CJsonCursorLevel *level = &cursor->levels[cursor->level];
+
+        if (_c_unlikely_(cursor->poison))
+                return cursor->poison;
+
+        if (cursor->level == 0 || level->kind != kind)
+                return (cursor->poison = C_JSON_E_INVALID_TYPE);
+
+        if (level->n_remaining > 0 || cursor->p != level->end)
+                return (cursor->poison = C_JSON_E_INVALID_JSON);
+
+        cursor->level -= 1;
+
+        return 0;
+}
+
+/**
+ * c_json_cursor_enter_array() - enter into an array
+ * @cursor              cursor object
+ *
+ * Return: 0 on success
+ *         the last error that occured in a cursor function
+ *         C_JSON_E_INVALID_TYPE if then next value is not an array
+ *         C_JSON_E_INVALID_JSON if the cache is malformed
+ *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
+ */
+_c_public_ int c_json_cursor_enter_array(CJsonCursor *cursor) {
+        return c_json_cursor_enter(cursor, '[');
+}
+
+/**
+ * c_json_cursor_exit_array() - exit from an array
+ * @cursor              cursor object
+ *
+ * Return: 0 on success
+ *         the last error that occured in a cursor function
+ *         C_JSON_E_INVALID_TYPE if not currently in an array
+ *         C_JSON_E_INVALID_JSON if not all values were read, or the cache is malformed
+ */
+_c_public_ int c_json_cursor_exit_array(CJsonCursor *cursor) {
+        return c_json_cursor_exit(cursor, '[');
+}
+
+/**
+ * c_json_cursor_enter_object() - enter into an object
+ * @cursor              cursor object
+ *
+ * Return: 0 on success
+ *         the last error that occured in a cursor function
+ *         C_JSON_E_INVALID_TYPE if then next value is not an object
+ *         C_JSON_E_INVALID_JSON if the cache is malformed
+ *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
+ */
+_c_public_ int c_json_cursor_enter_object(CJsonCursor *cursor) {
+        return c_json_cursor_enter(cursor, '{');
+}
+
+/**
+ * c_json_cursor_exit_object() - exit from an object
+ * @cursor              cursor object
+ *
+ * Return: 0 on success
+ *         the last error that occured in a cursor function
+ *         C_JSON_E_INVALID_TYPE if not currently in an object
+ *         C_JSON_E_INVALID_JSON if not all values were read, or the cache is malformed
+ */
+_c_public_ int c_json_cursor_exit_object(CJsonCursor *cursor) {
+        return c_json_cursor_exit(cursor, '{');
+}
+
+/**
+ * c_json_cursor_skip() - skip the next value
+ * @cursor              cursor object
+ *
+ * Skips the next value. Containers are skipped as a whole, in constant
+ * time, without looking at their contents.
+ *
+ * Return: 0 on success
+ *         the last error that occured in a cursor function
+ *         C_JSON_E_INVALID_JSON if the cache is malformed
+ */
+_c_public_ int c_json_cursor_skip(CJsonCursor *cursor) {
+        const char *blob;
+        size_t n_blob;
+        uint64_t n_bytes;
+
+        switch (c_json_cursor_peek(cursor)) {
+        case C_JSON_TYPE_NULL:
+                return c_json_cursor_read_null(cursor);
+        case C_JSON_TYPE_BOOLEAN:
+                return c_json_cursor_read_bool(cursor, NULL);
+        case C_JSON_TYPE_STRING:
+                return c_json_cursor_read_blob(cursor, '"', &blob, &n_blob);
+        case C_JSON_TYPE_NUMBER:
+                return c_json_cursor_read_blob(cursor, '0', &blob, &n_blob);
+        case C_JSON_TYPE_ARRAY:
+        case C_JSON_TYPE_OBJECT:
+                if (c_json_cursor_at_key(cursor))
+                        return (cursor->poison = C_JSON_E_INVALID_TYPE);
+
+                if ((size_t)(cursor->levels[cursor->level].end - cursor->p) < C_JSON_CACHE_HEADER)
+                        return (cursor->poison = C_JSON_E_INVALID_JSON);
+
+                memcpy(&n_bytes, cursor->p + 1 + sizeof(uint32_t), sizeof(n_bytes));
+                if (n_bytes > (uint64_t)(cursor->levels[cursor->level].end - cursor->p - C_JSON_CACHE_HEADER))
+                        return (cursor->poison = C_JSON_E_INVALID_JSON);
+
+                if (c_json_cursor_take(cursor))
+                        return cursor->poison;
+
+                cursor->p += C_JSON_CACHE_HEADER + n_bytes;
+                return 0;
+        default:
+                if (_c_unlikely_(cursor->poison))
+                        return cursor->poison;
+                return (cursor->poison = C_JSON_E_INVALID_JSON);
+        }
+}
@@ -0,0 +1,926 @@
+
+#include <c-stdaux.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+typedef struct CJsonCanonical CJsonCanonical;
+typedef struct CJsonCanonicalSink CJsonCanonicalSink;
+typedef struct CJsonCanonicalMember CJsonCanonicalMember;
+typedef struct CJsonCanonicalLevel CJsonCanonicalLevel;
+typedef struct CJsonSha256 CJsonSha256;
+
+/*
+ * Canonical output goes through a sink. Sinks with a callback hand their
+ * contents on whenever their buffer is full, sinks without one grow
+ * until they are drained explicitly.
+ */
+struct CJsonCanonicalSink {
+        CJsonChunkFn fn;
+        void *userdata;
+        char *data;
+        size_t n_data;
+        size_t n_allocated;
+};
+
+struct CJsonCanonicalMember {
+        const char *key;
+        size_t i_key;
+        size_t n_key;
+        size_t start;
+        size_t end;
+};
+
+struct CJsonCanonicalLevel {
+        const char *start;
+        const char *key;
+        size_t n_key;
+        bool object;
+        bool unsorted;
+        bool in_key;
+};
+
+/*
+ * Objects that are sorted write their members to @buffer and their keys
+ * to @keys. Both are used as stacks, so nested objects reuse the memory
+ * of their parents and nothing is allocated per object.
+ */
+struct CJsonCanonical {
+        CJsonReader *reader;
+        CJsonCanonicalSink buffer;
+        CJsonCanonicalSink keys;
+        CJsonCanonicalMember *members;
+        size_t n_members;
+        size_t n_members_allocated;
+
+        /* objects in the scanned input that need sorting, in input order */
+        const char *scanned;
+        const char **unsorted;
+        size_t n_unsorted;
+        size_t i_unsorted;
+        size_t n_unsorted_allocated;
+        CJsonCanonicalLevel *levels;
+        size_t n_levels_allocated;
+};
+
+struct CJsonSha256 {
+        uint32_t state[8];
+        uint64_t n_bytes;
+        uint8_t block[64];
+        size_t n_block;
+};
+
+static const uint32_t c_json_sha256_k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t c_json_sha256_ror(uint32_t x, unsigned int n) {
+        return (x >> n) | (x << (32 - n));
+}
+
+static void c_json_sha256_init(CJsonSha256 *sha) {
+        *sha = (CJsonSha256){
+                .state = {
+                        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+                },
+        };
+}
+
+static void c_json_sha256_compress(CJsonSha256 *sha, const uint8_t *block) {
+        uint32_t w[64], a, b, c, d, e, f, g, h, t1, t2;
+
+        for (size_t i = 0; i < 16; i += 1)
+                w[i] = (uint32_t)block[i * 4] << 24 |
+                       (uint32_t)block[i * 4 + 1] << 16 |
+                       (uint32_t)block[i * 4 + 2] << 8 |
+                       (uint32_t)block[i * 4 + 3];
+
+        for (size_t i = 16; i < 64; i += 1)
+                w[i] = w[i - 16] + w[i - 7] +
+                       (c_json_sha256_ror(w[i - 15], 7) ^ c_json_sha256_ror(w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+                       (c_json_sha256_ror(w[i - 2], 17) ^ c_json_sha256_ror(w[i - 2], 19) ^ (w[i - 2] >> 10));
+
+        a = sha->state[0];
+        b = sha->state[1];
+        c = sha->state[2];
+        d = sha->state[3];
+        e = sha->state[4];
+        f = sha->state[5];
+        g = sha->state[6];
+        h = sha->state[7];
+
+        for (size_t i = 0; i < 64; i += 1) {
+                t1 = h +
+                     (c_json_sha256_ror(e, 6) ^ c_json_sha256_ror(e, 11) ^ c_json_sha256_ror(e, 25)) +
+                     ((e & f) ^ (~e & g)) +
+                     c_json_sha256_k[i] + w[i];
+                t2 = (c_json_sha256_ror(a, 2) ^ c_json_sha256_ror(a, 13) ^ c_json_sha256_ror(a, 22)) +
+                     ((a & b) ^ (a & c) ^ (b & c));
+
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+        }
+
+        sha->state[0] += a;
+        sha->state[1] += b;
+        sha->state[2] += c;
+        sha->state[3] += d;
+        sha->state[4] += e;
+        sha->state[5] += f;
+        sha->state[6] += g;
+        sha->state[7] += h;
+}
+
+static int c_json_sha256_update(void *userdata, const char *chunk, size_t n_chunk) {
+        CJsonSha256 *sha = userdata;
+        const uint8_t *p = (const uint8_t *)chunk;
+        size_t n;
+
+        sha->n_bytes += n_chunk;
+
+        if (sha->n_block) {
+                n = c_min(n_chunk, sizeof(sha->block) - sha->n_block);
+                memcpy(sha->block + sha->n_block, p, n);
+                sha->n_block += n;
+                p += n;
+                n_chunk -= n;
+
+                if (sha->n_block < sizeof(sha->block))
+                        return 0;
+
+                c_json_sha256_compress(sha, sha->block);
+                sha->n_block = 0;
+        }
+
+        for ( ; n_chunk >= sizeof(sha->block); p += sizeof(sha->block), n_chunk -= sizeof(sha->block))
+                c_json_sha256_compress(sha, p);
+
+        memcpy(sha->block, p, n_chunk);
+        sha->n_block = n_chunk;
+
+        return 0;
+}
+
+static void c_json_sha256_final(CJsonSha256 *sha, uint8_t *digest) {
+        uint64_t n_bits = sha->n_bytes * 8;
+
+        sha->block[sha->n_block++] = 0x80;
+        if (sha->n_block > sizeof(sha->block) - 8) {
+                memset(sha->block + sha->n_block, 0, sizeof(sha->block) - sha->n_block);
+                c_json_sha256_compress(sha, sha->block);
+                sha->n_block = 0;
+        }
+
+        memset(sha->block + sha->n_block, 0, sizeof(sha->block) - 8 - sha->n_block);
+        for (size_t i = 0; i < 8; i += 1)
+                sha->block[56 + i] = (uint8_t)(n_bits >> (56 - 8 * i));
+        c_json_sha256_compress(sha, sha->block);
+
+        for (size_t i = 0; i < 8; i += 1) {
+                digest[i * 4] = (uint8_t)(sha->state[i] >> 24);
+                digest[i * 4 + 1] = (uint8_t)(sha->state[i] >> 16);
+                digest[i * 4 + 2] = (uint8_t)(sha->state[i] >> 8);
+                digest[i * 4 + 3] = (uint8_t)sha->state[i];
+        }
+}
+
+static int c_json_canonical_flush(CJsonCanonicalSink *sink) {
+        int r;
+
+        if (!sink->n_data)
+                return 0;
+
+        r = sink->fn(sink->userdata, sink->data, sink->n_data);
+        if (r)
+                return r;
+
+        sink->n_data = 0;
+
+        return 0;
+}
+
+/* makes room for @n_data more bytes in a sink without a callback */
+static int c_json_canonical_reserve(CJsonCanonicalSink *sink, size_t n_data) {
+        size_t n_allocated;
+        char *buffer;
+
+        if (sink->n_data + n_data <= sink->n_allocated)
+                return 0;
+
+        n_allocated = c_max(sink->n_allocated * 2, sink->n_data + n_data);
+        n_allocated = c_max(n_allocated, (size_t)4096);
+
+        buffer = realloc(sink->data, n_allocated);
+        if (!buffer)
+                return -ENOMEM;
+
+        sink->data = buffer;
+        sink->n_allocated = n_allocated;
+
+        return 0;
+}
+
+static int c_json_canonical_write(CJsonCanonicalSink *sink, const char *data, size_t n_data) {
+        size_t n;
+        int r;
+
+        /* empty keys are written to a sink that might not be allocated yet */
+        if (!n_data)
+                return 0;
+
+        if (_c_unlikely_(sink->n_data + n_data > sink->n_allocated)) {
+                if (sink->fn) {
+                        while (sink->n_data + n_data > sink->n_allocated) {
+                                n = sink->n_allocated - sink->n_data;
+                                memcpy(sink->data + sink->n_data, data, n);
+                                sink->n_data += n;
+                                data += n;
+                                n_data -= n;
+
+                                r = c_json_canonical_flush(sink);
+                                if (r)
+                                        return r;
+                        }
+                } else {
+                        r = c_json_canonical_reserve(sink, n_data);
+                        if (r)
+                                return r;
+                }
+        }
+
+        memcpy(sink->data + sink->n_data, data, n_data);
+        sink->n_data += n_data;
+
+        return 0;
+}
+
+/*
+ * Writes @string as canonical JSON string: only '"', '\\' and control
+ * characters are escaped, using the short forms where JSON has them.
+ */
+static int c_json_canonical_write_escaped(CJsonCanonicalSink *sink, const char *string, size_t n_string) {
+        static const char hex[] = "0123456789abcdef";
+        const char *p = string, *end = string + n_string, *run = string;
+        char escape[6];
+        size_t n_escape;
+        int r;
+
+        r = c_json_canonical_write(sink, "\"", 1);
+        if (r)
+                return r;
+
+        for ( ; p < end; p += 1) {
+                switch (*p) {
+                case '"':
+                case '\\':
+                        escape[0] = '\\';
+                        escape[1] = *p;
+                        n_escape = 2;
+                        break;
+                case '\b':
+                        memcpy(escape, "\\b", n_escape = 2);
+                        break;
+                case '\f':
+                        memcpy(escape, "\\f", n_escape = 2);
+                        break;
+                case '\n':
+                        memcpy(escape, "\\n", n_escape = 2);
+                        break;
+                case '\r':
+                        memcpy(escape, "\\r", n_escape = 2);
+                        break;
+                case '\t':
+                        memcpy(escape, "\\t", n_escape = 2);
+                        break;
+                case 0x00 ... 0x07:
+                case 0x0B:
+                case 0x0E ... 0x1F:
+                        memcpy(escape, "\\u00", 4);
+                        escape[4] = hex[(uint8_t)*p >> 4];
+                        escape[5] = hex[(uint8_t)*p & 0xF];
+                        n_escape = 6;
+                        break;
+                default:
+                        continue;
+                }
+
+                r = c_json_canonical_write(sink, run, p - run);
+                if (r)
+                        return r;
+
+                r = c_json_canonical_write(sink, escape, n_escape);
+                if (r)
+                        return r;
+
+                run = p + 1;
+        }
+
+        r = c_json_canonical_write(sink, run, p - run);
+        if (r)
+                return r;
+
+        return c_json_canonical_write(sink, "\"", 1);
+}
+
+/*
+ * Compares two UTF-8 strings by their UTF-16 code units, as RFC 8785
+ * sorts keys. This is the same as comparing their bytes, except that
+ * code points above U+FFFF are encoded as surrogates in UTF-16, which sort
+ * before U+E000 to U+FFFF.
+ */
+static int c_json_canonical_compare(const char *a, size_t n_a, const char *b, size_t n_b) {
+        size_t i, start;
+        uint8_t lead_a, lead_b;
+
+        for (i = 0; i < n_a && i < n_b && a[i] == b[i]; i += 1)
+                ;
+
+        if (i == n_a || i == n_b)
+                return n_a < n_b ? -1 : n_a > n_b ? 1 : 0;
+
+        /* the strings share all bytes before @i, so they share the lead byte */
+        for (start = i; start > 0 && ((uint8_t)a[start] & 0xC0) == 0x80; start -= 1)
+                ;
+
+        lead_a = a[start];
+        lead_b = b[start];
+
+        if (lead_a >= 0xF0 && lead_b >= 0xEE && lead_b < 0xF0)
+                return -1;
+        if (lead_b >= 0xF0 && lead_a >= 0xEE && lead_a < 0xF0)
+                return 1;
+
+        return (uint8_t)a[i] < (uint8_t)b[i] ? -1 : 1;
+}
+
+static int c_json_canonical_compare_members(const void *a, const void *b) {
+        const CJsonCanonicalMember *ma = a, *mb = b;
+
+        return c_json_canonical_compare(ma->key, ma->n_key, mb->key, mb->n_key);
+}
+
+static int c_json_canonical_compare_unsorted(const void *a, const void *b) {
+        const char * const *pa = a, * const *pb = b;
+
+        return *pa < *pb ? -1 : *pa > *pb ? 1 : 0;
+}
+
+static int c_json_canonical_mark(CJsonCanonical *c, CJsonCanonicalLevel *level) {
+        size_t n_allocated;
+        const char **unsorted;
+
+        if (level->unsorted)
+                return 0;
+
+        if (c->n_unsorted >= c->n_unsorted_allocated) {
+                n_allocated = c_max(c->n_unsorted_allocated * 2, (size_t)64);
+                unsorted = realloc(c->unsorted, n_allocated * sizeof(*unsorted));
+                if (!unsorted)
+                        return -ENOMEM;
+
+                c->unsorted = unsorted;
+                c->n_unsorted_allocated = n_allocated;
+        }
+
+        c->unsorted[c->n_unsorted++] = level->start;
+        level->unsorted = true;
+
+        return 0;
+}
+
+/*
+ * Scans the value at @p once and records every object in it whose keys
+ * are not unique, strictly sorted and free of escape sequences. All
+ * other objects can be written as they are read. Each key is only
+ * compared to the previous key of its object, so the whole value is
+ * scanned in a single pass, no matter how deep it is nested.
+ *
+ * This only looks for the structure of the raw input and leaves
+ * validation to the reader. Objects that are still open when the input
+ * ends are reported as unsorted, and the reader reports the error when
+ * they are read for real. Levels beyond the maximum depth of the reader
+ * are not tracked, as the reader fails before it gets there.
+ */
+static int c_json_canonical_scan(CJsonCanonical *c, const char *p) {
+        CJsonCanonicalLevel *levels, *level = NULL;
+        size_t depth = 0, n_allocated;
+        const char *start;
+        bool escaped;
+        int r;
+
+        c->n_unsorted = 0;
+        c->i_unsorted = 0;
+
+        for (;;) {
+                switch (*p) {
+                case '\0':
+                        for (size_t i = 0; i < depth && i < c->n_levels_allocated; i += 1) {
+                                if (c->levels[i].object) {
+                                        r = c_json_canonical_mark(c, &c->levels[i]);
+                                        if (r)
+                                                return r;
+                                }
+                        }
+
+                        c->scanned = p;
+                        goto done;
+                case '"':
+                        start = ++p;
+                        escaped = false;
+
+                        while (*p && *p != '"') {
+                                if (*p == '\\') {
+                                        if (!*++p)
+                                                break;
+                                        escaped = true;
+                                }
+
+                                p += 1;
+                        }
+
+                        if (!*p)
+                                continue;
+
+                        if (level && level->object && level->in_key) {
+                                if (escaped ||
+                                    (level->key && c_json_canonical_compare(level->key, level->n_key, start, p - start) >= 0)) {
+                                        r = c_json_canonical_mark(c, level);
+                                        if (r)
+                                                return r;
+                                }
+
+                                level->key = start;
+                                level->n_key = p - start;
+                                level->in_key = false;
+                        }
+                        break;
+                case '[':
+                case '{':
+                        level = NULL;
+
+                        if (depth < c->reader->n_states) {
+                                if (depth >= c->n_levels_allocated) {
+                                        n_allocated = c_min(c_max(c->n_levels_allocated * 2, (size_t)16),
+                                                            c->reader->n_states);
+                                        levels = realloc(c->levels, n_allocated * sizeof(*levels));
+                                        if (!levels)
+                                                return -ENOMEM;
+
+                                        c->levels = levels;
+                                        c->n_levels_allocated = n_allocated;
+                                }
+
+                                level = &c->levels[depth];
+                                *level = (CJsonCanonicalLevel){
+                                        .start = p,
+                                        .object = *p == '{',
+                                        .in_key = true,
+                                };
+                        }
+
+                        depth += 1;
+                        break;
+                case ']':
+                case '}':
+                        if (--depth == 0) {
+                                c->scanned = p + 1;
+                                goto done;
+                        }
+
+                        level = depth <= c->n_levels_allocated ? &c->levels[depth - 1] : NULL;
+                        break;
+                case ',':
+                        if (level)
+                                level->in_key = true;
+                        break;
+                }
+
+                p += 1;
+        }
+
+done:
+        /* objects are marked when they are found out of order, not in input order */
+        if (c->n_unsorted > 1)
+                qsort(c->unsorted, c->n_unsorted, sizeof(*c->unsorted), c_json_canonical_compare_unsorted);
+
+        return 0;
+}
+
+/*
+ * Checks whether the object at @p can be written as it is read. Objects
+ * are visited in input order, so the recorded unsorted objects are
+ * consumed in order, and a value is only scanned when it starts behind
+ * everything that has been scanned before.
+ */
+static int c_json_canonical_is_sorted(CJsonCanonical *c, const char *p, bool *sortedp) {
+        int r;
+
+        if (!c->scanned || p >= c->scanned) {
+                r = c_json_canonical_scan(c, p);
+                if (r)
+                        return r;
+        }
+
+        while (c->i_unsorted < c->n_unsorted && c->unsorted[c->i_unsorted] < p)
+                c->i_unsorted += 1;
+
+        *sortedp = c->i_unsorted >= c->n_unsorted || c->unsorted[c->i_unsorted] != p;
+        if (!*sortedp)
+                c->i_unsorted += 1;
+
+        return 0;
+}
+
+/*
+ * Writes the next string of @reader. Strings without escape sequences
+ * are already canonical and copied verbatim. If @keys is given, the
+ * decoded string is appended to it.
+ */
+static int c_json_canonical_string(CJsonReader *reader, CJsonCanonicalSink *sink, CJsonCanonicalSink *keys) {
+        _c_cleanup_(c_freep) char *heap = NULL;
+        char buffer[C_JSON_CHUNK_MAX], *decoded;
+        const char *end, *p;
+        size_t n_decoded;
+        bool escaped;
+        int r;
+
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        if (*reader->p != '"')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        end = reader->p + 1;
+        r = c_json_reader_scan_string(reader, &end, &escaped);
+        if (r) {
+                reader->p = end;
+                return (reader->poison = r);
+        }
+
+        if (!escaped) {
+                decoded = (char *)reader->p + 1;
+                n_decoded = end - reader->p - 1;
+
+                r = c_json_canonical_write(sink, reader->p, end - reader->p + 1);
+        } else {
+                /* the decoded string is never longer than the raw one */
+                if ((size_t)(end - reader->p) + 3 <= sizeof(buffer)) {
+                        decoded = buffer;
+                } else {
+                        decoded = heap = malloc(end - reader->p + 3);
+                        if (!decoded)
+                                return (reader->poison = -ENOMEM);
+                }
+
+                p = reader->p + 1;
+                r = c_json_decode_string(&p, reader->verified, decoded, end - reader->p + 3, &n_decoded);
+                if (r)
+                        return (reader->poison = r);
+
+                r = c_json_canonical_write_escaped(sink, decoded, n_decoded);
+        }
+        if (r)
+                return (reader->poison = r);
+
+        if (keys) {
+                r = c_json_canonical_write(keys, decoded, n_decoded);
+                if (r)
+                        return (reader->poison = r);
+        }
+
+        reader->p = end + 1;
+        return c_json_reader_advance(reader);
+}
+
+/*
+ * Writes the next number of @reader in its shortest round-trip form.
+ * Integers with at most 15 digits are exact in a double and already
+ * written that way in valid JSON, except for negative zero.
+ */
+static int c_json_canonical_number(CJsonReader *reader, CJsonCanonicalSink *sink) {
+        char buffer[C_JSON_NUMBER_MAX];
+        const char *number, *p;
+        size_t n_number, n_buffer;
+        double value;
+        int r;
+
+        r = c_json_reader_read_number(reader, &number, &n_number);
+        if (r)
+                return r;
+
+        p = number + (*number == '-');
+        if (number + n_number - p <= 15) {
+                while (p < number + n_number && *p >= '0' && *p <= '9')
+                        p += 1;
+
+                if (p == number + n_number) {
+                        if (n_number == 2 && number[1] == '0')
+                                return c_json_canonical_write(sink, "0", 1);
+
+                        return c_json_canonical_write(sink, number, n_number);
+                }
+        }
+
+        value = c_json_parse_double(number);
+        if (value == 0)
+                value = 0;
+
+        n_buffer = c_json_format_double(buffer, value);
+        if (!n_buffer)
+                return (reader->poison = -ERANGE);
+
+        return c_json_canonical_write(sink, buffer, n_buffer);
+}
+
+static int c_json_canonical_value(CJsonCanonical *c, CJsonCanonicalSink *sink);
+
+/*
+ * Writes an object whose keys are out of order. Each member is written
+ * to the shared buffer first, then the members are sorted by their keys
+ * and copied to @sink. If @sink is the shared buffer itself, the sorted
+ * object is moved down to where its members started.
+ */
+static int c_json_canonical_sort_object(CJsonCanonical *c, CJsonCanonicalSink *sink) {
+        size_t i_members = c->n_members, i_buffer = c->buffer.n_data, i_keys = c->keys.n_data;
+        CJsonReader *reader = c->reader;
+        CJsonCanonicalMember *members, *m;
+        size_t n_members, n_object = 2, n_allocated;
+        char *p;
+        int r;
+
+        r = c_json_reader_enter_object(reader);
+        if (r)
+                return r;
+
+        while (c_json_reader_more(reader)) {
+                if (c->n_members >= c->n_members_allocated) {
+                        n_allocated = c_max(c->n_members_allocated * 2, (size_t)64);
+                        m = realloc(c->members, n_allocated * sizeof(*m));
+                        if (!m)
+                                return (reader->poison = -ENOMEM);
+
+                        c->members = m;
+                        c->n_members_allocated = n_allocated;
+                }
+
+                m = &c->members[c->n_members++];
+                m->i_key = c->keys.n_data;
+                m->start = c->buffer.n_data;
+
+                r = c_json_canonical_string(reader, &c->buffer, &c->keys);
+                if (r)
+                        return r;
+
+                r = c_json_canonical_write(&c->buffer, ":", 1);
+                if (r)
+                        return (reader->poison = r);
+
+                r = c_json_canonical_value(c, &c->buffer);
+                if (r)
+                        return r;
+
+                /* @m might have moved while the value was written */
+                m = &c->members[c->n_members - 1];
+                m->n_key = c->keys.n_data - m->i_key;
+                m->end = c->buffer.n_data;
+                n_object += m->end - m->start + 1;
+        }
+
+        r = c_json_reader_exit_object(reader);
+        if (r)
+                return r;
+
+        members = c->members + i_members;
+        n_members = c->n_members - i_members;
+
+        for (size_t i = 0; i < n_members; i += 1)
+                members[i].key = c->keys.data + members[i].i_key;
+
+        qsort(members, n_members, sizeof(*members), c_json_canonical_compare_members);
+
+        for (size_t i = 1; i < n_members; i += 1)
+                if (!c_json_canonical_compare(members[i - 1].key, members[i - 1].n_key,
+                                              members[i].key, members[i].n_key))
+                        return (reader->poison = C_JSON_E_INVALID_JSON);
+
+        /* the sorted object goes behind the members, so they stay in place */
+        r = c_json_canonical_reserve(&c->buffer, n_object);
+        if (r)
+                return (reader->poison = r);
+
+        p = c->buffer.data + c->buffer.n_data;
+        *p++ = '{';
+        for (size_t i = 0; i < n_members; i += 1) {
+                if (i)
+                        *p++ = ',';
+                memcpy(p, c->buffer.data + members[i].start, members[i].end - members[i].start);
+                p += members[i].end - members[i].start;
+        }
+        *p++ = '}';
+
+        n_object = p - (c->buffer.data + c->buffer.n_data);
+
+        if (sink == &c->buffer) {
+                memmove(c->buffer.data + i_buffer, c->buffer.data + c->buffer.n_data, n_object);
+                c->buffer.n_data = i_buffer + n_object;
+        } else {
+                r = c_json_canonical_write(sink, c->buffer.data + c->buffer.n_data, n_object);
+                if (r)
+                        return (reader->poison = r);
+
+                c->buffer.n_data = i_buffer;
+        }
+
+        c->keys.n_data = i_keys;
+        c->n_members = i_members;
+
+        return 0;
+}
+
+static int c_json_canonical_container(CJsonCanonical *c, CJsonCanonicalSink *sink, bool object) {
+        CJsonReader *reader = c->reader;
+        size_t n_values = 0;
+        int r;
+
+        r = object ? c_json_reader_enter_object(reader) : c_json_reader_enter_array(reader);
+        if (r)
+                return r;
+
+        r = c_json_canonical_write(sink, object ? "{" : "[", 1);
+        if (r)
+                return (reader->poison = r);
+
+        while (c_json_reader_more(reader)) {
+                if (n_values++) {
+                        r = c_json_canonical_write(sink, ",", 1);
+                        if (r)
+                                return (reader->poison = r);
+                }
+
+                if (object) {
+                        r = c_json_canonical_string(reader, sink, NULL);
+                        if (r)
+                                return r;
+
+                        r = c_json_canonical_write(sink, ":", 1);
+                        if (r)
+                                return (reader->poison = r);
+                }
+
+                r = c_json_canonical_value(c, sink);
+                if (r)
+                        return r;
+        }
+
+        r = object ? c_json_reader_exit_object(reader) : c_json_reader_exit_array(reader);
+        if (r)
+                return r;
+
+        r = c_json_canonical_write(sink, object ? "}" : "]", 1);
+        if (r)
+                return (reader->poison = r);
+
+        return 0;
+}
+
+static int c_json_canonical_value(CJsonCanonical *c, CJsonCanonicalSink *sink) {
+        CJsonReader *reader = c->reader;
+        bool b;
+        int r;
+
+        switch (c_json_reader_peek(reader)) {
+        case C_JSON_TYPE_NULL:
+                r = c_json_reader_read_null(reader);
+                if (r)
+                        return r;
+
+                r = c_json_canonical_write(sink, "null", 4);
+                break;
+        case C_JSON_TYPE_BOOLEAN:
+                r = c_json_reader_read_bool(reader, &b);
+                if (r)
+                        return r;
+
+                r = b ? c_json_canonical_write(sink, "true", 4) : c_json_canonical_write(sink, "false", 5);
+                break;
+        case C_JSON_TYPE_STRING:
+                return c_json_canonical_string(reader, sink, NULL);
+        case C_JSON_TYPE_NUMBER:
+                r = c_json_canonical_number(reader, sink);
+                break;
+        case C_JSON_TYPE_ARRAY:
+                return c_json_canonical_container(c, sink, false);
+        case C_JSON_TYPE_OBJECT:
+                r = c_json_canonical_is_sorted(c, reader->p, &b);
+                if (r)
+                        return (reader->poison = r);
+
+                if (!b)
+                        return c_json_canonical_sort_object(c, sink);
+
+                return c_json_canonical_container(c, sink, true);
+        default:
+                return reader->poison ?: (reader->poison = C_JSON_E_INVALID_JSON);
+        }
+
+        if (r)
+                return (reader->poison = r);
+
+        return 0;
+}
+
+/**
+ * c_json_canonicalize() - write the canonical form of the next value
+ * @reader              reader to read the input from
+ * @fn                  callback to pass the canonical form to
+ * @userdata            userdata passed to @fn
+ *
+ * Reads the next value from @reader and passes its canonical form, as
+ * defined by RFC 8785, to @fn in chunks of at most C_JSON_CHUNK_MAX bytes.
+ * Whitespace is removed, strings are written with the minimal set of
+ * escape sequences, numbers are written in their shortest round-trip
+ * form, and object members are sorted by their keys.
+ *
+ * The output is produced while the input is read. Only objects whose
+ * keys are not already in order are buffered, to sort their members.
+ *
+ * Numbers are read as IEEE 754 doubles, so they must be in the range of
+ * doubles. Object keys must be unique.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a reader function
+ *         -ERANGE if a number is too large for a double
+ *         C_JSON_E_INVALID_TYPE if then next value is not a valid JSON value
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed or has duplicate keys
+ *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
+ *         any non-zero value returned by @fn
+ */
+_c_public_ int c_json_canonicalize(CJsonReader *reader, CJsonChunkFn fn, void *userdata) {
+        char buffer[C_JSON_CHUNK_MAX];
+        CJsonCanonicalSink sink = {
+                .fn = fn,
+                .userdata = userdata,
+                .data = buffer,
+                .n_allocated = sizeof(buffer),
+        };
+        CJsonCanonical c = {
+                .reader = reader,
+        };
+        int r;
+
+        r = c_json_canonical_value(&c, &sink);
+        if (!r) {
+                r = c_json_canonical_flush(&sink);
+                if (r)
+                        reader->poison = r;
+        }
+
+        free(c.levels);
+        free(c.unsorted);
+        free(c.members);
+        free(c.keys.data);
+        free(c.buffer.data);
+        return r;
+}
+/**
+ * c_json_canonical_hash() - hash the canonical form of the next value
+ * @reader              reader to read the input from
+ * @digest              return location for the SHA-256 digest
+ *
+ * Reads the next value from @reader like c_json_canonicalize() and feeds
+ * its canonical form into SHA-256, without storing it. Values that
+ * differ only in formatting, escaping, number notation or member order
+ * have the same digest.
+ *
+ * Return: same as c_json_canonicalize()
+ */
+_c_public_ int c_json_canonical_hash(CJsonReader *reader, uint8_t digest[C_JSON_HASH_SIZE]) {
+        CJsonSha256 sha;
+        int r;
+
+        c_json_sha256_init(&sha);
+
+        r = c_json_canonicalize(reader, c_json_sha256_update, &sha);
+        if (r)
+                return r;
+
+        c_json_sha256_final(&sha, digest);
+
+        return 0;
+}
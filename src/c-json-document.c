@@ -0,0 +1,429 @@
+
+#include <c-stdaux.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+/* objects with more than this many members get an index on lookup */
+#define C_JSON_DOCUMENT_INDEX_MIN 16
+
+typedef struct CJsonDocumentMember CJsonDocumentMember;
+typedef struct CJsonDocumentIndex CJsonDocumentIndex;
+
+struct CJsonDocumentMember {
+        CJsonString key;
+        uint64_t hash;
+        size_t value;
+};
+
+/*
+ * Hash index over the keys of a single object. Members are kept in
+ * document order, the buckets use open addressing with linear probing
+ * and hold member index + 1.
+ */
+struct CJsonDocumentIndex {
+        size_t object;
+        CJsonDocumentMember *members;
+        size_t n_members;
+        size_t *buckets;
+        size_t n_buckets;
+};
+
+struct CJsonDocument {
+        const char *input;
+        size_t n_input;
+        size_t root;
+
+        /* reader used to scan objects, never exposed */
+        CJsonReader *reader;
+
+        /*
+         * Indexes of the large objects looked up so far, by the offset of
+         * the object. Open addressing with linear probing.
+         */
+        CJsonDocumentIndex **indexes;
+        size_t n_indexes;
+        size_t n_slots;
+};
+
+static size_t c_json_document_slot(size_t object, size_t n_slots) {
+        return (size_t)(object * UINT64_C(0x9e3779b97f4a7c15) >> 32) & (n_slots - 1);
+}
+
+static CJsonDocumentIndex * c_json_document_index_free(CJsonDocumentIndex *index) {
+        if (!index)
+                return NULL;
+
+        free(index->buckets);
+        free(index->members);
+        free(index);
+
+        return NULL;
+}
+
+static void c_json_document_index_freep(CJsonDocumentIndex **indexp) {
+        if (*indexp)
+                c_json_document_index_free(*indexp);
+}
+
+static CJsonDocumentIndex * c_json_document_find_index(CJsonDocument *document, size_t object) {
+        if (!document->n_slots)
+                return NULL;
+
+        for (size_t i = c_json_document_slot(object, document->n_slots);
+             document->indexes[i];
+             i = (i + 1) & (document->n_slots - 1))
+                if (document->indexes[i]->object == object)
+                        return document->indexes[i];
+
+        return NULL;
+}
+
+static int c_json_document_add_index(CJsonDocument *document, CJsonDocumentIndex *index) {
+        size_t i;
+
+        if (2 * (document->n_indexes + 1) > document->n_slots) {
+                CJsonDocumentIndex **indexes;
+                size_t n_slots = document->n_slots ? 2 * document->n_slots : 16;
+
+                indexes = calloc(n_slots, sizeof(*indexes));
+                if (!indexes)
+                        return -ENOMEM;
+
+                for (size_t j = 0; j < document->n_slots; j += 1) {
+                        if (!document->indexes[j])
+                                continue;
+
+                        for (i = c_json_document_slot(document->indexes[j]->object, n_slots);
+                             indexes[i];
+                             i = (i + 1) & (n_slots - 1))
+                                ;
+                        indexes[i] = document->indexes[j];
+                }
+
+                free(document->indexes);
+                document->indexes = indexes;
+                document->n_slots = n_slots;
+        }
+
+        for (i = c_json_document_slot(index->object, document->n_slots);
+             document->indexes[i];
+             i = (i + 1) & (document->n_slots - 1))
+                ;
+        document->indexes[i] = index;
+        document->n_indexes += 1;
+
+        return 0;
+}
+
+/*
+ * Points the internal reader, or a caller's reader, at the value at
+ * @offset. The whole input was validated, so neither UTF-8 nor the
+ * structure need to be checked again.
+ */
+static void c_json_document_reader_begin(CJsonDocument *document, CJsonReader *reader, size_t offset) {
+        assert(!reader->input);
+
+        reader->input = document->input;
+        reader->verified = document->input + document->n_input;
+        reader->p = document->input + offset;
+        reader->states[0] = 0;
+        reader->n_strings_left = reader->limits.max_strings;
+        reader->n_values_left = reader->limits.max_values - 1;
+}
+
+static int c_json_document_reader_end(CJsonReader *reader) {
+        int r = reader->poison;
+
+        if (!r && reader->level > 0)
+                r = C_JSON_E_INVALID_TYPE;
+
+        if (r)
+                reader->error_offset = reader->p - reader->input;
+
+        reader->level = 0;
+        reader->input = NULL;
+        reader->verified = NULL;
+        reader->p = NULL;
+        reader->poison = 0;
+        reader->parse_suspended = false;
+
+        return r;
+}
+
+/*
+ * Reads all members of the object at @object into a new index.
+ */
+static int c_json_document_build_index(CJsonDocument *document, size_t object, CJsonDocumentIndex **indexp) {
+        _c_cleanup_(c_json_document_index_freep) CJsonDocumentIndex *index = NULL;
+        CJsonReader *reader = document->reader;
+        size_t n_allocated = 0, mask, i;
+        int r;
+
+        index = calloc(1, sizeof(*index));
+        if (!index)
+                return -ENOMEM;
+
+        index->object = object;
+
+        c_json_document_reader_begin(document, reader, object);
+        c_json_reader_enter_object(reader);
+
+        while (c_json_reader_more(reader)) {
+                CJsonDocumentMember *member, *members;
+
+                if (index->n_members == n_allocated) {
+                        n_allocated = n_allocated ? 2 * n_allocated : 64;
+                        members = realloc(index->members, n_allocated * sizeof(*members));
+                        if (!members) {
+                                c_json_document_reader_end(reader);
+                                return -ENOMEM;
+                        }
+                        index->members = members;
+                }
+
+                member = &index->members[index->n_members++];
+                c_json_reader_read_string_lazy(reader, &member->key);
+                member->hash = c_json_string_hash(&member->key);
+                member->value = reader->p - document->input;
+                c_json_reader_skip(reader);
+        }
+
+        c_json_reader_exit_object(reader);
+        r = c_json_document_reader_end(reader);
+        if (r)
+                return r;
+
+        index->n_buckets = 64;
+        while (index->n_buckets < 2 * index->n_members)
+                index->n_buckets *= 2;
+
+        index->buckets = calloc(index->n_buckets, sizeof(*index->buckets));
+        if (!index->buckets)
+                return -ENOMEM;
+
+        /*
+         * Members are inserted in document order. Duplicate keys hash to
+         * the same bucket, so the first of them is always found first.
+         */
+        mask = index->n_buckets - 1;
+        for (size_t j = 0; j < index->n_members; j += 1) {
+                for (i = index->members[j].hash & mask; index->buckets[i]; i = (i + 1) & mask)
+                        ;
+                index->buckets[i] = j + 1;
+        }
+
+        *indexp = index;
+        index = NULL;
+        return 0;
+}
+
+static size_t c_json_document_index_lookup(CJsonDocumentIndex *index, const char *key) {
+        CJsonString string = { .raw = key, .n_raw = strlen(key) };
+        size_t mask = index->n_buckets - 1;
+        uint64_t hash;
+
+        hash = c_json_string_hash(&string);
+        for (size_t i = hash & mask; index->buckets[i]; i = (i + 1) & mask) {
+                CJsonDocumentMember *member = &index->members[index->buckets[i] - 1];
+
+                if (member->hash == hash && !c_json_string_compare(&member->key, key))
+                        return member->value;
+        }
+
+        return C_JSON_DOCUMENT_NONE;
+}
+
+/*
+ * Looks for @key in the first C_JSON_DOCUMENT_INDEX_MIN members of the
+ * object at @object.
+ *
+ * Return: 0 if the object was searched completely
+ *         1 if it is too large to be searched linearly
+ */
+static int c_json_document_scan(CJsonDocument *document, size_t object, const char *key, size_t *valuep) {
+        CJsonReader *reader = document->reader;
+        CJsonString name;
+        size_t n = 0;
+        int r = 0;
+
+        *valuep = C_JSON_DOCUMENT_NONE;
+
+        c_json_document_reader_begin(document, reader, object);
+        c_json_reader_enter_object(reader);
+
+        while (c_json_reader_more(reader)) {
+                if (n++ == C_JSON_DOCUMENT_INDEX_MIN) {
+                        r = 1;
+                        break;
+                }
+
+                c_json_reader_read_string_lazy(reader, &name);
+                if (!c_json_string_compare(&name, key)) {
+                        *valuep = reader->p - document->input;
+                        break;
+                }
+
+                c_json_reader_skip(reader);
+        }
+
+        /* the object is not read to its end, so only reset the reader */
+        reader->level = 0;
+        c_json_document_reader_end(reader);
+
+        return r;
+}
+
+/**
+ * c_json_document_new() - load a document for random access
+ * @documentp           return location
+ * @input               0-terminated input
+ * @max_depth           maximum nesting depth
+ *
+ * Validates @input as a whole, so that values in it can be looked up and
+ * read in any order afterwards. @input is not copied and must stay valid
+ * and unmodified until the document is freed.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         -EINVAL if @max_depth is larger than C_JSON_VALIDATE_DEPTH_MAX
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
+ */
+_c_public_ int c_json_document_new(CJsonDocument **documentp, const char *input, size_t max_depth) {
+        _c_cleanup_(c_json_document_freep) CJsonDocument *document = NULL;
+        int r;
+
+        document = calloc(1, sizeof(*document));
+        if (!document)
+                return -ENOMEM;
+
+        document->input = input;
+        document->n_input = strlen(input);
+        document->root = skip_space(input) - input;
+
+        r = c_json_validate(input, document->n_input, max_depth, NULL);
+        if (r)
+                return r;
+
+        r = c_json_reader_new(&document->reader, max_depth);
+        if (r)
+                return r;
+
+        *documentp = document;
+        document = NULL;
+        return 0;
+}
+
+/**
+ * c_json_document_free() - free a document
+ * @document            document to free, or NULL
+ *
+ * Return: NULL
+ */
+_c_public_ CJsonDocument * c_json_document_free(CJsonDocument *document) {
+        if (!document)
+                return NULL;
+
+        for (size_t i = 0; i < document->n_slots; i += 1)
+                c_json_document_index_free(document->indexes[i]);
+
+        free(document->indexes);
+        c_json_reader_free(document->reader);
+        free(document);
+
+        return NULL;
+}
+
+/**
+ * c_json_document_root() - get the root value of a document
+ * @document            document object
+ *
+ * Return: the offset of the root value in the input
+ */
+_c_public_ size_t c_json_document_root(CJsonDocument *document) {
+        return document->root;
+}
+
+/**
+ * c_json_document_lookup() - look up an object member
+ * @document            document object
+ * @object              offset of an object in the input
+ * @key                 key to look up
+ * @valuep              return location for the offset of the value
+ *
+ * Finds the first member of the object at @object whose decoded key
+ * equals @key. Objects with up to C_JSON_DOCUMENT_INDEX_MIN members are
+ * searched linearly on each lookup. Larger objects get a hash index
+ * over their raw keys on the first lookup that does not find the key
+ * among their first members, and are never parsed again afterwards.
+ *
+ * If there is no such member, *@valuep is set to C_JSON_DOCUMENT_NONE.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         C_JSON_E_INVALID_TYPE if there is no object at @object
+ */
+_c_public_ int c_json_document_lookup(CJsonDocument *document, size_t object, const char *key, size_t *valuep) {
+        CJsonDocumentIndex *index;
+        int r;
+
+        if (object >= document->n_input || document->input[object] != '{')
+                return C_JSON_E_INVALID_TYPE;
+
+        index = c_json_document_find_index(document, object);
+        if (!index) {
+                r = c_json_document_scan(document, object, key, valuep);
+                if (!r)
+                        return 0;
+
+                r = c_json_document_build_index(document, object, &index);
+                if (r)
+                        return r;
+
+                r = c_json_document_add_index(document, index);
+                if (r) {
+                        c_json_document_index_free(index);
+                        return r;
+                }
+        }
+
+        *valuep = c_json_document_index_lookup(index, key);
+        return 0;
+}
+
+/**
+ * c_json_document_begin_read() - begin reading a value of a document
+ * @document            document object
+ * @reader              reader object
+ * @value               offset of the value in the input
+ *
+ * Points @reader at the value at @value, which can then be read with the
+ * reader functions. Reading ends behind that value, the rest of the
+ * input is ignored. Unlike c_json_reader_begin_read(), this does not
+ * look at the input again.
+ *
+ * It is an error to call this function multiple times without calling
+ * c_json_document_end_read().
+ */
+_c_public_ void c_json_document_begin_read(CJsonDocument *document, CJsonReader *reader, size_t value) {
+        c_json_document_reader_begin(document, reader, value);
+}
+
+/**
+ * c_json_document_end_read() - end reading a value of a document
+ * @document            document object
+ * @reader              reader object
+ *
+ * Like c_json_reader_end_read(), but the rest of the input behind the
+ * value passed to c_json_document_begin_read() is not looked at.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a reader function
+ *         C_JSON_E_INVALID_TYPE if called inside of a container
+ */
+_c_public_ int c_json_document_end_read(CJsonDocument *document, CJsonReader *reader) {
+        return c_json_document_reader_end(reader);
+}
@@ -0,0 +1,406 @@
+#pragma once
+
+/*
+ * Inline variants of the hot reader functions
+ *
+ * The functions below are the implementation of c_json_reader_peek(),
+ * c_json_reader_more(), c_json_reader_read_null(), c_json_reader_read_bool()
+ * and of entering and exiting containers. The library compiles its
+ * exported functions from them, so both variants behave identically.
+ *
+ * Callers that walk documents token by token can use the *_inline()
+ * variants directly to avoid a library call per token and to let the
+ * compiler keep the reader state in registers across them. They access
+ * the reader's internals, so code using them must be built against the
+ * exact version of the library it runs with, preferably by linking it
+ * statically.
+ */
+
+#include <c-stdaux.h>
+#include <stdbool.h>
+#include <string.h>
+#include "c-json.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct CJsonReader {
+        const char *input;
+
+        /*
+         * End of the valid UTF-8 prefix of the input. Points to the
+         * terminating 0-byte unless the input contains invalid UTF-8.
+         */
+        const char *verified;
+
+        /*
+         * Current position in the input. Always points to the start of
+         * the next value.
+         */
+        const char *p;
+
+        /*
+         * Last error code. If it is non-zero, every function turns into
+         * a no-op and returns this value.
+         */
+        int poison;
+
+        /* C_JSON_READER_* flags */
+        unsigned int flags;
+
+        /* whether the input may be modified, see c_json_reader_begin_read_mutable() */
+        bool writable;
+
+        /*
+         * Offset of @p in the input when reading last ended with an error,
+         * see c_json_reader_error_offset().
+         */
+        size_t error_offset;
+
+        /*
+         * Bytes of input c_json_reader_parse() may consume per call, or
+         * 0 for no limit. While it is suspended, @parse_base is the level
+         * the value it reads started on.
+         */
+        size_t budget;
+        size_t parse_base;
+        bool parse_suspended;
+
+        /*
+         * Limits, with SIZE_MAX where there is none, and what is left of
+         * the per-document ones. @members counts the ',' seen on each
+         * nesting level.
+         */
+        CJsonLimits limits;
+        size_t n_strings_left;
+        size_t n_values_left;
+        size_t *members;
+
+        /*
+         * State for each nesting level. @n_states is the maximum
+         * nesting depth. For each level, the state can be:
+         *
+         *  0: root level
+         *
+         *  '[': in an array and @p points to the next value or ']'
+         *  ',': in an array and @p is behind a ','
+         *
+         *  '{': in an object and @p points to the next key
+         *  ':': in an object and @p points to the next value
+         */
+        size_t n_states;
+        size_t level;
+        char states[];
+};
+
+static inline bool c_json_is_whitespace(char c) {
+        switch (c) {
+        case ' ':
+                return true;
+        case '\t':
+                return true;
+        case '\n':
+                return true;
+        case '\r':
+                return true;
+        default:
+                return false;
+        }
+}
+
+static inline const char * c_json_skip_space(const char *p) {
+        while (c_json_is_whitespace(*p))
+                p += 1;
+
+        return p;
+}
+
+/*
+ * Counts a ',' on the current level against the member limit.
+ */
+static inline int c_json_reader_count_member(CJsonReader *reader) {
+        if (_c_unlikely_(++reader->members[reader->level] >= reader->limits.max_members))
+                return (reader->poison = C_JSON_E_TOO_MANY_MEMBERS);
+
+        return 0;
+}
+
+/*
+ * Counts the value or key at reader->p against the value limit. Values
+ * are counted before they are read, so nothing is allocated for a value
+ * beyond the limit.
+ */
+static inline int c_json_reader_count_value(CJsonReader *reader) {
+        if (_c_unlikely_(!reader->n_values_left))
+                return (reader->poison = C_JSON_E_TOO_MANY_VALUES);
+
+        reader->n_values_left -= 1;
+        return 0;
+}
+
+/*
+ * Advances reader->p to the start of the next value, and counts it. Must
+ * be called excactly once after a value has been read.
+ */
+static inline int c_json_reader_advance_inline(CJsonReader *reader) {
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        reader->p = c_json_skip_space(reader->p);
+
+        switch (reader->states[reader->level]) {
+                case '[':
+                        if (*reader->p == ',') {
+                                if (c_json_reader_count_member(reader))
+                                        return reader->poison;
+                                reader->states[reader->level] = ',';
+                                reader->p = c_json_skip_space(reader->p + 1);
+                                return c_json_reader_count_value(reader);
+                        } else if (*reader->p != ']')
+                                return (reader->poison = C_JSON_E_INVALID_JSON);
+                        break;
+
+                case ',':
+                        if (*reader->p == ',') {
+                                if (c_json_reader_count_member(reader))
+                                        return reader->poison;
+                                reader->p = c_json_skip_space(reader->p + 1);
+                                return c_json_reader_count_value(reader);
+                        } else if (*reader->p == ']')
+                                reader->states[reader->level] = '[';
+                        else
+                                return (reader->poison = C_JSON_E_INVALID_JSON);
+                        break;
+
+                case '{':
+                        if (*reader->p == ':') {
+                                reader->states[reader->level] = ':';
+                                reader->p = c_json_skip_space(reader->p + 1);
+                                return c_json_reader_count_value(reader);
+                        }
+                        else
+                                return (reader->poison = C_JSON_E_INVALID_JSON);
+                        break;
+
+                case ':':
+                        if (*reader->p == ',') {
+                                if (c_json_reader_count_member(reader))
+                                        return reader->poison;
+                                reader->states[reader->level] = '{';
+                                reader->p = c_json_skip_space(reader->p + 1);
+                                if (*reader->p != '"')
+                                        return (reader->poison = C_JSON_E_INVALID_JSON);
+                                return c_json_reader_count_value(reader);
+                        } else if (*reader->p != '}')
+                                return (reader->poison = C_JSON_E_INVALID_JSON);
+                        break;
+        }
+
+        return 0;
+}
+
+static inline int c_json_reader_peek_inline(CJsonReader *reader) {
+        if (_c_unlikely_(reader->poison))
+                return -1;
+
+        switch (*reader->p) {
+                case '[':
+                        return C_JSON_TYPE_ARRAY;
+
+                case '{':
+                        return C_JSON_TYPE_OBJECT;
+
+                case '"':
+                        return C_JSON_TYPE_STRING;
+
+                case '0':
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                case '8':
+                case '9':
+                case '-':
+                        return C_JSON_TYPE_NUMBER;
+
+                case 't':
+                case 'f':
+                        return C_JSON_TYPE_BOOLEAN;
+
+                case 'n':
+                        return C_JSON_TYPE_NULL;
+
+                default:
+                case ']':
+                case '}':
+                        return -1;
+        }
+}
+
+static inline int c_json_reader_read_null_inline(CJsonReader *reader) {
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        if (reader->states[reader->level] == '{')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        switch (*reader->p) {
+                case 'n':
+                        if (strncmp(reader->p, "null", strlen("null")))
+                                return (reader->poison = C_JSON_E_INVALID_JSON);
+                        reader->p += strlen("null");
+                        break;
+
+                default:
+                        return (reader->poison = C_JSON_E_INVALID_TYPE);
+        }
+
+        return c_json_reader_advance_inline(reader);
+}
+
+static inline int c_json_reader_read_bool_inline(CJsonReader *reader, bool *boolp) {
+        bool b;
+        int r;
+
+        if (reader->states[reader->level] == '{')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        switch (*reader->p) {
+                case 't':
+                        if (strncmp(reader->p, "true", strlen("true")))
+                                return (reader->poison = C_JSON_E_INVALID_JSON);
+                        b = true;
+                        reader->p += strlen("true");
+                        break;
+
+                case 'f':
+                        if (strncmp(reader->p, "false", strlen("false")))
+                                return (reader->poison = C_JSON_E_INVALID_JSON);
+                        b = false;
+                        reader->p += strlen("false");
+                        break;
+
+                default:
+                        return (reader->poison = C_JSON_E_INVALID_TYPE);
+        }
+
+        r = c_json_reader_advance_inline(reader);
+        if (r)
+                return r;
+
+        if (boolp)
+                *boolp = b;
+
+        return 0;
+}
+
+static inline bool c_json_reader_more_inline(CJsonReader *reader) {
+        if (_c_unlikely_(reader->poison))
+                return false;
+
+        if (!*reader->p)
+                return false;
+
+        switch (reader->states[reader->level]) {
+                case '[':
+                        return *reader->p != ']';
+
+                case '{':
+                case ':':
+                        return *reader->p != '}';
+        }
+
+        return true;
+}
+
+static inline int c_json_reader_enter_array_inline(CJsonReader *reader) {
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        if (reader->states[reader->level] == '{')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        if (*reader->p != '[')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        if (reader->level >= reader->n_states)
+                return (reader->poison = C_JSON_E_DEPTH_OVERFLOW);
+
+        reader->p = c_json_skip_space(reader->p + 1);
+        reader->states[++reader->level] = '[';
+        reader->members[reader->level] = 0;
+
+        if (*reader->p != ']')
+                return c_json_reader_count_value(reader);
+
+        return 0;
+}
+
+static inline int c_json_reader_exit_array_inline(CJsonReader *reader) {
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        if (reader->states[reader->level] != '[' && reader->states[reader->level] != ',')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        if (*reader->p != ']')
+                return (reader->poison = C_JSON_E_INVALID_JSON);
+
+        reader->p += 1;
+        reader->level -= 1;
+
+        return c_json_reader_advance_inline(reader);
+}
+
+static inline int c_json_reader_enter_object_inline(CJsonReader *reader) {
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        if (reader->states[reader->level] == '{')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        if (*reader->p != '{')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        if (reader->level >= reader->n_states)
+                return (reader->poison = C_JSON_E_DEPTH_OVERFLOW);
+
+        reader->p = c_json_skip_space(reader->p + 1);
+        if (*reader->p != '"' && *reader->p != '}')
+                return (reader->poison = C_JSON_E_INVALID_JSON);
+
+        reader->states[++reader->level] = '{';
+        reader->members[reader->level] = 0;
+
+        if (*reader->p == '"')
+                return c_json_reader_count_value(reader);
+
+        return 0;
+}
+
+static inline int c_json_reader_exit_object_inline(CJsonReader *reader) {
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        if (reader->states[reader->level] != '{' && reader->states[reader->level] != ':')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        if (*reader->p != '}')
+                return (reader->poison = C_JSON_E_INVALID_JSON);
+
+        reader->p += 1;
+        reader->level -= 1;
+
+        return c_json_reader_advance_inline(reader);
+}
+
+#ifdef __cplusplus
+}
+#endif
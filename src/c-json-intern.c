@@ -0,0 +1,330 @@
+
+#include <c-stdaux.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+typedef struct CJsonInternEntry CJsonInternEntry;
+
+struct CJsonInternEntry {
+        char *key;
+        size_t n_key;
+        uint64_t hash;
+};
+
+struct CJsonInternTable {
+        CJsonInternEntry *entries;
+        size_t n_entries;
+        size_t max_entries;
+
+        /* open addressing with linear probing, holds entry index + 1 */
+        size_t *buckets;
+        size_t n_buckets;
+
+        bool frozen;
+};
+
+static uint64_t c_json_intern_hash(const char *key, size_t n_key) {
+        uint64_t hash = UINT64_C(0xcbf29ce484222325);
+
+        /* FNV-1a, keys are short and mostly ASCII */
+        for (size_t i = 0; i < n_key; i += 1) {
+                hash ^= (uint8_t)key[i];
+                hash *= UINT64_C(0x100000001b3);
+        }
+
+        return hash;
+}
+
+static size_t c_json_intern_table_find(CJsonInternTable *table, const char *key, size_t n_key, uint64_t hash) {
+        size_t mask = table->n_buckets - 1;
+
+        if (!table->n_buckets)
+                return C_JSON_INTERN_NONE;
+
+        for (size_t i = hash & mask; table->buckets[i]; i = (i + 1) & mask) {
+                CJsonInternEntry *entry = &table->entries[table->buckets[i] - 1];
+
+                if (entry->hash == hash && entry->n_key == n_key && !memcmp(entry->key, key, n_key))
+                        return table->buckets[i] - 1;
+        }
+
+        return C_JSON_INTERN_NONE;
+}
+
+static int c_json_intern_table_grow(CJsonInternTable *table) {
+        size_t *buckets, n_buckets, mask;
+
+        n_buckets = table->n_buckets ? table->n_buckets * 2 : 64;
+        mask = n_buckets - 1;
+
+        buckets = calloc(n_buckets, sizeof(*buckets));
+        if (!buckets)
+                return -ENOMEM;
+
+        for (size_t id = 0; id < table->n_entries; id += 1) {
+                size_t i = table->entries[id].hash & mask;
+
+                while (buckets[i])
+                        i = (i + 1) & mask;
+
+                buckets[i] = id + 1;
+        }
+
+        free(table->buckets);
+        table->buckets = buckets;
+        table->n_buckets = n_buckets;
+
+        return 0;
+}
+
+static int c_json_intern_table_insert(CJsonInternTable *table, const char *key, size_t n_key, uint64_t hash, size_t *idp) {
+        CJsonInternEntry *entries;
+        size_t i, mask;
+        char *copy;
+        int r;
+
+        if ((table->n_entries + 1) * 2 > table->n_buckets) {
+                r = c_json_intern_table_grow(table);
+                if (r)
+                        return r;
+        }
+
+        entries = realloc(table->entries, (table->n_entries + 1) * sizeof(*entries));
+        if (!entries)
+                return -ENOMEM;
+        table->entries = entries;
+
+        copy = malloc(n_key + 1);
+        if (!copy)
+                return -ENOMEM;
+
+        memcpy(copy, key, n_key);
+        copy[n_key] = '\0';
+
+        table->entries[table->n_entries] = (CJsonInternEntry){
+                .key = copy,
+                .n_key = n_key,
+                .hash = hash,
+        };
+
+        mask = table->n_buckets - 1;
+        for (i = hash & mask; table->buckets[i]; i = (i + 1) & mask)
+                ;
+
+        table->buckets[i] = ++table->n_entries;
+        *idp = table->n_entries - 1;
+
+        return 0;
+}
+
+/**
+ * c_json_intern_table_new() - allocate an intern table
+ * @tablep:             return location
+ * @max_entries:        maximum number of keys
+ *
+ * Return: <0 on fatal failures
+ *         0 on success
+ */
+_c_public_ int c_json_intern_table_new(CJsonInternTable **tablep, size_t max_entries) {
+        CJsonInternTable *table;
+
+        table = calloc(1, sizeof(*table));
+        if (!table)
+                return -ENOMEM;
+
+        table->max_entries = max_entries;
+
+        *tablep = table;
+
+        return 0;
+}
+
+/**
+ * c_json_intern_table_free() - free an intern table
+ * @table:              table to free
+ *
+ * All strings returned from the table become invalid.
+ *
+ * Return: NULL
+ */
+_c_public_ CJsonInternTable * c_json_intern_table_free(CJsonInternTable *table) {
+        if (!table)
+                return NULL;
+
+        for (size_t i = 0; i < table->n_entries; i += 1)
+                free(table->entries[i].key);
+        free(table->entries);
+        free(table->buckets);
+        free(table);
+
+        return NULL;
+}
+
+/**
+ * c_json_intern_table_add() - add a key to an intern table
+ * @table               table object
+ * @key                 0-terminated key to add
+ * @idp                 return location for the ID of the key, or NULL
+ *
+ * Adds @key to @table, unless it is already present. IDs are assigned
+ * in the order keys are added, starting at 0.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         -ENOSPC if the table is full or frozen
+ */
+_c_public_ int c_json_intern_table_add(CJsonInternTable *table, const char *key, size_t *idp) {
+        size_t n_key = strlen(key), id;
+        uint64_t hash;
+        int r;
+
+        hash = c_json_intern_hash(key, n_key);
+
+        id = c_json_intern_table_find(table, key, n_key, hash);
+        if (id == C_JSON_INTERN_NONE) {
+                if (table->frozen || table->n_entries >= table->max_entries)
+                        return -ENOSPC;
+
+                r = c_json_intern_table_insert(table, key, n_key, hash, &id);
+                if (r)
+                        return r;
+        }
+
+        if (idp)
+                *idp = id;
+
+        return 0;
+}
+
+/**
+ * c_json_intern_table_get() - look up a key by its ID
+ * @table               table object
+ * @id                  ID of the key
+ *
+ * Return: the interned key, or NULL if @id is not known
+ */
+_c_public_ const char * c_json_intern_table_get(CJsonInternTable *table, size_t id) {
+        if (id >= table->n_entries)
+                return NULL;
+
+        return table->entries[id].key;
+}
+
+/**
+ * c_json_intern_table_freeze() - make an intern table read-only
+ * @table               table object
+ *
+ * After this call, no more keys are added to @table, neither explicitly
+ * nor by readers. A frozen table can be shared between readers on any
+ * number of threads.
+ */
+_c_public_ void c_json_intern_table_freeze(CJsonInternTable *table) {
+        table->frozen = true;
+}
+
+/**
+ * c_json_reader_read_interned() - read a string through an intern table
+ * @json                json object
+ * @table               intern table to look the string up in
+ * @stringp             return location for the interned string, or NULL
+ * @idp                 return location for the ID of the string, or NULL
+ *
+ * Reads a string, typically an object key, and looks it up in @table.
+ * If the string does not contain escape sequences, it is matched by its
+ * raw bytes in the input and neither decoded nor copied. Escaped strings
+ * are decoded on the stack before they are looked up.
+ *
+ * The returned string is owned by @table and stays valid until the table
+ * is freed, so interned strings can be compared by pointer or by ID.
+ *
+ * If the string is not in @table and @table is neither full nor frozen,
+ * it is added. Otherwise, *@stringp is set to NULL, *@idp is set to
+ * C_JSON_INTERN_NONE and the reader is not advanced, so the string can
+ * be read with c_json_reader_read_string() instead.
+ *
+ * Tables that are not frozen must not be used by multiple readers
+ * concurrently.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a reader function
+ *         C_JSON_E_INVALID_TYPE if then next value is not a string
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ */
+_c_public_ int c_json_reader_read_interned(CJsonReader *reader,
+                                           CJsonInternTable *table,
+                                           const char **stringp,
+                                           size_t *idp) {
+        char buffer[C_JSON_CHUNK_MAX];
+        const char *key, *end;
+        size_t n_key, id;
+        bool escaped;
+        uint64_t hash;
+        int r;
+
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        if (*reader->p != '"')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        end = reader->p + 1;
+        r = c_json_reader_scan_string(reader, &end, &escaped);
+        if (r) {
+                reader->p = end;
+                return (reader->poison = r);
+        }
+
+        key = reader->p + 1;
+        n_key = end - key;
+
+        if (escaped) {
+                const char *p = key;
+
+                /* the decoded key is never longer than the raw one */
+                if (n_key > sizeof(buffer) - 4)
+                        goto unknown;
+
+                r = c_json_decode_string(&p, reader->verified, buffer, sizeof(buffer), &n_key);
+                if (r)
+                        return (reader->poison = r);
+
+                key = buffer;
+        }
+
+        hash = c_json_intern_hash(key, n_key);
+        id = c_json_intern_table_find(table, key, n_key, hash);
+        if (id == C_JSON_INTERN_NONE) {
+                if (table->frozen || table->n_entries >= table->max_entries)
+                        goto unknown;
+
+                r = c_json_intern_table_insert(table, key, n_key, hash, &id);
+                if (r)
+                        return (reader->poison = r);
+        }
+
+        reader->p = end + 1;
+        r = c_json_reader_advance(reader);
+        if (r)
+                return r;
+
+        if (stringp)
+                *stringp = table->entries[id].key;
+        if (idp)
+                *idp = id;
+
+        return 0;
+
+unknown:
+        /* the string is charged again when it is read for real */
+        reader->n_strings_left += end - reader->p - 1;
+
+        if (stringp)
+                *stringp = NULL;
+        if (idp)
+                *idp = C_JSON_INTERN_NONE;
+
+        return 0;
+}
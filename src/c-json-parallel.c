@@ -0,0 +1,483 @@
+
+#include <c-stdaux.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+/* batches are handed to workers as a whole, so locking stays rare */
+#define C_JSON_PARALLEL_BATCH_ELEMENTS 1024
+#define C_JSON_PARALLEL_BATCH_BYTES (64 * 1024)
+
+typedef struct CJsonParallelBatch CJsonParallelBatch;
+typedef struct CJsonParallel CJsonParallel;
+
+struct CJsonParallelBatch {
+        size_t first;
+        size_t n_elements;
+        const char *starts[C_JSON_PARALLEL_BATCH_ELEMENTS];
+        size_t lengths[C_JSON_PARALLEL_BATCH_ELEMENTS];
+        void *results[C_JSON_PARALLEL_BATCH_ELEMENTS];
+
+        /* number of leading elements that produced a result */
+        size_t n_done;
+        bool done;
+};
+
+struct CJsonParallel {
+        size_t max_depth;
+        CJsonElementFn element_fn;
+        CJsonResultFn result_fn;
+        void *userdata;
+        unsigned int flags;
+
+        pthread_mutex_t lock;
+        pthread_cond_t cond;
+
+        /*
+         * Batches published by the scanner, and the indices of finished
+         * batches in the order they finished. Delivered batches are
+         * freed and their slot is cleared.
+         */
+        CJsonParallelBatch **batches;
+        size_t *finished;
+        size_t n_allocated;
+        size_t n_batches;
+        size_t n_claimed;
+        size_t n_finished;
+        size_t n_delivered;
+        bool scanned;
+        int r;
+};
+
+/*
+ * Bytes the structural pre-scan has to look at, outside and inside of
+ * strings. Everything else is skipped in a tight loop.
+ */
+static const bool c_json_parallel_structural[256] = {
+        ['\0'] = true,
+        ['"'] = true,
+        [','] = true,
+        ['['] = true,
+        [']'] = true,
+        ['{'] = true,
+        ['}'] = true,
+};
+
+static const bool c_json_parallel_string[256] = {
+        ['\0'] = true,
+        ['"'] = true,
+        ['\\'] = true,
+};
+
+static void c_json_parallel_fail(CJsonParallel *parallel, int r) {
+        if (r && !parallel->r)
+                parallel->r = r;
+}
+
+static int c_json_parallel_publish(CJsonParallel *parallel, CJsonParallelBatch *batch) {
+        pthread_mutex_lock(&parallel->lock);
+
+        if (parallel->n_batches >= parallel->n_allocated) {
+                size_t n_allocated = parallel->n_allocated ? parallel->n_allocated * 2 : 64;
+                CJsonParallelBatch **batches;
+                size_t *finished;
+
+                batches = realloc(parallel->batches, n_allocated * sizeof(*batches));
+                if (batches)
+                        parallel->batches = batches;
+
+                finished = realloc(parallel->finished, n_allocated * sizeof(*finished));
+                if (finished)
+                        parallel->finished = finished;
+
+                if (!batches || !finished) {
+                        pthread_mutex_unlock(&parallel->lock);
+                        return -ENOMEM;
+                }
+
+                parallel->n_allocated = n_allocated;
+        }
+
+        parallel->batches[parallel->n_batches++] = batch;
+        pthread_cond_broadcast(&parallel->cond);
+
+        pthread_mutex_unlock(&parallel->lock);
+
+        return 0;
+}
+
+/*
+ * Delivers the results of finished batches on the calling thread. Must be
+ * called with the lock held. If @wait is false, returns as soon as no more
+ * batches can be delivered without waiting.
+ */
+static void c_json_parallel_deliver(CJsonParallel *parallel, bool wait) {
+        while (parallel->n_delivered < parallel->n_batches || !parallel->scanned) {
+                CJsonParallelBatch *batch;
+                size_t index;
+                int r;
+
+                if (parallel->flags & C_JSON_PARALLEL_UNORDERED) {
+                        if (parallel->n_delivered < parallel->n_finished)
+                                index = parallel->finished[parallel->n_delivered];
+                        else
+                                index = SIZE_MAX;
+                } else {
+                        index = parallel->n_delivered;
+                        if (index >= parallel->n_batches || !parallel->batches[index]->done)
+                                index = SIZE_MAX;
+                }
+
+                if (index == SIZE_MAX) {
+                        if (!wait)
+                                return;
+
+                        pthread_cond_wait(&parallel->cond, &parallel->lock);
+                        continue;
+                }
+
+                batch = parallel->batches[index];
+                parallel->batches[index] = NULL;
+                parallel->n_delivered += 1;
+
+                pthread_mutex_unlock(&parallel->lock);
+
+                for (size_t i = 0; i < batch->n_done; i += 1) {
+                        if (!parallel->result_fn)
+                                break;
+
+                        r = parallel->result_fn(parallel->userdata, batch->first + i, batch->results[i]);
+                        if (r) {
+                                pthread_mutex_lock(&parallel->lock);
+                                c_json_parallel_fail(parallel, r);
+                                pthread_mutex_unlock(&parallel->lock);
+                        }
+                }
+
+                free(batch);
+
+                pthread_mutex_lock(&parallel->lock);
+        }
+}
+
+static const char * c_json_parallel_skip_string(const char *p) {
+        for (;;) {
+                while (!c_json_parallel_string[(uint8_t)*p])
+                        p += 1;
+
+                switch (*p) {
+                case '\0':
+                        return NULL;
+                case '"':
+                        return p + 1;
+                default:
+                        if (!p[1])
+                                return NULL;
+                        p += 2;
+                        break;
+                }
+        }
+}
+
+/*
+ * Finds the end of the element at @p. This is a structural pre-scan only:
+ * it tracks strings and nesting, but leaves validating the element to the
+ * reader on the worker.
+ */
+static const char * c_json_parallel_skip_element(const char *p) {
+        size_t depth = 0;
+
+        for (;;) {
+                while (!c_json_parallel_structural[(uint8_t)*p])
+                        p += 1;
+
+                switch (*p) {
+                case '\0':
+                        return NULL;
+                case '"':
+                        p = c_json_parallel_skip_string(p + 1);
+                        if (!p)
+                                return NULL;
+                        continue;
+                case ',':
+                        if (depth == 0)
+                                return p;
+                        break;
+                case '[':
+                case '{':
+                        depth += 1;
+                        break;
+                case ']':
+                case '}':
+                        if (depth == 0)
+                                return *p == ']' ? p : NULL;
+                        depth -= 1;
+                        break;
+                }
+
+                p += 1;
+        }
+}
+
+/*
+ * Splits the top-level array into batches of elements and publishes them
+ * to the workers as it goes, so parsing starts right away. In between, the
+ * results of finished batches are delivered.
+ */
+static int c_json_parallel_scan(CJsonParallel *parallel, const char *input) {
+        _c_cleanup_(c_freep) CJsonParallelBatch *batch = NULL;
+        const char *p, *end;
+        size_t n_elements = 0, n_bytes = 0;
+        int r;
+
+        p = skip_space(input);
+        if (*p != '[')
+                return C_JSON_E_INVALID_TYPE;
+
+        if (parallel->max_depth == 0)
+                return C_JSON_E_DEPTH_OVERFLOW;
+
+        p = skip_space(p + 1);
+        if (*p == ']')
+                goto out;
+
+        for (;;) {
+                end = c_json_parallel_skip_element(p);
+                if (!end || end == p)
+                        return C_JSON_E_INVALID_JSON;
+
+                if (!batch) {
+                        batch = calloc(1, sizeof(*batch));
+                        if (!batch)
+                                return -ENOMEM;
+
+                        batch->first = n_elements;
+                        n_bytes = 0;
+                }
+
+                batch->starts[batch->n_elements] = p;
+                batch->lengths[batch->n_elements] = end - p;
+                batch->n_elements += 1;
+                n_elements += 1;
+                n_bytes += end - p;
+
+                if (batch->n_elements >= C_JSON_PARALLEL_BATCH_ELEMENTS ||
+                    n_bytes >= C_JSON_PARALLEL_BATCH_BYTES ||
+                    *end == ']') {
+                        r = c_json_parallel_publish(parallel, batch);
+                        if (r)
+                                return r;
+                        batch = NULL;
+
+                        pthread_mutex_lock(&parallel->lock);
+                        r = parallel->r;
+                        c_json_parallel_deliver(parallel, false);
+                        pthread_mutex_unlock(&parallel->lock);
+
+                        /* stop scanning once something failed */
+                        if (r)
+                                return 0;
+                }
+
+                p = end;
+                if (*p == ']')
+                        break;
+
+                p = skip_space(p + 1);
+        }
+
+out:
+        p = skip_space(p + 1);
+        if (*p != '\0')
+                return C_JSON_E_INVALID_JSON;
+
+        return 0;
+}
+
+static int c_json_parallel_run_batch(CJsonParallel *parallel,
+                                     CJsonParallelBatch *batch,
+                                     CJsonReader *reader,
+                                     char **bufferp,
+                                     size_t *n_bufferp) {
+        for (size_t i = 0; i < batch->n_elements; i += 1) {
+                size_t n_element = batch->lengths[i];
+                int r, r_end;
+
+                /* readers need a 0-terminated input */
+                if (n_element + 1 > *n_bufferp) {
+                        size_t n_buffer = c_max(n_element + 1, *n_bufferp * 2);
+                        char *buffer;
+
+                        buffer = realloc(*bufferp, n_buffer);
+                        if (!buffer)
+                                return -ENOMEM;
+
+                        *bufferp = buffer;
+                        *n_bufferp = n_buffer;
+                }
+
+                memcpy(*bufferp, batch->starts[i], n_element);
+                (*bufferp)[n_element] = '\0';
+
+                c_json_reader_begin_read(reader, *bufferp);
+                r = parallel->element_fn(parallel->userdata, reader, batch->first + i, &batch->results[i]);
+                r_end = c_json_reader_end_read(reader);
+
+                if (!r)
+                        batch->n_done += 1;
+                if (r || r_end)
+                        return r ?: r_end;
+        }
+
+        return 0;
+}
+
+static void * c_json_parallel_worker(void *userdata) {
+        CJsonParallel *parallel = userdata;
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *buffer = NULL;
+        size_t n_buffer = 0;
+        int r;
+
+        r = c_json_reader_new(&reader, parallel->max_depth - 1);
+
+        pthread_mutex_lock(&parallel->lock);
+
+        c_json_parallel_fail(parallel, r);
+
+        for (;;) {
+                CJsonParallelBatch *batch;
+                size_t index;
+                bool failed;
+
+                if (parallel->n_claimed >= parallel->n_batches) {
+                        if (parallel->scanned)
+                                break;
+
+                        pthread_cond_wait(&parallel->cond, &parallel->lock);
+                        continue;
+                }
+
+                index = parallel->n_claimed++;
+                batch = parallel->batches[index];
+                failed = parallel->r;
+
+                pthread_mutex_unlock(&parallel->lock);
+
+                /* after a failure, batches are only marked as finished */
+                r = failed ? 0 : c_json_parallel_run_batch(parallel, batch, reader, &buffer, &n_buffer);
+
+                pthread_mutex_lock(&parallel->lock);
+
+                c_json_parallel_fail(parallel, r);
+                batch->done = true;
+                parallel->finished[parallel->n_finished++] = index;
+                pthread_cond_broadcast(&parallel->cond);
+        }
+
+        pthread_mutex_unlock(&parallel->lock);
+
+        return NULL;
+}
+
+/**
+ * c_json_read_array_parallel() - process the elements of an array on multiple threads
+ * @input               0-terminated input, a single array
+ * @max_depth           maximum nesting depth, including the array itself
+ * @n_threads           number of worker threads, or 0 for one per CPU
+ * @flags               C_JSON_PARALLEL_* flags
+ * @element_fn          callback run for each element on the workers
+ * @result_fn           callback run for each result on the calling thread, or NULL
+ * @userdata            user pointer passed to both callbacks
+ *
+ * Reads a document that consists of a single, large array, and processes
+ * its elements on @n_threads worker threads. The calling thread finds the
+ * element boundaries with a quick structural pre-scan, which only tracks
+ * strings and nesting, and hands out disjoint batches of elements while
+ * it goes. Each worker reads its elements with its own CJsonReader.
+ *
+ * @element_fn is called once for every element, with a reader positioned
+ * at the element, and must read exactly that one value. It can store a
+ * result in *@resultp. Element functions run concurrently and in no
+ * particular order.
+ *
+ * @result_fn is called on the calling thread for every element that was
+ * processed successfully, with the result stored by @element_fn. Results
+ * are delivered in the order of the elements, or in the order in which
+ * batches finish if C_JSON_PARALLEL_UNORDERED is set.
+ *
+ * If any callback fails or any element is malformed, no further elements
+ * are processed and the first error is returned. The results of elements
+ * that were processed before are still passed to @result_fn, so they can
+ * be released, but they are no longer complete.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the return value of a callback if it failed
+ *         C_JSON_E_INVALID_TYPE if the input is not an array
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
+ */
+_c_public_ int c_json_read_array_parallel(const char *input,
+                                          size_t max_depth,
+                                          size_t n_threads,
+                                          unsigned int flags,
+                                          CJsonElementFn element_fn,
+                                          CJsonResultFn result_fn,
+                                          void *userdata) {
+        CJsonParallel parallel = {
+                .max_depth = max_depth,
+                .element_fn = element_fn,
+                .result_fn = result_fn,
+                .userdata = userdata,
+                .flags = flags,
+                .lock = PTHREAD_MUTEX_INITIALIZER,
+                .cond = PTHREAD_COND_INITIALIZER,
+        };
+        _c_cleanup_(c_freep) pthread_t *threads = NULL;
+        size_t n_started;
+        int r;
+
+        if (n_threads == 0) {
+                long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+                n_threads = n_cpus > 0 ? (size_t)n_cpus : 1;
+        }
+
+        threads = calloc(n_threads, sizeof(*threads));
+        if (!threads)
+                return -ENOMEM;
+
+        for (n_started = 0; n_started < n_threads; n_started += 1) {
+                r = pthread_create(&threads[n_started], NULL, c_json_parallel_worker, &parallel);
+                if (r)
+                        break;
+        }
+
+        /* if some workers could be started, they take care of all batches */
+        if (n_started == 0)
+                return -r;
+
+        r = c_json_parallel_scan(&parallel, input);
+
+        pthread_mutex_lock(&parallel.lock);
+        c_json_parallel_fail(&parallel, r);
+        parallel.scanned = true;
+        pthread_cond_broadcast(&parallel.cond);
+        c_json_parallel_deliver(&parallel, true);
+        r = parallel.r;
+        pthread_mutex_unlock(&parallel.lock);
+
+        for (size_t i = 0; i < n_started; i += 1)
+                pthread_join(threads[i], NULL);
+
+        free(parallel.finished);
+        free(parallel.batches);
+        pthread_cond_destroy(&parallel.cond);
+        pthread_mutex_destroy(&parallel.lock);
+
+        return r;
+}
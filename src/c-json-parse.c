@@ -0,0 +1,321 @@
+
+#include <c-stdaux.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+/**
+ * c_json_reader_set_budget() - limit the work done per parser call
+ * @reader              reader object
+ * @n_budget            bytes of input to consume per call, or 0
+ *
+ * Makes c_json_reader_parse() return C_JSON_E_YIELD once it has consumed
+ * at least @n_budget bytes of input, rather than reading the whole value
+ * in one go. This lets a large value be parsed in slices, interleaved
+ * with other work. The budget is checked between the values nested in
+ * the value being read, so a single token can exceed it. 0 removes the
+ * limit, which is the default.
+ */
+_c_public_ void c_json_reader_set_budget(CJsonReader *reader, size_t n_budget) {
+        reader->budget = n_budget;
+}
+
+/**
+ * c_json_reader_parse() - read the next value and report it as events
+ * @reader              reader object
+ * @handler             callbacks to report events to
+ * @userdata            user pointer passed to the callbacks
+ *
+ * Reads the next value, including everything nested in it, and calls the
+ * callback in @handler for each token. Callbacks that are NULL are
+ * skipped. Keys and strings are passed as CJsonString handles, numbers as
+ * their text in the input. Both are borrowed from the input and are not
+ * decoded, see the c_json_string_*() helpers.
+ *
+ * Unlike the other reader functions, this does not return between
+ * tokens. The whole value is tokenized by a single loop that keeps its
+ * position and nesting state in local variables, and that is validated
+ * exactly like the other reader functions would.
+ *
+ * If a callback returns non-zero, parsing stops and the reader is
+ * poisoned with that value.
+ *
+ * If a budget was set with c_json_reader_set_budget() and is used up
+ * before the value was read completely, C_JSON_E_YIELD is returned. The
+ * reader is not poisoned, and calling this function again resumes where
+ * it left off. No other reader function may be called on @reader in
+ * between, except for c_json_reader_end_read() to abandon reading.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         C_JSON_E_YIELD if the budget is used up
+ *         the last error that occured in a reader function
+ *         the first non-zero value returned by a callback
+ *         C_JSON_E_INVALID_TYPE if an object key is expected
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
+ */
+_c_public_ int c_json_reader_parse(CJsonReader *reader, const CJsonHandler *handler, void *userdata) {
+        const char *p = reader->p, *start = p, *end_input = reader->verified, *end;
+        size_t base = reader->level, level = base, budget, n;
+        char *states = reader->states;
+        CJsonString string;
+        bool escaped;
+        int r = 0;
+
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        budget = reader->budget ?: SIZE_MAX;
+
+        if (reader->parse_suspended) {
+                reader->parse_suspended = false;
+                base = reader->parse_base;
+                goto next;
+        }
+
+        if (states[level] == '{')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        /* the value the reader started on was counted when the reader got to it */
+        goto value;
+
+count:
+        if (_c_unlikely_(!reader->n_values_left)) {
+                r = C_JSON_E_TOO_MANY_VALUES;
+                goto out;
+        }
+        reader->n_values_left -= 1;
+
+value:
+        switch (*p) {
+        case '{':
+                if (level >= reader->n_states) {
+                        r = C_JSON_E_DEPTH_OVERFLOW;
+                        goto out;
+                }
+
+                if (handler->begin_object) {
+                        r = handler->begin_object(userdata);
+                        if (r)
+                                goto out;
+                }
+
+                p = c_json_skip_space_wide(p + 1, end_input);
+                if (*p == '}') {
+                        p += 1;
+                        if (handler->end_object) {
+                                r = handler->end_object(userdata);
+                                if (r)
+                                        goto out;
+                        }
+                        goto next;
+                }
+
+                states[++level] = ':';
+                reader->members[level] = 0;
+                goto key;
+
+        case '[':
+                if (level >= reader->n_states) {
+                        r = C_JSON_E_DEPTH_OVERFLOW;
+                        goto out;
+                }
+
+                if (handler->begin_array) {
+                        r = handler->begin_array(userdata);
+                        if (r)
+                                goto out;
+                }
+
+                p = c_json_skip_space_wide(p + 1, end_input);
+                if (*p == ']') {
+                        p += 1;
+                        if (handler->end_array) {
+                                r = handler->end_array(userdata);
+                                if (r)
+                                        goto out;
+                        }
+                        goto next;
+                }
+
+                states[++level] = '[';
+                reader->members[level] = 0;
+                goto count;
+
+        case '"':
+                end = p + 1;
+                r = c_json_reader_scan_string(reader, &end, &escaped);
+                if (r) {
+                        p = end;
+                        goto out;
+                }
+
+                if (handler->string) {
+                        string = (CJsonString){ .raw = p + 1, .n_raw = end - p - 1, .escaped = escaped };
+                        r = handler->string(userdata, &string);
+                        if (r)
+                                goto out;
+                }
+
+                p = end + 1;
+                goto next;
+
+        case '-':
+        case '0' ... '9':
+                r = c_json_reader_scan_number(reader, p, &n);
+                if (r) {
+                        p += n;
+                        goto out;
+                }
+
+                if (handler->number) {
+                        r = handler->number(userdata, p, n);
+                        if (r)
+                                goto out;
+                }
+
+                p += n;
+                goto next;
+
+        case 't':
+        case 'f':
+                n = *p == 't' ? strlen("true") : strlen("false");
+                if (strncmp(p, *p == 't' ? "true" : "false", n)) {
+                        r = C_JSON_E_INVALID_JSON;
+                        goto out;
+                }
+
+                if (handler->boolean) {
+                        r = handler->boolean(userdata, *p == 't');
+                        if (r)
+                                goto out;
+                }
+
+                p += n;
+                goto next;
+
+        case 'n':
+                if (strncmp(p, "null", strlen("null"))) {
+                        r = C_JSON_E_INVALID_JSON;
+                        goto out;
+                }
+
+                if (handler->null) {
+                        r = handler->null(userdata);
+                        if (r)
+                                goto out;
+                }
+
+                p += strlen("null");
+                goto next;
+
+        default:
+                r = C_JSON_E_INVALID_JSON;
+                goto out;
+        }
+
+key:
+        if (*p != '"') {
+                r = C_JSON_E_INVALID_JSON;
+                goto out;
+        }
+
+        if (_c_unlikely_(!reader->n_values_left)) {
+                r = C_JSON_E_TOO_MANY_VALUES;
+                goto out;
+        }
+        reader->n_values_left -= 1;
+
+        end = p + 1;
+        r = c_json_reader_scan_string(reader, &end, &escaped);
+        if (r) {
+                p = end;
+                goto out;
+        }
+
+        if (handler->key) {
+                string = (CJsonString){ .raw = p + 1, .n_raw = end - p - 1, .escaped = escaped };
+                r = handler->key(userdata, &string);
+                if (r)
+                        goto out;
+        }
+
+        p = c_json_skip_space_wide(end + 1, end_input);
+        if (*p != ':') {
+                r = C_JSON_E_INVALID_JSON;
+                goto out;
+        }
+
+        p = c_json_skip_space_wide(p + 1, end_input);
+        goto count;
+
+next:
+        /* the level the value started on is left to the reader */
+        if (level == base)
+                goto out;
+
+        if (_c_unlikely_((size_t)(p - start) >= budget)) {
+                reader->p = p;
+                reader->level = level;
+                reader->parse_base = base;
+                reader->parse_suspended = true;
+                return C_JSON_E_YIELD;
+        }
+
+        p = c_json_skip_space_wide(p, end_input);
+
+        switch (states[level]) {
+        case '[':
+                if (*p == ',') {
+                        if (_c_unlikely_(++reader->members[level] >= reader->limits.max_members)) {
+                                r = C_JSON_E_TOO_MANY_MEMBERS;
+                                goto out;
+                        }
+                        p = c_json_skip_space_wide(p + 1, end_input);
+                        goto count;
+                } else if (*p == ']') {
+                        p += 1;
+                        level -= 1;
+                        if (handler->end_array) {
+                                r = handler->end_array(userdata);
+                                if (r)
+                                        goto out;
+                        }
+                        goto next;
+                }
+                break;
+
+        case ':':
+                if (*p == ',') {
+                        if (_c_unlikely_(++reader->members[level] >= reader->limits.max_members)) {
+                                r = C_JSON_E_TOO_MANY_MEMBERS;
+                                goto out;
+                        }
+                        p = c_json_skip_space_wide(p + 1, end_input);
+                        goto key;
+                } else if (*p == '}') {
+                        p += 1;
+                        level -= 1;
+                        if (handler->end_object) {
+                                r = handler->end_object(userdata);
+                                if (r)
+                                        goto out;
+                        }
+                        goto next;
+                }
+                break;
+        }
+
+        r = C_JSON_E_INVALID_JSON;
+
+out:
+        reader->p = p;
+        reader->level = level;
+
+        if (r)
+                return (reader->poison = r);
+
+        return c_json_reader_advance(reader);
+}
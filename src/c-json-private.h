@@ -0,0 +1,145 @@
+#pragma once
+
+/*
+ * Private definitions shared between the translation units of the library.
+ */
+
+#include <c-stdaux.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+#include "c-json-inline.h"
+
+bool c_json_reader_parse_number(const char *number, size_t n_max, size_t *n_numberp);
+int c_json_reader_advance(CJsonReader *reader);
+
+double c_json_parse_double(const char *number);
+
+int c_json_decode_string(const char **pp, const char *verified, char *dst, size_t n_dst, size_t *n_dstp);
+int c_json_scan_string(const char **pp, const char *verified, bool *escapedp);
+int c_json_skip_string(const char **pp, const char *verified, bool *escapedp);
+
+static inline bool is_whitespace(char c) {
+        return c_json_is_whitespace(c);
+}
+
+static inline const char * skip_space(const char *p) {
+        return c_json_skip_space(p);
+}
+
+/*
+ * Returns a word with the high bit set in each byte of @word that is 0,
+ * and all other bits clear.
+ */
+static inline uint64_t c_json_zero_bytes(uint64_t word) {
+        const uint64_t low = UINT64_C(0x7F7F7F7F7F7F7F7F);
+
+        return ~(((word & low) + low) | word) & ~low;
+}
+
+/*
+ * Like skip_space(), but skips long runs of whitespace, like the
+ * indentation of pretty-printed input, 8 bytes at a time. Single spaces
+ * take the same path as in skip_space(). Reads no further than @end.
+ */
+static inline const char * c_json_skip_space_wide(const char *p, const char *end) {
+        const uint64_t ones = UINT64_C(0x0101010101010101);
+        uint64_t word, space;
+
+        if (!is_whitespace(p[0]) || !is_whitespace(p[1]))
+                return skip_space(p);
+
+        for (p += 2; end - p >= 8; p += 8) {
+                memcpy(&word, p, 8);
+                space = c_json_zero_bytes(word ^ (' ' * ones)) |
+                        c_json_zero_bytes(word ^ ('\n' * ones)) |
+                        c_json_zero_bytes(word ^ ('\t' * ones)) |
+                        c_json_zero_bytes(word ^ ('\r' * ones));
+                if (space != 0x80 * ones)
+                        break;
+        }
+
+        return skip_space(p);
+}
+
+/*
+ * Returns the length of the run of characters that can occur in numbers
+ * at @p. Used instead of c_json_reader_parse_number() for trusted input,
+ * where the number is not checked against the grammar.
+ */
+static inline size_t c_json_skip_number(const char *p) {
+        const char *q = p;
+
+        for (;;) {
+                switch (*q) {
+                case '0' ... '9':
+                case '-':
+                case '+':
+                case '.':
+                case 'e':
+                case 'E':
+                        q += 1;
+                        break;
+                default:
+                        return q - p;
+                }
+        }
+}
+
+/*
+ * Finds the end of the number at @p for @reader, see
+ * c_json_reader_parse_number(). With C_JSON_READER_TRUSTED, only its
+ * extent is determined. Parsing stops one byte after the length limit.
+ */
+static inline int c_json_reader_scan_number(CJsonReader *reader, const char *p, size_t *n_numberp) {
+        size_t n_max = reader->limits.max_number;
+        bool valid;
+
+        if (reader->flags & C_JSON_READER_TRUSTED) {
+                *n_numberp = c_json_skip_number(p);
+                valid = *n_numberp > 0;
+        } else {
+                valid = c_json_reader_parse_number(p, n_max < SIZE_MAX ? n_max + 1 : n_max, n_numberp);
+        }
+
+        if (_c_unlikely_(*n_numberp > n_max))
+                return C_JSON_E_NUMBER_TOO_LONG;
+
+        return valid ? 0 : C_JSON_E_INVALID_JSON;
+}
+
+/*
+ * Counts a string of @n_string bytes in the input against the limits of
+ * @reader. The input length bounds the decoded length, so this is done
+ * before anything is decoded or allocated.
+ */
+static inline int c_json_reader_count_string(CJsonReader *reader, size_t n_string) {
+        if (_c_unlikely_(n_string > reader->limits.max_string))
+                return C_JSON_E_STRING_TOO_LONG;
+
+        if (_c_unlikely_(n_string > reader->n_strings_left))
+                return C_JSON_E_STRINGS_TOO_LARGE;
+
+        reader->n_strings_left -= n_string;
+        return 0;
+}
+
+/*
+ * Finds the end of the string contents at *@pp for @reader, see
+ * c_json_scan_string(). With C_JSON_READER_TRUSTED, only escape sequences
+ * are checked.
+ */
+static inline int c_json_reader_scan_string(CJsonReader *reader, const char **pp, bool *escapedp) {
+        const char *start = *pp;
+        int r;
+
+        if (reader->flags & C_JSON_READER_TRUSTED)
+                r = c_json_skip_string(pp, reader->verified, escapedp);
+        else
+                r = c_json_scan_string(pp, reader->verified, escapedp);
+        if (r)
+                return r;
+
+        return c_json_reader_count_string(reader, *pp - start);
+}
@@ -6,53 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "c-json.h"
-
-struct CJsonReader {
-        const char *input;
-
-        /*
-         * Current position in the input. Always points to the start of
-         * the next value.
-         */
-        const char *p;
-
-        /*
-         * Last error code. If it is non-zero, every function turns into
-         * a no-op and returns this value.
-         */
-        int poison;
-
-        /*
-         * State for each nesting level. @n_states is the maximum
-         * nesting depth. For each level, the state can be:
-         *
-         *  0: root level
-         *
-         *  '[': in an array and @p points to the next value or ']'
-         *  ',': in an array and @p is behind a ','
-         *
-         *  '{': in an object and @p points to the next key
-         *  ':': in an object and @p points to the next value
-         */
-        size_t n_states;
-        size_t level;
-        char states[];
-};
-
-static bool is_whitespace(char c) {
-        switch (c) {
-        case ' ':
-                return true;
-        case '\t':
-                return true;
-        case '\n':
-                return true;
-        case '\r':
-                return true;
-        default:
-                return false;
-        }
-}
+#include "c-json-private.h"
 
 static bool is_end_of_number(char c) {
         switch (c) {
@@ -81,11 +35,18 @@ enum {
         JSON_NUMBER_STATE_EXPONENT,
 };
 
-static bool c_json_reader_parse_number(const char *number, size_t *n_numberp) {
+/*
+ * Parses the number at @number, looking at no more than @n_max bytes.
+ * Sets *@n_numberp to the length of the number, or to the offset of the
+ * faulty byte if it is malformed.
+ *
+ * Return: true if @number starts with a valid number
+ */
+bool c_json_reader_parse_number(const char *number, size_t n_max, size_t *n_numberp) {
         size_t n_number = 0;
         int state = JSON_NUMBER_STATE_INIT;
 
-        while (!is_end_of_number(*number)) {
+        while (n_number < n_max && !is_end_of_number(*number)) {
                 switch (state) {
                 case JSON_NUMBER_STATE_INIT:
                         switch (*number) {
@@ -99,7 +60,7 @@ static bool c_json_reader_parse_number(const char *number, size_t *n_numberp) {
                                 state = JSON_NUMBER_STATE_SIGNIFICAND;
                                 break;
                         default:
-                                return false;
+                                goto invalid;
                         }
                         break;
                 case JSON_NUMBER_STATE_SIGN:
@@ -111,7 +72,7 @@ static bool c_json_reader_parse_number(const char *number, size_t *n_numberp) {
                                 state = JSON_NUMBER_STATE_SIGNIFICAND;
                                 break;
                         default:
-                                return false;
+                                goto invalid;
                         }
                         break;
                 case JSON_NUMBER_STATE_NULL:
@@ -124,7 +85,7 @@ static bool c_json_reader_parse_number(const char *number, size_t *n_numberp) {
                                 state = JSON_NUMBER_STATE_EXPONENT_MARKER;
                                 break;
                         default:
-                                return false;
+                                goto invalid;
                         }
                         break;
                 case JSON_NUMBER_STATE_SIGNIFICAND:
@@ -139,7 +100,7 @@ static bool c_json_reader_parse_number(const char *number, size_t *n_numberp) {
                                 state = JSON_NUMBER_STATE_EXPONENT_MARKER;
                                 break;
                         default:
-                                return false;
+                                goto invalid;
                         }
                         break;
                 case JSON_NUMBER_STATE_DECIMAL_POINT:
@@ -148,7 +109,7 @@ static bool c_json_reader_parse_number(const char *number, size_t *n_numberp) {
                                 state = JSON_NUMBER_STATE_FRACTION;
                                 break;
                         default:
-                                return false;
+                                goto invalid;
                         }
                         break;
                 case JSON_NUMBER_STATE_FRACTION:
@@ -160,7 +121,7 @@ static bool c_json_reader_parse_number(const char *number, size_t *n_numberp) {
                                 state = JSON_NUMBER_STATE_EXPONENT_MARKER;
                                 break;
                         default:
-                                return false;
+                                goto invalid;
                         }
                         break;
                 case JSON_NUMBER_STATE_EXPONENT_MARKER:
@@ -173,7 +134,7 @@ static bool c_json_reader_parse_number(const char *number, size_t *n_numberp) {
                                 state = JSON_NUMBER_STATE_EXPONENT_SIGN;
                                 break;
                         default:
-                                return false;
+                                goto invalid;
                         }
                         break;
                 case JSON_NUMBER_STATE_EXPONENT_SIGN:
@@ -182,7 +143,7 @@ static bool c_json_reader_parse_number(const char *number, size_t *n_numberp) {
                                 state = JSON_NUMBER_STATE_EXPONENT;
                                 break;
                         default:
-                                return false;
+                                goto invalid;
                         }
                         break;
                 case JSON_NUMBER_STATE_EXPONENT:
@@ -190,7 +151,7 @@ static bool c_json_reader_parse_number(const char *number, size_t *n_numberp) {
                         case '0' ... '9':
                                 break;
                         default:
-                                return false;
+                                goto invalid;
                         }
                         break;
                 }
@@ -205,71 +166,66 @@ static bool c_json_reader_parse_number(const char *number, size_t *n_numberp) {
         case JSON_NUMBER_STATE_EXPONENT:
                 break;
         default:
-                return false;
+                goto invalid;
         }
 
         if (n_numberp)
                 *n_numberp = n_number;
         return true;
-}
-
-static const char * skip_space(const char *p) {
-        while (is_whitespace(*p))
-                p += 1;
 
-        return p;
+invalid:
+        if (n_numberp)
+                *n_numberp = n_number;
+        return false;
 }
 
 /*
- * Advances reader->p to the start of the next value. Must be called
- * excactly once after a value has been read.
+ * Out-of-line c_json_reader_advance_inline(), for the readers in the other
+ * translation units.
  */
-static int c_json_reader_advance(CJsonReader *reader) {
-        if (_c_unlikely_(reader->poison))
-                return reader->poison;
-
-        reader->p = skip_space(reader->p);
-
-        switch (reader->states[reader->level]) {
-                case '[':
-                        if (*reader->p == ',') {
-                                reader->states[reader->level] = ',';
-                                reader->p = skip_space(reader->p + 1);
-                        } else if (*reader->p != ']')
-                                return (reader->poison = C_JSON_E_INVALID_JSON);
-                        break;
-
-                case ',':
-                        if (*reader->p == ',')
-                                reader->p = skip_space(reader->p + 1);
-                        else if (*reader->p == ']')
-                                reader->states[reader->level] = '[';
-                        else
-                                return (reader->poison = C_JSON_E_INVALID_JSON);
-                        break;
-
-                case '{':
-                        if (*reader->p == ':') {
-                                reader->states[reader->level] = ':';
-                                reader->p = skip_space(reader->p + 1);
-                        }
-                        else
-                                return (reader->poison = C_JSON_E_INVALID_JSON);
-                        break;
+int c_json_reader_advance(CJsonReader *reader) {
+        return c_json_reader_advance_inline(reader);
+}
 
-                case ':':
-                        if (*reader->p == ',') {
-                                reader->states[reader->level] = '{';
-                                reader->p = skip_space(reader->p + 1);
-                                if (*reader->p != '"')
-                                        return (reader->poison = C_JSON_E_INVALID_JSON);
-                        } else if (*reader->p != '}')
-                                return (reader->poison = C_JSON_E_INVALID_JSON);
-                        break;
-        }
+/* maps the characters of single-character escapes to their values, everything else to 0 */
+static const uint8_t c_json_escape_table[256] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x22, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2f,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5c, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x00,
+        0x00, 0x00, 0x0d, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
 
-        return 0;
-}
+/* maps hex digits to their values, everything else to 0xff */
+static const uint8_t c_json_hex_table[256] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
 
 /*
  * Reads a single utf-16 code unit and writes it to @unitp. Does not
@@ -279,67 +235,342 @@ static int c_json_reader_advance(CJsonReader *reader) {
  *         C_JSON_E_INVALID_JSON if @p does not point to a valid sequence
  */
 static int c_json_reader_read_utf16_unit(const char *p, uint16_t *unitp) {
-        uint8_t digits[4];
+        uint16_t unit = 0;
 
         for (size_t i = 0; i < 4; i += 1) {
-                switch (p[i]) {
-                        case '0' ... '9':
-                                digits[i] = p[i] - '0';
-                                break;
-
-                        case 'a' ... 'f':
-                                digits[i] = p[i] - 'a' + 0x0a;
-                                break;
+                uint8_t digit = c_json_hex_table[(uint8_t)p[i]];
 
-                        case 'A' ... 'F':
-                                digits[i] = p[i] - 'A' + 0x0a;
-                                break;
+                /* stop at the first invalid digit, it might be the 0-terminator */
+                if (digit == 0xff)
+                        return C_JSON_E_INVALID_JSON;
 
-                        default:
-                                return C_JSON_E_INVALID_JSON;
-                }
+                unit = unit << 4 | digit;
         }
 
-        *unitp = digits[0] << 12 | digits[1] << 8 | digits[2] << 4 | digits[3];
+        *unitp = unit;
 
         return 0;
 }
 
-static int c_json_reader_write_utf8(uint32_t cp, FILE *stream) {
+static size_t c_json_reader_write_utf8(uint32_t cp, char *p) {
         switch (cp) {
         case  0x0000 ...   0x007F:
-                if (fputc((char)cp, stream) < 0)
-                        return -ENOTRECOVERABLE;
-                break;
+                p[0] = (char)cp;
+                return 1;
         case  0x0080 ...   0x07FF:
-                if (fputc((char)(0xc0 | (cp >> 6)), stream) < 0)
-                        return -ENOTRECOVERABLE;
-                if (fputc((char)(0x80 | (cp & 0x3f)), stream) < 0)
-                        return -ENOTRECOVERABLE;
-                break;
+                p[0] = (char)(0xc0 | (cp >> 6));
+                p[1] = (char)(0x80 | (cp & 0x3f));
+                return 2;
         case  0x0800 ...   0xFFFF:
-                if (fputc((char)(0xe0 | (cp >> 12)), stream) < 0)
-                        return -ENOTRECOVERABLE;
-                if (fputc((char)(0x80 | ((cp >> 6) & 0x3f)), stream) < 0)
-                        return -ENOTRECOVERABLE;
-                if (fputc((char)(0x80 | (cp & 0x3f)), stream) < 0)
-                        return -ENOTRECOVERABLE;
-                break;
+                p[0] = (char)(0xe0 | (cp >> 12));
+                p[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+                p[2] = (char)(0x80 | (cp & 0x3f));
+                return 3;
         case 0x10000 ... 0x10FFFF:
-                if (fputc((char)(0xf0 | (cp >> 18)), stream) < 0)
-                        return -ENOTRECOVERABLE;
-                if (fputc((char)(0x80 | ((cp >> 12) & 0x3f)), stream) < 0)
-                        return -ENOTRECOVERABLE;
-                if (fputc((char)(0x80 | ((cp >> 6) & 0x3f)), stream) < 0)
-                        return -ENOTRECOVERABLE;
-                if (fputc((char)(0x80 | (cp & 0x3f)), stream) < 0)
-                        return -ENOTRECOVERABLE;
-                break;
+                p[0] = (char)(0xf0 | (cp >> 18));
+                p[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+                p[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+                p[3] = (char)(0x80 | (cp & 0x3f));
+                return 4;
         default:
                 assert(0);
+                return 0;
         }
+}
 
-        return 0;
+/*
+ * Decodes the string contents at *@pp into @dst, resolving escape
+ * sequences and validating UTF-8. Decoding stops in front of the
+ * closing '"', or when less than 4 bytes are left in @dst, so that a
+ * chunk never ends in the middle of a UTF-8 sequence. @n_dst must be at
+ * least 4.
+ *
+ * The input up to @verified is known to be valid UTF-8, so multi-byte
+ * sequences that end before it are copied without checking them again.
+ * Pass *@pp if nothing is known about the input.
+ *
+ * @dst may point into the input itself, as long as it does not lie behind
+ * *@pp. Decoding never makes the contents longer, so it never overwrites
+ * input it has not read yet.
+ *
+ * On return, *@pp points to the next byte to decode, or to the faulty
+ * byte if the string is malformed. @n_dstp is set to the number of
+ * bytes written to @dst in either case.
+ *
+ * Return: 0 on success
+ *         C_JSON_E_INVALID_JSON if the string is malformed
+ */
+int c_json_decode_string(const char **pp, const char *verified, char *dst, size_t n_dst, size_t *n_dstp) {
+        const char *p = *pp;
+        char *d = dst, *end = dst + n_dst - 4;
+        int r = 0;
+
+        while (*p != '"' && d <= end) {
+                switch ((uint8_t)*p) {
+                case 0x00 ... 0x1F:
+                        r = C_JSON_E_INVALID_JSON;
+                        goto out;
+                case '\\':
+                        p += 1;
+                        switch (*p) {
+                                case 'u': {
+                                        uint16_t cu;
+                                        uint32_t cp;
+
+                                        p += 1;
+
+                                        r = c_json_reader_read_utf16_unit(p, &cu);
+                                        if (r)
+                                                goto out;
+                                        p += 4;
+
+                                        switch (cu) {
+                                        case 0xD800 ... 0xDBFF:
+                                                cp = 0x10000 + ((cu - 0xD800) << 10);
+
+                                                if (p[0] != '\\' || p[1] != 'u') {
+                                                        r = C_JSON_E_INVALID_JSON;
+                                                        goto out;
+                                                }
+                                                p += 2;
+
+                                                r = c_json_reader_read_utf16_unit(p, &cu);
+                                                if (r)
+                                                        goto out;
+                                                p += 4;
+
+                                                if (cu < 0xDC00 || cu > 0xDFFF) {
+                                                        r = C_JSON_E_INVALID_JSON;
+                                                        goto out;
+                                                }
+
+                                                cp += cu - 0xDC00;
+
+                                                break;
+                                        case 0xDC00 ... 0xDFFF:
+                                                r = C_JSON_E_INVALID_JSON;
+                                                goto out;
+                                        default:
+                                                cp = cu;
+                                                break;
+                                        }
+
+                                        d += c_json_reader_write_utf8(cp, d);
+                                        break;
+                                }
+
+                                default:
+                                        if (!c_json_escape_table[(uint8_t)*p]) {
+                                                r = C_JSON_E_INVALID_JSON;
+                                                goto out;
+                                        }
+
+                                        *d++ = (char)c_json_escape_table[(uint8_t)*p++];
+                                        break;
+                        }
+                        break;
+                case 0x20 ... '\\' - 1:
+                case '\\' + 1 ... 0x7F:
+                        *d++ = *p++;
+                        break;
+                case 0xC2 ... 0xF4:
+                {
+                        size_t n_seq = (uint8_t)*p < 0xE0 ? 2 : (uint8_t)*p < 0xF0 ? 3 : 4;
+
+                        if (_c_unlikely_(verified - p < (ptrdiff_t)n_seq)) {
+                                const char *str = p;
+                                size_t n_str = n_seq;
+
+                                c_utf8_verify(&str, &n_str);
+
+                                if (n_str != 0) {
+                                        r = C_JSON_E_INVALID_JSON;
+                                        goto out;
+                                }
+                        }
+
+                        memmove(d, p, n_seq);
+                        d += n_seq;
+                        p += n_seq;
+
+                        break;
+                }
+                default:
+                        r = C_JSON_E_INVALID_JSON;
+                        goto out;
+                }
+        }
+
+out:
+        *pp = p;
+        *n_dstp = d - dst;
+        return r;
+}
+
+/*
+ * Validates the string contents at *@pp like c_json_decode_string(), but
+ * without decoding them. Runs of plain ASCII are skipped directly, escape
+ * sequences and multi-byte sequences are passed through the decoder one
+ * at a time, so both follow the exact same rules. @verified is passed on
+ * to the decoder.
+ *
+ * On return, *@pp points to the closing '"', or to the faulty byte if the
+ * string is malformed. @escapedp is set to whether the string contains
+ * escape sequences, that is, whether its raw bytes differ from its
+ * decoded contents.
+ *
+ * Return: 0 on success
+ *         C_JSON_E_INVALID_JSON if the string is malformed
+ */
+int c_json_scan_string(const char **pp, const char *verified, bool *escapedp) {
+        const char *p = *pp;
+        bool escaped = false;
+        char scratch[4];
+        size_t n_scratch;
+        int r = 0;
+
+        for (;;) {
+                switch ((uint8_t)*p) {
+                case '"':
+                        goto out;
+                case 0x20 ... '"' - 1:
+                case '"' + 1 ... '\\' - 1:
+                case '\\' + 1 ... 0x7F:
+                        p += 1;
+                        break;
+                case '\\':
+                        escaped = true;
+                        /* fallthrough */
+                default:
+                        r = c_json_decode_string(&p, verified, scratch, sizeof(scratch), &n_scratch);
+                        if (r)
+                                goto out;
+                        break;
+                }
+        }
+
+out:
+        *pp = p;
+        if (escapedp)
+                *escapedp = escaped;
+        return r;
+}
+
+/*
+ * Like c_json_scan_string(), but for input that is known to be valid.
+ * Everything but escape sequences is skipped without looking at it, so
+ * control characters and invalid UTF-8 are not noticed. Escape sequences
+ * are still decoded, so that the contents can be decoded later without
+ * failing.
+ *
+ * Return: 0 on success
+ *         C_JSON_E_INVALID_JSON if the end of the input or a malformed
+ *         escape sequence is reached
+ */
+int c_json_skip_string(const char **pp, const char *verified, bool *escapedp) {
+        const char *p = *pp;
+        bool escaped = false;
+        char scratch[4];
+        size_t n_scratch;
+        int r = 0;
+
+        for (;;) {
+                switch (*p) {
+                case '"':
+                        goto out;
+                case '\\':
+                        escaped = true;
+                        r = c_json_decode_string(&p, verified, scratch, sizeof(scratch), &n_scratch);
+                        if (r)
+                                goto out;
+                        break;
+                case '\0':
+                        r = C_JSON_E_INVALID_JSON;
+                        goto out;
+                default:
+                        p += 1;
+                        break;
+                }
+        }
+
+out:
+        *pp = p;
+        if (escapedp)
+                *escapedp = escaped;
+        return r;
+}
+
+/*
+ * Reads the string at the current position and passes its decoded
+ * contents to @fn in chunks of at most C_JSON_CHUNK_MAX bytes. If @fn
+ * is NULL, the string is only validated.
+ */
+static int c_json_reader_read_chunks(CJsonReader *reader, CJsonChunkFn fn, void *userdata) {
+        char buffer[C_JSON_CHUNK_MAX];
+        size_t n_buffer, n_raw = 0;
+        int r;
+
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        if (*reader->p != '"')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        reader->p += 1;
+        if (!fn) {
+                r = c_json_reader_scan_string(reader, &reader->p, NULL);
+                if (r)
+                        return (reader->poison = r);
+        } else {
+                /* the string is not measured upfront, so count it as it is decoded */
+                do {
+                        const char *chunk = reader->p;
+
+                        r = c_json_decode_string(&reader->p, reader->verified, buffer, sizeof(buffer), &n_buffer);
+                        if (r)
+                                return (reader->poison = r);
+
+                        n_raw += reader->p - chunk;
+                        if (_c_unlikely_(n_raw > reader->limits.max_string))
+                                return (reader->poison = C_JSON_E_STRING_TOO_LONG);
+
+                        r = c_json_reader_count_string(reader, reader->p - chunk);
+                        if (r)
+                                return (reader->poison = r);
+
+                        if (n_buffer) {
+                                r = fn(userdata, buffer, n_buffer);
+                                if (r)
+                                        return (reader->poison = r);
+                        }
+                } while (*reader->p != '"');
+        }
+
+        reader->p += 1; /* '"' */
+
+        return c_json_reader_advance(reader);
+}
+
+/*
+ * Returns the length of the raw string contents at @p, up to the first
+ * unescaped '"' or the 0-terminator. The contents are not validated, this
+ * is only an upper bound for the length of the decoded string.
+ */
+static size_t c_json_reader_measure_string(const char *p) {
+        const char *q = p;
+
+        for (;;) {
+                switch (*q) {
+                case '\0':
+                case '"':
+                        return q - p;
+                case '\\':
+                        if (q[1])
+                                q += 1;
+                        break;
+                }
+                q += 1;
+        }
 }
 
 /**
@@ -357,7 +588,12 @@ _c_public_ int c_json_reader_new(CJsonReader **readerp, size_t max_depth) {
         if (!reader)
                 return -ENOMEM;
 
+        reader->members = calloc(max_depth + 1, sizeof(*reader->members));
+        if (!reader->members)
+                return -ENOMEM;
+
         reader->n_states = max_depth;
+        c_json_reader_set_limits(reader, &(CJsonLimits){});
 
         *readerp = reader;
         reader = NULL;
@@ -375,11 +611,74 @@ _c_public_ CJsonReader * c_json_reader_free(CJsonReader *reader) {
         if (!reader)
                 return NULL;
 
+        free(reader->members);
         free(reader);
 
         return NULL;
 }
 
+/**
+ * c_json_reader_set_flags() - configure how input is checked
+ * @reader              reader object
+ * @flags               C_JSON_READER_* flags
+ *
+ * With C_JSON_READER_TRUSTED, the input is assumed to be valid JSON, for
+ * instance because it was produced or validated by the caller before.
+ * The UTF-8 encoding of the input is not verified, and neither are
+ * control characters in strings nor the grammar of numbers. Malformed
+ * input is still never read out of bounds, but it is not guaranteed to
+ * be rejected, nor which error is returned for it.
+ *
+ * It is an error to call this function between c_json_reader_begin_read()
+ * and c_json_reader_end_read().
+ */
+_c_public_ void c_json_reader_set_flags(CJsonReader *reader, unsigned int flags) {
+        assert(!reader->input);
+
+        reader->flags = flags;
+}
+
+/**
+ * c_json_reader_set_limits() - limit the resources a document may use
+ * @reader              reader object
+ * @limits              limits, 0 for no limit
+ *
+ * Sets limits that are enforced in addition to the maximum nesting depth,
+ * so that reading hostile input cannot take unbounded memory or time.
+ * Each limit has its own error code, which poisons the reader like other
+ * errors do:
+ *
+ *  @max_input: bytes of input, checked before anything else is read
+ *              (C_JSON_E_INPUT_TOO_LARGE)
+ *  @max_string: bytes of a single string (C_JSON_E_STRING_TOO_LONG)
+ *  @max_strings: bytes of all strings, including object keys
+ *                (C_JSON_E_STRINGS_TOO_LARGE)
+ *  @max_values: values, including object keys (C_JSON_E_TOO_MANY_VALUES)
+ *  @max_number: bytes of a single number (C_JSON_E_NUMBER_TOO_LONG)
+ *  @max_members: values in a single array or members in a single object
+ *                (C_JSON_E_TOO_MANY_MEMBERS)
+ *
+ * Strings are measured by their length in the input, which is never less
+ * than their decoded length, and are checked before they are decoded or
+ * allocated. The totals apply per document, from one call to
+ * c_json_reader_begin_read() to the next.
+ *
+ * It is an error to call this function between c_json_reader_begin_read()
+ * and c_json_reader_end_read().
+ */
+_c_public_ void c_json_reader_set_limits(CJsonReader *reader, const CJsonLimits *limits) {
+        assert(!reader->input);
+
+        reader->limits = (CJsonLimits){
+                .max_input = limits->max_input ?: SIZE_MAX,
+                .max_string = limits->max_string ?: SIZE_MAX,
+                .max_strings = limits->max_strings ?: SIZE_MAX,
+                .max_values = limits->max_values ?: SIZE_MAX,
+                .max_number = limits->max_number ?: SIZE_MAX,
+                .max_members = limits->max_members ?: SIZE_MAX,
+        };
+}
+
 /**
  * c_json_reader_peek - peek at the next value
  * @json                json object
@@ -391,35 +690,7 @@ _c_public_ CJsonReader * c_json_reader_free(CJsonReader *reader) {
  *         one of the C_JSON_TYPE_ values
  */
 _c_public_ int c_json_reader_peek(CJsonReader *reader) {
-        if (_c_unlikely_(reader->poison))
-                return -1;
-
-        switch (*reader->p) {
-                case '[':
-                        return C_JSON_TYPE_ARRAY;
-
-                case '{':
-                        return C_JSON_TYPE_OBJECT;
-
-                case '"':
-                        return C_JSON_TYPE_STRING;
-
-                case '0' ... '9':
-                case '-':
-                        return C_JSON_TYPE_NUMBER;
-
-                case 't':
-                case 'f':
-                        return C_JSON_TYPE_BOOLEAN;
-
-                case 'n':
-                        return C_JSON_TYPE_NULL;
-
-                default:
-                case ']':
-                case '}':
-                        return -1;
-        }
+        return c_json_reader_peek_inline(reader);
 }
 
 /**
@@ -427,14 +698,55 @@ _c_public_ int c_json_reader_peek(CJsonReader *reader) {
  * @json                json object
  * @string              0-terminated string to read from
  *
+ * The UTF-8 encoding of @string is verified upfront in a single pass, so
+ * that reading strings does not need to check every multi-byte sequence
+ * on its own. Invalid UTF-8 is still only reported once it is read. With
+ * C_JSON_READER_TRUSTED, it is not verified at all.
+ *
  * It is an error to call this function multiple times without calling
  * c_json_reader_end_read().
  */
 _c_public_ void c_json_reader_begin_read(CJsonReader *reader, const char *string) {
+        size_t n_max = reader->limits.max_input, n_verified;
+        const char *verified = string;
+
         assert(!reader->input);
 
         reader->input = string;
+        reader->n_strings_left = reader->limits.max_strings;
+        /* the first value is counted right away, the limit is at least 1 */
+        reader->n_values_left = reader->limits.max_values - 1;
+
+        /* oversized input is rejected without looking at more than the limit */
+        n_verified = strnlen(string, n_max < SIZE_MAX ? n_max + 1 : n_max);
+        if (n_verified > n_max) {
+                reader->p = string;
+                reader->verified = string;
+                reader->poison = C_JSON_E_INPUT_TOO_LARGE;
+                return;
+        }
+
         reader->p = skip_space(reader->input);
+
+        if (reader->flags & C_JSON_READER_TRUSTED)
+                verified += n_verified;
+        else
+                c_utf8_verify(&verified, &n_verified);
+
+        reader->verified = verified;
+}
+
+/**
+ * c_json_reader_begin_read_mutable() - begin reading JSON from a mutable string
+ * @json                json object
+ * @string              0-terminated string to read from
+ *
+ * Like c_json_reader_begin_read(), but allows strings to be read with
+ * c_json_reader_read_string_in_place(), which modifies @string.
+ */
+_c_public_ void c_json_reader_begin_read_mutable(CJsonReader *reader, char *string) {
+        c_json_reader_begin_read(reader, string);
+        reader->writable = true;
 }
 
 /**
@@ -461,14 +773,37 @@ _c_public_ int c_json_reader_end_read(CJsonReader *reader) {
                         r = C_JSON_E_INVALID_JSON;
         }
 
+        if (r)
+                reader->error_offset = reader->p - reader->input;
+
         reader->level = 0;
         reader->input = NULL;
+        reader->verified = NULL;
         reader->p = NULL;
         reader->poison = 0;
+        reader->writable = false;
+        reader->parse_suspended = false;
 
         return r;
 }
 
+/**
+ * c_json_reader_error_offset() - locate the last error
+ * @json                json object
+ *
+ * Returns where in the input the error returned by the last failed call
+ * to c_json_reader_end_read() was detected. This is the position the
+ * reader stopped at, which is the faulty byte for malformed input, or
+ * the start of the value for errors like C_JSON_E_INVALID_TYPE. The
+ * position is only taken once reading ends, so nothing is tracked while
+ * reading. See c_json_locate() to turn it into a line and column.
+ *
+ * Return: the offset of the last error in the input
+ */
+_c_public_ size_t c_json_reader_error_offset(CJsonReader *reader) {
+        return reader->error_offset;
+}
+
 /**
  * c_json_reader_read_null() - read `null` value
  * @json                json object
@@ -480,24 +815,7 @@ _c_public_ int c_json_reader_end_read(CJsonReader *reader) {
  *         C_JSON_E_INVALID_JSON if the JSON input is malformed
  */
 _c_public_ int c_json_reader_read_null(CJsonReader *reader) {
-        if (_c_unlikely_(reader->poison))
-                return reader->poison;
-
-        if (reader->states[reader->level] == '{')
-                return (reader->poison = C_JSON_E_INVALID_TYPE);
-
-        switch (*reader->p) {
-                case 'n':
-                        if (strncmp(reader->p, "null", strlen("null")))
-                                return (reader->poison = C_JSON_E_INVALID_JSON);
-                        reader->p += strlen("null");
-                        break;
-
-                default:
-                        return (reader->poison = C_JSON_E_INVALID_TYPE);
-        }
-
-        return c_json_reader_advance(reader);
+        return c_json_reader_read_null_inline(reader);
 }
 
 /**
@@ -514,214 +832,292 @@ _c_public_ int c_json_reader_read_null(CJsonReader *reader) {
  *         C_JSON_E_INVALID_JSON if the JSON input is malformed
  */
 _c_public_ int c_json_reader_read_string(CJsonReader *reader, char **stringp) {
-        _c_cleanup_(c_fclosep) FILE *stream = NULL;
         _c_cleanup_(c_freep) char *string = NULL;
-        size_t size;
+        size_t n_raw, n_string;
         int r;
 
         if (_c_unlikely_(reader->poison))
                 return reader->poison;
 
+        if (!stringp)
+                return c_json_reader_read_chunks(reader, NULL, NULL);
+
         if (*reader->p != '"')
                 return (reader->poison = C_JSON_E_INVALID_TYPE);
 
-        stream = open_memstream(&string, &size);
-        if (!stream)
-                return (reader->poison = -ENOTRECOVERABLE);
+        /*
+         * Decoding never makes a string longer, so the raw length is
+         * enough to decode the whole string in one go. The decoder needs
+         * 4 bytes of headroom, one of which holds the 0-terminator.
+         */
+        n_raw = c_json_reader_measure_string(reader->p + 1);
+        r = c_json_reader_count_string(reader, n_raw);
+        if (r)
+                return (reader->poison = r);
 
-        reader->p += 1;
-        while (*reader->p != '"') {
-                switch ((uint8_t)*reader->p) {
-                case 0x00 ... 0x1F:
-                        return (reader->poison = C_JSON_E_INVALID_JSON);
-                case '\\':
-                        reader->p += 1;
-                        switch (*reader->p) {
-                                case '"':
-                                        reader->p += 1;
-                                        if (fputc('"', stream) < 0)
-                                                return (reader->poison = -ENOTRECOVERABLE);
-                                        break;
+        string = malloc(n_raw + 4);
+        if (!string)
+                return (reader->poison = -ENOMEM);
 
-                                case '\\':
-                                        reader->p += 1;
-                                        if (fputc('\\', stream) < 0)
-                                                return (reader->poison = -ENOTRECOVERABLE);
-                                        break;
+        reader->p += 1;
+        r = c_json_decode_string(&reader->p, reader->verified, string, n_raw + 4, &n_string);
+        if (r)
+                return (reader->poison = r);
 
-                                case '/':
-                                        reader->p += 1;
-                                        if (fputc('/', stream) < 0)
-                                                return (reader->poison = -ENOTRECOVERABLE);
-                                        break;
+        /* trusted input with invalid UTF-8 can hide the closing '"' */
+        if (*reader->p != '"')
+                return (reader->poison = C_JSON_E_INVALID_JSON);
+        string[n_string] = '\0';
+        reader->p += 1; /* '"' */
 
-                                case 'b':
-                                        reader->p += 1;
-                                        if (fputc('\b', stream) < 0)
-                                                return (reader->poison = -ENOTRECOVERABLE);
-                                        break;
+        r = c_json_reader_advance(reader);
+        if (r)
+                return r;
 
-                                case 'f':
-                                        reader->p += 1;
-                                        if (fputc('\f', stream) < 0)
-                                                return (reader->poison = -ENOTRECOVERABLE);
-                                        break;
+        *stringp = string;
+        string = NULL;
 
-                                case 'n':
-                                        reader->p += 1;
-                                        if (fputc('\n', stream) < 0)
-                                                return (reader->poison = -ENOTRECOVERABLE);
-                                        break;
+        return 0;
+}
 
-                                case 'r':
-                                        reader->p += 1;
-                                        if (fputc('\r', stream) < 0)
-                                                return (reader->poison = -ENOTRECOVERABLE);
-                                        break;
+/**
+ * c_json_reader_read_string_in_place() - read a string without copying it
+ * @json                json object
+ * @srtringp            return location for the string
+ *
+ * Reads a string like c_json_reader_read_string(), but decodes it into
+ * the input itself, rather than into a new allocation. Escape sequences
+ * are never shorter than what they decode to, so the decoded string fits
+ * into the raw one, and its 0-terminator replaces the closing '"' at the
+ * latest. The returned string is valid as long as the input is.
+ *
+ * Reading must have been started with c_json_reader_begin_read_mutable().
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a reader function
+ *         C_JSON_E_INVALID_TYPE if then next value is not a string
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ */
+_c_public_ int c_json_reader_read_string_in_place(CJsonReader *reader, char **stringp) {
+        size_t n_raw, n_string;
+        char *string;
+        int r;
 
-                                case 't':
-                                        reader->p += 1;
-                                        if (fputc('\t', stream) < 0)
-                                                return (reader->poison = -ENOTRECOVERABLE);
-                                        break;
+        assert(reader->writable);
 
-                                case 'u': {
-                                        uint16_t cu;
-                                        uint32_t cp;
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
 
-                                        reader->p += 1;
+        if (*reader->p != '"')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
 
-                                        r = c_json_reader_read_utf16_unit(reader->p, &cu);
-                                        if (r)
-                                                return (reader->poison = r);
-                                        reader->p += 4;
+        /*
+         * The destination never gets ahead of the source, the raw length
+         * only bounds it like in c_json_reader_read_string().
+         */
+        string = (char *)reader->p + 1;
+        n_raw = c_json_reader_measure_string(string);
+        r = c_json_reader_count_string(reader, n_raw);
+        if (r)
+                return (reader->poison = r);
 
-                                        switch (cu) {
-                                        case 0xD800 ... 0xDBFF:
-                                                cp = 0x10000 + ((cu - 0xD800) << 10);
+        reader->p += 1;
+        r = c_json_decode_string(&reader->p, reader->verified, string, n_raw + 4, &n_string);
+        if (r)
+                return (reader->poison = r);
 
-                                                if (reader->p[0] != '\\' || reader->p[1] != 'u')
-                                                        return (reader->poison = C_JSON_E_INVALID_JSON);
-                                                reader->p +=2;
+        /* trusted input with invalid UTF-8 can hide the closing '"' */
+        if (*reader->p != '"')
+                return (reader->poison = C_JSON_E_INVALID_JSON);
 
-                                                r = c_json_reader_read_utf16_unit(reader->p, &cu);
-                                                if (r)
-                                                        return (reader->poison = r);
-                                                reader->p += 4;
+        reader->p += 1; /* '"' */
+        string[n_string] = '\0';
 
-                                                if (cu < 0xDC00 || cu > 0xDFFF)
-                                                        return (reader->poison = C_JSON_E_INVALID_JSON);
+        r = c_json_reader_advance(reader);
+        if (r)
+                return r;
 
-                                                cp += cu - 0xDC00;
+        *stringp = string;
+        return 0;
+}
 
-                                                break;
-                                        case 0xDC00 ... 0xDFFF:
-                                                return (reader->poison = C_JSON_E_INVALID_JSON);
-                                        default:
-                                                cp = cu;
-                                                break;
-                                        }
+/**
+ * c_json_reader_read_string_chunked() - read a string in chunks
+ * @json                json object
+ * @fn                  callback to pass the chunks to
+ * @userdata            user pointer passed to @fn
+ *
+ * Reads a string like c_json_reader_read_string(), but rather than
+ * building the whole string in memory, passes its decoded contents to
+ * @fn in chunks of at most C_JSON_CHUNK_MAX bytes. Chunks are not
+ * 0-terminated and never end in the middle of a UTF-8 sequence. Only
+ * a fixed-size buffer on the stack is used, regardless of the length of
+ * the string.
+ *
+ * If @fn returns non-zero, reading stops and its return value is
+ * returned and recorded as the error of the reader.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a reader function
+ *         the return value of @fn if it failed
+ *         C_JSON_E_INVALID_TYPE if then next value is not a string
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ */
+_c_public_ int c_json_reader_read_string_chunked(CJsonReader *reader, CJsonChunkFn fn, void *userdata) {
+        return c_json_reader_read_chunks(reader, fn, userdata);
+}
 
-                                        r = c_json_reader_write_utf8(cp, stream);
-                                        if (r)
-                                                return (reader->poison = r);
+/* maps the base64 alphabet to its values, everything else to 0xff */
+static const uint8_t c_json_base64_table[256] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+        0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+        0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
 
-                                        break;
-                                }
+typedef struct CJsonBase64 {
+        CJsonChunkFn fn;
+        void *userdata;
 
-                                default:
-                                        return (reader->poison = C_JSON_E_INVALID_JSON);
-                        }
-                        break;
-                case 0x20 ... '\\' - 1:
-                case '\\' + 1 ... 0x7F:
-                        if (fputc(*reader->p, stream) < 0)
-                                return (reader->poison = -ENOTRECOVERABLE);
-                        reader->p += 1;
-                        break;
-                case 0xC2 ... 0xDF:
-                {
-                        const char *str = reader->p;
-                        size_t n_str = 2;
+        /* pending sextets of the current quantum and padding seen */
+        uint32_t bits;
+        size_t n_sextets;
+        size_t n_padding;
 
-                        c_utf8_verify(&str, &n_str);
+        size_t n_buffer;
+        char buffer[C_JSON_CHUNK_MAX];
+} CJsonBase64;
 
-                        if (n_str != 0)
-                                return (reader->poison = C_JSON_E_INVALID_JSON);
+static int c_json_base64_flush(CJsonBase64 *base64) {
+        int r;
 
-                        if (fputc(*reader->p, stream) < 0)
-                                return (reader->poison = -ENOTRECOVERABLE);
-                        reader->p += 1;
-                        if (fputc(*reader->p, stream) < 0)
-                                return (reader->poison = -ENOTRECOVERABLE);
-                        reader->p += 1;
+        if (!base64->n_buffer)
+                return 0;
 
-                        break;
-                }
-                case 0xE0 ... 0xEF:
-                {
-                        const char *str = reader->p;
-                        size_t n_str = 3;
+        r = base64->fn(base64->userdata, base64->buffer, base64->n_buffer);
+        if (r)
+                return r;
 
-                        c_utf8_verify(&str, &n_str);
+        base64->n_buffer = 0;
 
-                        if (n_str != 0)
-                                return (reader->poison = C_JSON_E_INVALID_JSON);
+        return 0;
+}
 
-                        if (fputc(*reader->p, stream) < 0)
-                                return (reader->poison = -ENOTRECOVERABLE);
-                        reader->p += 1;
-                        if (fputc(*reader->p, stream) < 0)
-                                return (reader->poison = -ENOTRECOVERABLE);
-                        reader->p += 1;
-                        if (fputc(*reader->p, stream) < 0)
-                                return (reader->poison = -ENOTRECOVERABLE);
-                        reader->p += 1;
+static int c_json_base64_feed(void *userdata, const char *chunk, size_t n_chunk) {
+        CJsonBase64 *base64 = userdata;
+        int r;
 
-                        break;
-                }
-                case 0xF0 ... 0xF4:
-                {
-                        const char *str = reader->p;
-                        size_t n_str = 4;
-
-                        c_utf8_verify(&str, &n_str);
-
-                        if (n_str != 0)
-                                return (reader->poison = C_JSON_E_INVALID_JSON);
-
-                        if (fputc(*reader->p, stream) < 0)
-                                return (reader->poison = -ENOTRECOVERABLE);
-                        reader->p += 1;
-                        if (fputc(*reader->p, stream) < 0)
-                                return (reader->poison = -ENOTRECOVERABLE);
-                        reader->p += 1;
-                        if (fputc(*reader->p, stream) < 0)
-                                return (reader->poison = -ENOTRECOVERABLE);
-                        reader->p += 1;
-                        if (fputc(*reader->p, stream) < 0)
-                                return (reader->poison = -ENOTRECOVERABLE);
-                        reader->p += 1;
+        for (size_t i = 0; i < n_chunk; i += 1) {
+                uint8_t sextet = c_json_base64_table[(uint8_t)chunk[i]];
 
-                        break;
+                if (sextet == 0xff) {
+                        if (chunk[i] != '=' || base64->n_sextets < 2 ||
+                            base64->n_sextets + ++base64->n_padding > 4)
+                                return C_JSON_E_INVALID_TYPE;
+                        continue;
                 }
-                default:
-                        return (reader->poison = C_JSON_E_INVALID_JSON);
+
+                if (base64->n_padding)
+                        return C_JSON_E_INVALID_TYPE;
+
+                base64->bits = base64->bits << 6 | sextet;
+                if (++base64->n_sextets < 4)
+                        continue;
+
+                if (base64->n_buffer + 3 > sizeof(base64->buffer)) {
+                        r = c_json_base64_flush(base64);
+                        if (r)
+                                return r;
                 }
+
+                base64->buffer[base64->n_buffer++] = (char)(base64->bits >> 16);
+                base64->buffer[base64->n_buffer++] = (char)(base64->bits >> 8);
+                base64->buffer[base64->n_buffer++] = (char)base64->bits;
+                base64->bits = 0;
+                base64->n_sextets = 0;
         }
 
-        reader->p += 1; /* '"' */
+        return 0;
+}
 
-        stream = c_fclose(stream);
+static int c_json_base64_finish(CJsonBase64 *base64) {
+        int r;
 
-        r = c_json_reader_advance(reader);
+        if (base64->n_padding && base64->n_sextets + base64->n_padding != 4)
+                return C_JSON_E_INVALID_TYPE;
+
+        if (base64->n_buffer + 2 > sizeof(base64->buffer)) {
+                r = c_json_base64_flush(base64);
+                if (r)
+                        return r;
+        }
+
+        switch (base64->n_sextets) {
+        case 0:
+                break;
+        case 2:
+                base64->buffer[base64->n_buffer++] = (char)(base64->bits >> 4);
+                break;
+        case 3:
+                base64->buffer[base64->n_buffer++] = (char)(base64->bits >> 10);
+                base64->buffer[base64->n_buffer++] = (char)(base64->bits >> 2);
+                break;
+        default:
+                return C_JSON_E_INVALID_TYPE;
+        }
+
+        return c_json_base64_flush(base64);
+}
+
+/**
+ * c_json_reader_read_base64() - read a base64 encoded string in chunks
+ * @json                json object
+ * @fn                  callback to pass the chunks to
+ * @userdata            user pointer passed to @fn
+ *
+ * Reads a string like c_json_reader_read_string_chunked(), and decodes
+ * its contents as base64 (RFC 4648, standard alphabet) on the fly. The
+ * decoded bytes are passed to @fn in chunks of at most C_JSON_CHUNK_MAX
+ * bytes. Trailing padding is optional, whitespace is not allowed.
+ *
+ * If @fn returns non-zero, reading stops and its return value is
+ * returned and recorded as the error of the reader.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a reader function
+ *         the return value of @fn if it failed
+ *         C_JSON_E_INVALID_TYPE if then next value is not a base64 string
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ */
+_c_public_ int c_json_reader_read_base64(CJsonReader *reader, CJsonChunkFn fn, void *userdata) {
+        CJsonBase64 base64 = {
+                .fn = fn,
+                .userdata = userdata,
+        };
+        int r;
+
+        r = c_json_reader_read_chunks(reader, c_json_base64_feed, &base64);
         if (r)
                 return r;
 
-        if (stringp) {
-                *stringp = string;
-                string = NULL;
-        }
+        r = c_json_base64_finish(&base64);
+        if (r)
+                return (reader->poison = r);
 
         return 0;
 }
@@ -750,8 +1146,11 @@ _c_public_ int c_json_reader_read_number(CJsonReader *reader, const char **numbe
         if (reader->states[reader->level] == '{')
                 return (reader->poison = C_JSON_E_INVALID_TYPE);
 
-        if (!c_json_reader_parse_number(reader->p, &n_number))
-                return (reader->poison = C_JSON_E_INVALID_JSON);
+        r = c_json_reader_scan_number(reader, reader->p, &n_number);
+        if (r) {
+                reader->p += n_number;
+                return (reader->poison = r);
+        }
 
         number = reader->p;
         reader->p += n_number;
@@ -780,42 +1179,7 @@ _c_public_ int c_json_reader_read_number(CJsonReader *reader, const char **numbe
  *         C_JSON_E_INVALID_JSON if the JSON input is malformed
  */
 _c_public_ int c_json_reader_read_bool(CJsonReader *reader, bool *boolp) {
-        bool b;
-        int r;
-
-        if (reader->states[reader->level] == '{')
-                return (reader->poison = C_JSON_E_INVALID_TYPE);
-
-        if (_c_unlikely_(reader->poison))
-                return reader->poison;
-
-        switch (*reader->p) {
-                case 't':
-                        if (strncmp(reader->p, "true", strlen("true")))
-                                return (reader->poison = C_JSON_E_INVALID_JSON);
-                        b = true;
-                        reader->p += strlen("true");
-                        break;
-
-                case 'f':
-                        if (strncmp(reader->p, "false", strlen("false")))
-                                return (reader->poison = C_JSON_E_INVALID_JSON);
-                        b = false;
-                        reader->p += strlen("false");
-                        break;
-
-                default:
-                        return (reader->poison = C_JSON_E_INVALID_TYPE);
-        }
-
-        r = c_json_reader_advance(reader);
-        if (r)
-                return r;
-
-        if (boolp)
-                *boolp = b;
-
-        return 0;
+        return c_json_reader_read_bool_inline(reader, boolp);
 }
 
 /**
@@ -826,22 +1190,7 @@ _c_public_ int c_json_reader_read_bool(CJsonReader *reader, bool *boolp) {
  *         false if no value is available or an error occured in a call to a previous function
  */
 _c_public_ bool c_json_reader_more(CJsonReader *reader) {
-        if (_c_unlikely_(reader->poison))
-                return false;
-
-        if (!*reader->p)
-                return false;
-
-        switch (reader->states[reader->level]) {
-                case '[':
-                        return *reader->p != ']';
-
-                case '{':
-                case ':':
-                        return *reader->p != '}';
-        }
-
-        return true;
+        return c_json_reader_more_inline(reader);
 }
 
 /**
@@ -856,22 +1205,7 @@ _c_public_ bool c_json_reader_more(CJsonReader *reader) {
  *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
  */
 _c_public_ int c_json_reader_enter_array(CJsonReader *reader) {
-        if (_c_unlikely_(reader->poison))
-                return reader->poison;
-
-        if (reader->states[reader->level] == '{')
-                return (reader->poison = C_JSON_E_INVALID_TYPE);
-
-        if (*reader->p != '[')
-                return (reader->poison = C_JSON_E_INVALID_TYPE);
-
-        if (reader->level >= reader->n_states)
-                return (reader->poison = C_JSON_E_DEPTH_OVERFLOW);
-
-        reader->p = skip_space(reader->p + 1);
-        reader->states[++reader->level] = '[';
-
-        return 0;
+        return c_json_reader_enter_array_inline(reader);
 }
 
 /**
@@ -885,19 +1219,7 @@ _c_public_ int c_json_reader_enter_array(CJsonReader *reader) {
  *         C_JSON_E_INVALID_JSON if the JSON input is malformed
  */
 _c_public_ int c_json_reader_exit_array(CJsonReader *reader) {
-        if (_c_unlikely_(reader->poison))
-                return reader->poison;
-
-        if (reader->states[reader->level] != '[' && reader->states[reader->level] != ',')
-                return (reader->poison = C_JSON_E_INVALID_TYPE);
-
-        if (*reader->p != ']')
-                return (reader->poison = C_JSON_E_INVALID_JSON);
-
-        reader->p += 1;
-        reader->level -= 1;
-
-        return c_json_reader_advance(reader);
+        return c_json_reader_exit_array_inline(reader);
 }
 
 /**
@@ -912,25 +1234,7 @@ _c_public_ int c_json_reader_exit_array(CJsonReader *reader) {
  *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
  */
 _c_public_ int c_json_reader_enter_object(CJsonReader *reader) {
-        if (_c_unlikely_(reader->poison))
-                return reader->poison;
-
-        if (reader->states[reader->level] == '{')
-                return (reader->poison = C_JSON_E_INVALID_TYPE);
-
-        if (*reader->p != '{')
-                return (reader->poison = C_JSON_E_INVALID_TYPE);
-
-        if (reader->level >= reader->n_states)
-                return (reader->poison = C_JSON_E_DEPTH_OVERFLOW);
-
-        reader->p = skip_space(reader->p + 1);
-        if (*reader->p != '"' && *reader->p != '}')
-                return (reader->poison = C_JSON_E_INVALID_JSON);
-
-        reader->states[++reader->level] = '{';
-
-        return 0;
+        return c_json_reader_enter_object_inline(reader);
 }
 
 /**
@@ -944,17 +1248,159 @@ _c_public_ int c_json_reader_enter_object(CJsonReader *reader) {
  *         C_JSON_E_INVALID_JSON if the JSON input is malformed
  */
 _c_public_ int c_json_reader_exit_object(CJsonReader *reader) {
+        return c_json_reader_exit_object_inline(reader);
+}
+
+/**
+ * c_json_reader_skip() - skip the next value
+ * @json                json object
+ *
+ * Reads the next value and discards it. If the value is an array or an
+ * object, all nested values are skipped as well. The skipped input is
+ * validated exactly as if it was read with the other reader functions.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a reader function
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
+ */
+_c_public_ int c_json_reader_skip(CJsonReader *reader) {
+        size_t level;
+        int r;
+
         if (_c_unlikely_(reader->poison))
                 return reader->poison;
 
-        if (reader->states[reader->level] != '{' && reader->states[reader->level] != ':')
-                return (reader->poison = C_JSON_E_INVALID_TYPE);
+        level = reader->level;
 
-        if (*reader->p != '}')
-                return (reader->poison = C_JSON_E_INVALID_JSON);
+        do {
+                if (reader->level > level && !c_json_reader_more(reader)) {
+                        switch (reader->states[reader->level]) {
+                        case '[':
+                        case ',':
+                                r = c_json_reader_exit_array(reader);
+                                break;
+                        default:
+                                r = c_json_reader_exit_object(reader);
+                                break;
+                        }
+                } else {
+                        switch (c_json_reader_peek(reader)) {
+                        case C_JSON_TYPE_NULL:
+                                r = c_json_reader_read_null(reader);
+                                break;
+                        case C_JSON_TYPE_BOOLEAN:
+                                r = c_json_reader_read_bool(reader, NULL);
+                                break;
+                        case C_JSON_TYPE_STRING:
+                                r = c_json_reader_read_string(reader, NULL);
+                                break;
+                        case C_JSON_TYPE_NUMBER:
+                                r = c_json_reader_read_number(reader, NULL, NULL);
+                                break;
+                        case C_JSON_TYPE_ARRAY:
+                                r = c_json_reader_enter_array(reader);
+                                break;
+                        case C_JSON_TYPE_OBJECT:
+                                r = c_json_reader_enter_object(reader);
+                                break;
+                        default:
+                                r = (reader->poison = C_JSON_E_INVALID_JSON);
+                                break;
+                        }
+                }
+                if (r)
+                        return r;
+        } while (reader->level > level);
 
-        reader->p += 1;
-        reader->level -= 1;
+        return 0;
+}
 
-        return c_json_reader_advance(reader);
+/**
+ * c_json_reader_checkpoint() - save the position of a reader
+ * @reader              reader object
+ * @checkpoint          checkpoint to save to
+ *
+ * Saves the current position of @reader, so that it can be rewound to it
+ * with c_json_reader_restore() later on, for instance to read a value
+ * again as a different type after reading it as one type failed. Only
+ * the state of the levels up to the current one is copied, so this is
+ * cheap. @checkpoint must be zero-initialized before its first use and
+ * released with c_json_checkpoint_deinit(). It can be reused, and only
+ * allocates when the reader is nested deeper than ever before.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ */
+_c_public_ int c_json_reader_checkpoint(CJsonReader *reader, CJsonCheckpoint *checkpoint) {
+        size_t n_levels = reader->level + 1;
+
+        if (n_levels > checkpoint->n_allocated) {
+                char *states;
+                size_t *members;
+
+                states = realloc(checkpoint->states, n_levels);
+                if (!states)
+                        return -ENOMEM;
+                checkpoint->states = states;
+
+                members = realloc(checkpoint->members, n_levels * sizeof(*members));
+                if (!members)
+                        return -ENOMEM;
+                checkpoint->members = members;
+
+                checkpoint->n_allocated = n_levels;
+        }
+
+        checkpoint->p = reader->p;
+        checkpoint->level = reader->level;
+        checkpoint->n_strings_left = reader->n_strings_left;
+        checkpoint->n_values_left = reader->n_values_left;
+        memcpy(checkpoint->states, reader->states, n_levels);
+        memcpy(checkpoint->members, reader->members, n_levels * sizeof(*reader->members));
+
+        return 0;
+}
+
+/**
+ * c_json_reader_restore() - rewind a reader to a checkpoint
+ * @reader              reader object
+ * @checkpoint          checkpoint to rewind to
+ *
+ * Rewinds @reader to the position saved in @checkpoint, regardless of
+ * how far it read since, and how many containers it entered or exited.
+ * Any error since is cleared. @checkpoint must have been saved from
+ * @reader since the last call to c_json_reader_begin_read(), and stays
+ * valid, so the reader can be rewound to it more than once. Strings that
+ * were decoded in place since are not restored, and must not be read
+ * again.
+ */
+_c_public_ void c_json_reader_restore(CJsonReader *reader, const CJsonCheckpoint *checkpoint) {
+        size_t n_levels = checkpoint->level + 1;
+
+        assert(reader->input && checkpoint->p >= reader->input);
+
+        reader->p = checkpoint->p;
+        reader->level = checkpoint->level;
+        reader->n_strings_left = checkpoint->n_strings_left;
+        reader->n_values_left = checkpoint->n_values_left;
+        memcpy(reader->states, checkpoint->states, n_levels);
+        memcpy(reader->members, checkpoint->members, n_levels * sizeof(*reader->members));
+
+        reader->poison = 0;
+        reader->parse_suspended = false;
+}
+
+/**
+ * c_json_checkpoint_deinit() - release a checkpoint
+ * @checkpoint          checkpoint to release
+ *
+ * Frees the memory held by @checkpoint and resets it, so that it can be
+ * reused or deinitialized again.
+ */
+_c_public_ void c_json_checkpoint_deinit(CJsonCheckpoint *checkpoint) {
+        free(checkpoint->members);
+        free(checkpoint->states);
+        *checkpoint = (CJsonCheckpoint){};
 }
@@ -0,0 +1,938 @@
+
+#include <c-stdaux.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+/* node indices of the `true` and `false` schemas, which always exist */
+#define C_JSON_SCHEMA_TRUE 0
+#define C_JSON_SCHEMA_FALSE 1
+
+typedef struct CJsonSchemaBuffer CJsonSchemaBuffer;
+typedef struct CJsonSchemaContext CJsonSchemaContext;
+typedef struct CJsonSchemaEnum CJsonSchemaEnum;
+typedef struct CJsonSchemaNode CJsonSchemaNode;
+typedef struct CJsonSchemaProperty CJsonSchemaProperty;
+
+enum {
+        C_JSON_SCHEMA_INTEGER = 1 << (C_JSON_TYPE_OBJECT + 1),
+        C_JSON_SCHEMA_ANY = (1 << (C_JSON_TYPE_OBJECT + 1)) - 1,
+};
+
+enum {
+        C_JSON_SCHEMA_MINIMUM = 1 << 0,
+        C_JSON_SCHEMA_MAXIMUM = 1 << 1,
+        C_JSON_SCHEMA_EXCLUSIVE_MINIMUM = 1 << 2,
+        C_JSON_SCHEMA_EXCLUSIVE_MAXIMUM = 1 << 3,
+        C_JSON_SCHEMA_ENUM = 1 << 4,
+        C_JSON_SCHEMA_BOUNDS = C_JSON_SCHEMA_MINIMUM | C_JSON_SCHEMA_MAXIMUM |
+                               C_JSON_SCHEMA_EXCLUSIVE_MINIMUM | C_JSON_SCHEMA_EXCLUSIVE_MAXIMUM,
+};
+
+struct CJsonSchemaBuffer {
+        char *data;
+        size_t n_data;
+        size_t n_allocated;
+};
+
+struct CJsonSchemaEnum {
+        char *text;
+        size_t n_text;
+};
+
+struct CJsonSchemaProperty {
+        /* ID of the key in the intern table of the schema */
+        size_t id;
+        size_t node;
+        /* bit in CJsonSchemaNode.required, or 0 if the key is optional */
+        uint64_t required;
+};
+
+/*
+ * A compiled schema is a table of nodes, which refer to each other by
+ * their index in the table. Keywords that are absent are compiled into
+ * bounds that always hold, so checks need no special cases for them.
+ */
+struct CJsonSchemaNode {
+        unsigned int types;
+        unsigned int flags;
+
+        double minimum;
+        double maximum;
+        double exclusive_minimum;
+        double exclusive_maximum;
+        size_t min_length;
+        size_t max_length;
+
+        size_t min_items;
+        size_t max_items;
+        size_t items;
+
+        CJsonSchemaProperty *properties;
+        size_t n_properties;
+        uint64_t required;
+        size_t additional;
+
+        CJsonSchemaEnum *enums;
+        size_t n_enums;
+        /* `const`, until it is merged into the enum values */
+        CJsonSchemaEnum constant;
+};
+
+struct CJsonSchema {
+        CJsonSchemaNode *nodes;
+        size_t n_nodes;
+        size_t root;
+        CJsonInternTable *keys;
+};
+
+struct CJsonSchemaContext {
+        CJsonSchema *schema;
+        CJsonReader *reader;
+        /* JSON pointer to the violation, built from the innermost segment outwards */
+        CJsonSchemaBuffer pointer;
+        CJsonSchemaBuffer canonical;
+};
+
+static int c_json_schema_buffer_append(void *userdata, const char *data, size_t n_data) {
+        CJsonSchemaBuffer *buffer = userdata;
+        size_t n_allocated;
+        char *p;
+
+        if (buffer->n_data + n_data > buffer->n_allocated) {
+                n_allocated = c_max(buffer->n_allocated * 2, buffer->n_data + n_data);
+                n_allocated = c_max(n_allocated, (size_t)64);
+
+                p = realloc(buffer->data, n_allocated);
+                if (!p)
+                        return -ENOMEM;
+
+                buffer->data = p;
+                buffer->n_allocated = n_allocated;
+        }
+
+        memcpy(buffer->data + buffer->n_data, data, n_data);
+        buffer->n_data += n_data;
+
+        return 0;
+}
+
+static int c_json_schema_node_new(CJsonSchema *schema, size_t *nodep) {
+        CJsonSchemaNode *nodes;
+
+        nodes = realloc(schema->nodes, (schema->n_nodes + 1) * sizeof(*nodes));
+        if (!nodes)
+                return -ENOMEM;
+
+        schema->nodes = nodes;
+        schema->nodes[schema->n_nodes] = (CJsonSchemaNode){
+                .types = C_JSON_SCHEMA_ANY,
+                .max_length = SIZE_MAX,
+                .max_items = SIZE_MAX,
+                .items = C_JSON_SCHEMA_TRUE,
+                .additional = C_JSON_SCHEMA_TRUE,
+        };
+
+        *nodep = schema->n_nodes++;
+
+        return 0;
+}
+
+/* returns the index of the property of a node with the given key, adding it if necessary */
+static int c_json_schema_node_property(CJsonSchema *schema, size_t i_node, const char *key, size_t *propertyp) {
+        CJsonSchemaNode *node = &schema->nodes[i_node];
+        CJsonSchemaProperty *properties;
+        size_t id;
+        int r;
+
+        r = c_json_intern_table_add(schema->keys, key, &id);
+        if (r)
+                return r;
+
+        for (size_t i = 0; i < node->n_properties; i += 1) {
+                if (node->properties[i].id == id) {
+                        *propertyp = i;
+                        return 0;
+                }
+        }
+
+        properties = realloc(node->properties, (node->n_properties + 1) * sizeof(*properties));
+        if (!properties)
+                return -ENOMEM;
+
+        node->properties = properties;
+        node->properties[node->n_properties] = (CJsonSchemaProperty){
+                .id = id,
+                .node = C_JSON_SCHEMA_TRUE,
+        };
+
+        *propertyp = node->n_properties++;
+
+        return 0;
+}
+
+static int c_json_schema_read_type(CJsonReader *reader, unsigned int *typesp) {
+        static const struct {
+                const char *name;
+                unsigned int types;
+        } names[] = {
+                { "null",       1 << C_JSON_TYPE_NULL },
+                { "boolean",    1 << C_JSON_TYPE_BOOLEAN },
+                { "string",     1 << C_JSON_TYPE_STRING },
+                { "number",     1 << C_JSON_TYPE_NUMBER },
+                { "integer",    C_JSON_SCHEMA_INTEGER },
+                { "array",      1 << C_JSON_TYPE_ARRAY },
+                { "object",     1 << C_JSON_TYPE_OBJECT },
+        };
+        _c_cleanup_(c_freep) char *name = NULL;
+        int r;
+
+        r = c_json_reader_read_string(reader, &name);
+        if (r)
+                return r;
+
+        for (size_t i = 0; i < C_ARRAY_SIZE(names); i += 1) {
+                if (!strcmp(name, names[i].name)) {
+                        *typesp |= names[i].types;
+                        return 0;
+                }
+        }
+
+        return -EINVAL;
+}
+
+static int c_json_schema_read_double(CJsonReader *reader, double *valuep) {
+        const char *number;
+        size_t n_number;
+        int r;
+
+        r = c_json_reader_read_number(reader, &number, &n_number);
+        if (r)
+                return r;
+
+        *valuep = c_json_parse_double(number);
+
+        return 0;
+}
+
+static int c_json_schema_read_count(CJsonReader *reader, size_t *countp) {
+        unsigned long long count;
+        const char *number;
+        size_t n_number;
+        char *end;
+        int r;
+
+        r = c_json_reader_read_number(reader, &number, &n_number);
+        if (r)
+                return r;
+
+        if (*number == '-')
+                return -EINVAL;
+
+        errno = 0;
+        count = strtoull(number, &end, 10);
+        if (errno || end != number + n_number || count >= SIZE_MAX)
+                return -EINVAL;
+
+        *countp = count;
+
+        return 0;
+}
+
+static int c_json_schema_read_value(CJsonReader *reader, CJsonSchemaEnum *valuep) {
+        CJsonSchemaBuffer buffer = {};
+        int r;
+
+        r = c_json_canonicalize(reader, c_json_schema_buffer_append, &buffer);
+        if (!r)
+                r = c_json_schema_buffer_append(&buffer, "", 1);
+        if (r) {
+                free(buffer.data);
+                return r;
+        }
+
+        /* 0-terminated, so it can be read again when the enums are filtered */
+        *valuep = (CJsonSchemaEnum){
+                .text = buffer.data,
+                .n_text = buffer.n_data - 1,
+        };
+
+        return 0;
+}
+
+static int c_json_schema_read_enum(CJsonSchema *schema, size_t i_node, CJsonReader *reader) {
+        CJsonSchemaNode *node = &schema->nodes[i_node];
+        CJsonSchemaEnum *enums;
+        int r;
+
+        enums = realloc(node->enums, (node->n_enums + 1) * sizeof(*enums));
+        if (!enums)
+                return -ENOMEM;
+        node->enums = enums;
+
+        r = c_json_schema_read_value(reader, &node->enums[node->n_enums]);
+        if (r)
+                return r;
+
+        node->n_enums += 1;
+        return 0;
+}
+
+/*
+ * Folds `const` into the enum values of a node, once all its keywords are
+ * known. With both keywords, a value has to satisfy both, so only the
+ * constant remains, and only if it is one of the enum values.
+ */
+static int c_json_schema_merge_const(CJsonSchemaNode *node) {
+        bool found = false;
+
+        if (!node->constant.text)
+                return 0;
+
+        if (node->flags & C_JSON_SCHEMA_ENUM) {
+                for (size_t i = 0; i < node->n_enums; i += 1) {
+                        found = found || (node->enums[i].n_text == node->constant.n_text &&
+                                          !memcmp(node->enums[i].text, node->constant.text, node->constant.n_text));
+                        free(node->enums[i].text);
+                }
+                node->n_enums = 0;
+        } else {
+                found = true;
+        }
+
+        node->flags |= C_JSON_SCHEMA_ENUM;
+
+        if (found) {
+                if (!node->enums) {
+                        node->enums = malloc(sizeof(*node->enums));
+                        if (!node->enums)
+                                return -ENOMEM;
+                }
+
+                node->enums[node->n_enums++] = node->constant;
+        } else {
+                free(node->constant.text);
+        }
+
+        node->constant = (CJsonSchemaEnum){};
+        return 0;
+}
+
+static int c_json_schema_compile(CJsonSchema *schema, CJsonReader *reader, size_t *nodep);
+
+static int c_json_schema_compile_keyword(CJsonSchema *schema, size_t i_node, CJsonReader *reader, const char *keyword) {
+        CJsonSchemaNode *node = &schema->nodes[i_node];
+        _c_cleanup_(c_freep) char *key = NULL;
+        size_t i_property, i_sub, n_required;
+        int r;
+
+        if (!strcmp(keyword, "type")) {
+                node->types = 0;
+
+                if (c_json_reader_peek(reader) != C_JSON_TYPE_ARRAY)
+                        return c_json_schema_read_type(reader, &node->types);
+
+                r = c_json_reader_enter_array(reader);
+                while (!r && c_json_reader_more(reader))
+                        r = c_json_schema_read_type(reader, &schema->nodes[i_node].types);
+                return r ?: c_json_reader_exit_array(reader);
+        } else if (!strcmp(keyword, "properties")) {
+                r = c_json_reader_enter_object(reader);
+                while (!r && c_json_reader_more(reader)) {
+                        key = c_free(key);
+
+                        r = c_json_reader_read_string(reader, &key);
+                        if (!r)
+                                r = c_json_schema_compile(schema, reader, &i_sub);
+                        if (!r)
+                                r = c_json_schema_node_property(schema, i_node, key, &i_property);
+                        if (!r)
+                                schema->nodes[i_node].properties[i_property].node = i_sub;
+                }
+                return r ?: c_json_reader_exit_object(reader);
+        } else if (!strcmp(keyword, "required")) {
+                r = c_json_reader_enter_array(reader);
+                while (!r && c_json_reader_more(reader)) {
+                        key = c_free(key);
+
+                        r = c_json_reader_read_string(reader, &key);
+                        if (!r)
+                                r = c_json_schema_node_property(schema, i_node, key, &i_property);
+                        if (r)
+                                break;
+
+                        node = &schema->nodes[i_node];
+                        if (!node->properties[i_property].required) {
+                                /* required keys are tracked in a 64-bit mask while reading */
+                                n_required = __builtin_popcountll(node->required);
+                                if (n_required >= 64)
+                                        return -E2BIG;
+
+                                node->properties[i_property].required = UINT64_C(1) << n_required;
+                                node->required |= UINT64_C(1) << n_required;
+                        }
+                }
+                return r ?: c_json_reader_exit_array(reader);
+        } else if (!strcmp(keyword, "additionalProperties")) {
+                r = c_json_schema_compile(schema, reader, &i_sub);
+                if (!r)
+                        schema->nodes[i_node].additional = i_sub;
+                return r;
+        } else if (!strcmp(keyword, "items")) {
+                /* tuple validation is not supported */
+                if (c_json_reader_peek(reader) == C_JSON_TYPE_ARRAY)
+                        return -EOPNOTSUPP;
+
+                r = c_json_schema_compile(schema, reader, &i_sub);
+                if (!r)
+                        schema->nodes[i_node].items = i_sub;
+                return r;
+        } else if (!strcmp(keyword, "minItems")) {
+                return c_json_schema_read_count(reader, &node->min_items);
+        } else if (!strcmp(keyword, "maxItems")) {
+                return c_json_schema_read_count(reader, &node->max_items);
+        } else if (!strcmp(keyword, "minLength")) {
+                return c_json_schema_read_count(reader, &node->min_length);
+        } else if (!strcmp(keyword, "maxLength")) {
+                return c_json_schema_read_count(reader, &node->max_length);
+        } else if (!strcmp(keyword, "minimum")) {
+                node->flags |= C_JSON_SCHEMA_MINIMUM;
+                return c_json_schema_read_double(reader, &node->minimum);
+        } else if (!strcmp(keyword, "maximum")) {
+                node->flags |= C_JSON_SCHEMA_MAXIMUM;
+                return c_json_schema_read_double(reader, &node->maximum);
+        } else if (!strcmp(keyword, "exclusiveMinimum")) {
+                /* a separate bound, both apply if both keywords are present */
+                node->flags |= C_JSON_SCHEMA_EXCLUSIVE_MINIMUM;
+                return c_json_schema_read_double(reader, &node->exclusive_minimum);
+        } else if (!strcmp(keyword, "exclusiveMaximum")) {
+                node->flags |= C_JSON_SCHEMA_EXCLUSIVE_MAXIMUM;
+                return c_json_schema_read_double(reader, &node->exclusive_maximum);
+        } else if (!strcmp(keyword, "enum")) {
+                node->flags |= C_JSON_SCHEMA_ENUM;
+
+                r = c_json_reader_enter_array(reader);
+                while (!r && c_json_reader_more(reader))
+                        r = c_json_schema_read_enum(schema, i_node, reader);
+                return r ?: c_json_reader_exit_array(reader);
+        } else if (!strcmp(keyword, "const")) {
+                node->constant.text = c_free(node->constant.text);
+                return c_json_schema_read_value(reader, &node->constant);
+        } else if (!strcmp(keyword, "$schema") ||
+                   !strcmp(keyword, "$id") ||
+                   !strcmp(keyword, "$comment") ||
+                   !strcmp(keyword, "title") ||
+                   !strcmp(keyword, "description") ||
+                   !strcmp(keyword, "default") ||
+                   !strcmp(keyword, "examples")) {
+                /* annotations do not affect validation */
+                return c_json_reader_skip(reader);
+        }
+
+        return -EOPNOTSUPP;
+}
+
+static int c_json_schema_compile(CJsonSchema *schema, CJsonReader *reader, size_t *nodep) {
+        _c_cleanup_(c_freep) char *keyword = NULL;
+        size_t i_node;
+        bool b;
+        int r;
+
+        switch (c_json_reader_peek(reader)) {
+        case C_JSON_TYPE_BOOLEAN:
+                r = c_json_reader_read_bool(reader, &b);
+                if (r)
+                        return r;
+
+                *nodep = b ? C_JSON_SCHEMA_TRUE : C_JSON_SCHEMA_FALSE;
+                return 0;
+        case C_JSON_TYPE_OBJECT:
+                break;
+        default:
+                return reader->poison ?: -EINVAL;
+        }
+
+        r = c_json_schema_node_new(schema, &i_node);
+        if (r)
+                return r;
+
+        r = c_json_reader_enter_object(reader);
+        if (r)
+                return r;
+
+        while (c_json_reader_more(reader)) {
+                keyword = c_free(keyword);
+
+                r = c_json_reader_read_string(reader, &keyword);
+                if (r)
+                        return r;
+
+                r = c_json_schema_compile_keyword(schema, i_node, reader, keyword);
+                if (r)
+                        return r;
+        }
+
+        r = c_json_reader_exit_object(reader);
+        if (r)
+                return r;
+
+        r = c_json_schema_merge_const(&schema->nodes[i_node]);
+        if (r)
+                return r;
+
+        *nodep = i_node;
+
+        return 0;
+}
+
+static int c_json_schema_fail(CJsonSchemaContext *ctx) {
+        ctx->pointer.n_data = 0;
+        return (ctx->reader->poison = C_JSON_E_SCHEMA_VIOLATION);
+}
+
+/* prepends a segment to the JSON pointer of a violation */
+static int c_json_schema_prepend(CJsonSchemaContext *ctx, const char *segment, size_t n_segment) {
+        size_t n_escaped = 1, n_pointer = ctx->pointer.n_data;
+        char *p;
+        int r;
+
+        for (size_t i = 0; i < n_segment; i += 1)
+                n_escaped += 1 + (segment[i] == '~' || segment[i] == '/');
+
+        /* grow the buffer by the length of the segment, then move the pointer behind it */
+        for (size_t i = 0; i < n_escaped; i += 1) {
+                r = c_json_schema_buffer_append(&ctx->pointer, "", 1);
+                if (r)
+                        return (ctx->reader->poison = r);
+        }
+
+        p = ctx->pointer.data;
+        memmove(p + n_escaped, p, n_pointer);
+
+        *p++ = '/';
+        for (size_t i = 0; i < n_segment; i += 1) {
+                if (segment[i] == '~') {
+                        *p++ = '~';
+                        *p++ = '0';
+                } else if (segment[i] == '/') {
+                        *p++ = '~';
+                        *p++ = '1';
+                } else {
+                        *p++ = segment[i];
+                }
+        }
+
+        return C_JSON_E_SCHEMA_VIOLATION;
+}
+
+static int c_json_schema_count_chars(void *userdata, const char *chunk, size_t n_chunk) {
+        size_t *n_charsp = userdata;
+
+        for (size_t i = 0; i < n_chunk; i += 1)
+                *n_charsp += ((uint8_t)chunk[i] & 0xC0) != 0x80;
+
+        return 0;
+}
+
+static bool c_json_schema_is_integer(const char *number, size_t n_number) {
+        double value;
+
+        if (!memchr(number, '.', n_number) && !memchr(number, 'e', n_number) && !memchr(number, 'E', n_number))
+                return true;
+
+        /* a fraction or exponent may still denote an integer, like 1.0 or 1e3 */
+        value = c_json_parse_double(number);
+        if (value != value || value - value != 0)
+                return false;
+        if (value >= 0x1p53 || value <= -0x1p53)
+                return true;
+
+        return (double)(int64_t)value == value;
+}
+
+static int c_json_schema_check_value(CJsonSchemaContext *ctx, size_t i_node, bool use_enum);
+
+static int c_json_schema_check_enum(CJsonSchemaContext *ctx, const CJsonSchemaNode *node) {
+        int r;
+
+        ctx->canonical.n_data = 0;
+
+        r = c_json_canonicalize(ctx->reader, c_json_schema_buffer_append, &ctx->canonical);
+        if (r)
+                return r;
+
+        for (size_t i = 0; i < node->n_enums; i += 1)
+                if (node->enums[i].n_text == ctx->canonical.n_data &&
+                    !memcmp(node->enums[i].text, ctx->canonical.data, ctx->canonical.n_data))
+                        return 0;
+
+        return c_json_schema_fail(ctx);
+}
+
+static int c_json_schema_check_number(CJsonSchemaContext *ctx, const CJsonSchemaNode *node) {
+        const char *number;
+        size_t n_number;
+        double value;
+        int r;
+
+        r = c_json_reader_read_number(ctx->reader, &number, &n_number);
+        if (r)
+                return r;
+
+        if (!(node->types & (1 << C_JSON_TYPE_NUMBER)) && !c_json_schema_is_integer(number, n_number))
+                return c_json_schema_fail(ctx);
+
+        if (node->flags & C_JSON_SCHEMA_BOUNDS) {
+                value = c_json_parse_double(number);
+
+                if ((node->flags & C_JSON_SCHEMA_MINIMUM) && value < node->minimum)
+                        return c_json_schema_fail(ctx);
+                if ((node->flags & C_JSON_SCHEMA_MAXIMUM) && value > node->maximum)
+                        return c_json_schema_fail(ctx);
+                if ((node->flags & C_JSON_SCHEMA_EXCLUSIVE_MINIMUM) && value <= node->exclusive_minimum)
+                        return c_json_schema_fail(ctx);
+                if ((node->flags & C_JSON_SCHEMA_EXCLUSIVE_MAXIMUM) && value >= node->exclusive_maximum)
+                        return c_json_schema_fail(ctx);
+        }
+
+        return 0;
+}
+
+static int c_json_schema_check_string(CJsonSchemaContext *ctx, const CJsonSchemaNode *node) {
+        size_t n_chars = 0;
+        int r;
+
+        if (!node->min_length && node->max_length == SIZE_MAX)
+                return c_json_reader_read_string(ctx->reader, NULL);
+
+        r = c_json_reader_read_string_chunked(ctx->reader, c_json_schema_count_chars, &n_chars);
+        if (r)
+                return r;
+
+        if (n_chars < node->min_length || n_chars > node->max_length)
+                return c_json_schema_fail(ctx);
+
+        return 0;
+}
+
+static int c_json_schema_check_array(CJsonSchemaContext *ctx, const CJsonSchemaNode *node) {
+        char index[C_JSON_NUMBER_MAX];
+        size_t n_items = 0;
+        int r;
+
+        r = c_json_reader_enter_array(ctx->reader);
+        if (r)
+                return r;
+
+        while (c_json_reader_more(ctx->reader)) {
+                if (n_items >= node->max_items)
+                        return c_json_schema_fail(ctx);
+
+                if (node->items == C_JSON_SCHEMA_TRUE)
+                        r = c_json_reader_skip(ctx->reader);
+                else
+                        r = c_json_schema_check_value(ctx, node->items, true);
+                if (r == C_JSON_E_SCHEMA_VIOLATION)
+                        return c_json_schema_prepend(ctx, index, c_json_format_uint64(index, n_items));
+                if (r)
+                        return r;
+
+                n_items += 1;
+        }
+
+        r = c_json_reader_exit_array(ctx->reader);
+        if (r)
+                return r;
+
+        if (n_items < node->min_items)
+                return c_json_schema_fail(ctx);
+
+        return 0;
+}
+
+static int c_json_schema_check_object(CJsonSchemaContext *ctx, const CJsonSchemaNode *node) {
+        CJsonReader *reader = ctx->reader;
+        const CJsonSchemaProperty *property;
+        uint64_t required = 0;
+        size_t i_sub, id;
+        const char *key;
+        int r;
+
+        r = c_json_reader_enter_object(reader);
+        if (r)
+                return r;
+
+        while (c_json_reader_more(reader)) {
+                _c_cleanup_(c_freep) char *unknown = NULL;
+
+                property = NULL;
+
+                r = c_json_reader_read_interned(reader, ctx->schema->keys, &key, &id);
+                if (r)
+                        return r;
+
+                if (id != C_JSON_INTERN_NONE) {
+                        for (size_t i = 0; i < node->n_properties; i += 1) {
+                                if (node->properties[i].id == id) {
+                                        property = &node->properties[i];
+                                        break;
+                                }
+                        }
+                }
+
+                if (property) {
+                        required |= property->required;
+                        i_sub = property->node;
+                } else {
+                        i_sub = node->additional;
+
+                        if (id == C_JSON_INTERN_NONE) {
+                                /* only keep the key if it might be reported */
+                                r = c_json_reader_read_string(reader,
+                                                              i_sub == C_JSON_SCHEMA_TRUE ? NULL : &unknown);
+                                if (r)
+                                        return r;
+
+                                key = unknown;
+                        }
+                }
+
+                if (i_sub == C_JSON_SCHEMA_TRUE)
+                        r = c_json_reader_skip(reader);
+                else
+                        r = c_json_schema_check_value(ctx, i_sub, true);
+                if (r == C_JSON_E_SCHEMA_VIOLATION)
+                        return c_json_schema_prepend(ctx, key, strlen(key));
+                if (r)
+                        return r;
+        }
+
+        r = c_json_reader_exit_object(reader);
+        if (r)
+                return r;
+
+        if (required != node->required)
+                return c_json_schema_fail(ctx);
+
+        return 0;
+}
+
+static int c_json_schema_check_value(CJsonSchemaContext *ctx, size_t i_node, bool use_enum) {
+        const CJsonSchemaNode *node = &ctx->schema->nodes[i_node];
+        int type;
+
+        type = c_json_reader_peek(ctx->reader);
+        if (type < 0)
+                return ctx->reader->poison ?: (ctx->reader->poison = C_JSON_E_INVALID_JSON);
+
+        if (!(node->types & (1 << type)) &&
+            !(type == C_JSON_TYPE_NUMBER && (node->types & C_JSON_SCHEMA_INTEGER)))
+                return c_json_schema_fail(ctx);
+
+        /* enum values are checked against the other keywords when the schema is compiled */
+        if (use_enum && (node->flags & C_JSON_SCHEMA_ENUM))
+                return c_json_schema_check_enum(ctx, node);
+
+        switch (type) {
+        case C_JSON_TYPE_NULL:
+                return c_json_reader_read_null(ctx->reader);
+        case C_JSON_TYPE_BOOLEAN:
+                return c_json_reader_read_bool(ctx->reader, NULL);
+        case C_JSON_TYPE_NUMBER:
+                return c_json_schema_check_number(ctx, node);
+        case C_JSON_TYPE_STRING:
+                return c_json_schema_check_string(ctx, node);
+        case C_JSON_TYPE_ARRAY:
+                return c_json_schema_check_array(ctx, node);
+        default:
+                return c_json_schema_check_object(ctx, node);
+        }
+}
+
+/*
+ * Drops the enum values of all nodes that violate the other keywords of
+ * their node, so only the enum has to be checked while reading.
+ */
+static int c_json_schema_filter_enums(CJsonSchema *schema, CJsonReader *reader) {
+        CJsonSchemaContext ctx = {
+                .schema = schema,
+                .reader = reader,
+        };
+        CJsonSchemaNode *node;
+        size_t n_enums;
+        int r = 0;
+
+        for (size_t i_node = 0; !r && i_node < schema->n_nodes; i_node += 1) {
+                node = &schema->nodes[i_node];
+                n_enums = 0;
+
+                for (size_t i = 0; i < node->n_enums; i += 1) {
+                        c_json_reader_begin_read(reader, node->enums[i].text);
+                        r = c_json_schema_check_value(&ctx, i_node, false);
+                        if (r) {
+                                c_json_reader_end_read(reader);
+                        } else {
+                                r = c_json_reader_end_read(reader);
+                        }
+
+                        if (!r) {
+                                node->enums[n_enums++] = node->enums[i];
+                        } else if (r == C_JSON_E_SCHEMA_VIOLATION) {
+                                free(node->enums[i].text);
+                                r = 0;
+                        } else {
+                                for (size_t j = i; j < node->n_enums; j += 1)
+                                        node->enums[n_enums++] = node->enums[j];
+                                break;
+                        }
+                }
+
+                node->n_enums = n_enums;
+        }
+
+        free(ctx.pointer.data);
+        return r;
+}
+
+/**
+ * c_json_schema_new() - compile a schema
+ * @schemap             return location
+ * @text                0-terminated JSON Schema to compile
+ *
+ * Compiles a subset of JSON Schema into a table of checks, which
+ * c_json_schema_check() applies while a document is read. The supported
+ * keywords are `type`, `enum`, `const`, `minimum`, `maximum`,
+ * `exclusiveMinimum`, `exclusiveMaximum`, `minLength`, `maxLength`,
+ * `items`, `minItems`, `maxItems`, `properties`, `required` and
+ * `additionalProperties`. Annotations like `title` or `description` are
+ * ignored. `exclusiveMinimum` and `exclusiveMaximum` take numbers, as
+ * in current drafts. At most 64 keys can be required per object.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         -EINVAL if the schema is not valid
+ *         -EOPNOTSUPP if the schema uses unsupported keywords
+ *         -E2BIG if an object requires too many keys
+ *         C_JSON_E_INVALID_JSON if the schema is malformed JSON
+ *         C_JSON_E_DEPTH_OVERFLOW if the schema is nested too deeply
+ */
+_c_public_ int c_json_schema_new(CJsonSchema **schemap, const char *text) {
+        _c_cleanup_(c_json_schema_freep) CJsonSchema *schema = NULL;
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        size_t i_node;
+        int r;
+
+        schema = calloc(1, sizeof(*schema));
+        if (!schema)
+                return -ENOMEM;
+
+        r = c_json_intern_table_new(&schema->keys, SIZE_MAX);
+        if (r)
+                return r;
+
+        r = c_json_schema_node_new(schema, &i_node);
+        if (r)
+                return r;
+        r = c_json_schema_node_new(schema, &i_node);
+        if (r)
+                return r;
+        schema->nodes[C_JSON_SCHEMA_FALSE].types = 0;
+
+        r = c_json_reader_new(&reader, 256);
+        if (r)
+                return r;
+
+        c_json_reader_begin_read(reader, text);
+        r = c_json_schema_compile(schema, reader, &schema->root);
+        if (r) {
+                c_json_reader_end_read(reader);
+                return r;
+        }
+
+        r = c_json_reader_end_read(reader);
+        if (r)
+                return r;
+
+        /* frozen first, so enum values cannot add keys */
+        c_json_intern_table_freeze(schema->keys);
+
+        r = c_json_schema_filter_enums(schema, reader);
+        if (r)
+                return r;
+
+        *schemap = schema;
+        schema = NULL;
+
+        return 0;
+}
+
+/**
+ * c_json_schema_free() - free a schema
+ * @schema              schema to free
+ *
+ * Return: NULL
+ */
+_c_public_ CJsonSchema * c_json_schema_free(CJsonSchema *schema) {
+        if (!schema)
+                return NULL;
+
+        for (size_t i = 0; i < schema->n_nodes; i += 1) {
+                for (size_t j = 0; j < schema->nodes[i].n_enums; j += 1)
+                        free(schema->nodes[i].enums[j].text);
+                free(schema->nodes[i].enums);
+                free(schema->nodes[i].constant.text);
+                free(schema->nodes[i].properties);
+        }
+        free(schema->nodes);
+        c_json_intern_table_free(schema->keys);
+        free(schema);
+
+        return NULL;
+}
+
+/**
+ * c_json_schema_check() - read the next value and check it against a schema
+ * @schema              compiled schema
+ * @reader              reader to read the input from
+ * @pointerp            return location for the location of a violation, or NULL
+ *
+ * Reads the next value from @reader and checks it against @schema while
+ * it is read, without building a tree. Reading stops at the first
+ * violation, which poisons @reader. *@pointerp is then set to a JSON
+ * pointer (RFC 6901) to the value that violates the schema, which must
+ * be freed. Missing required keys and violated item counts are reported
+ * at their object or array.
+ *
+ * Values that the schema does not constrain are skipped, and object keys
+ * are looked up through an intern table of the keys known to the
+ * schema, so they are not copied.
+ *
+ * A schema can be used by any number of readers, on any number of
+ * threads, at the same time.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a reader function
+ *         C_JSON_E_SCHEMA_VIOLATION if the value violates @schema
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
+ */
+_c_public_ int c_json_schema_check(CJsonSchema *schema, CJsonReader *reader, char **pointerp) {
+        CJsonSchemaContext ctx = {
+                .schema = schema,
+                .reader = reader,
+        };
+        int r;
+
+        r = c_json_schema_check_value(&ctx, schema->root, true);
+        if (r == C_JSON_E_SCHEMA_VIOLATION && pointerp) {
+                *pointerp = strndup(ctx.pointer.data ?: "", ctx.pointer.n_data);
+                if (!*pointerp)
+                        r = (reader->poison = -ENOMEM);
+        }
+
+        free(ctx.canonical.data);
+        free(ctx.pointer.data);
+        return r;
+}
@@ -0,0 +1,257 @@
+
+#include <c-stdaux.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+/*
+ * Returns the next piece of the decoded contents of @string, starting at
+ * the raw position *@pp. Runs without escape sequences are returned in
+ * place, a single escape sequence is decoded into @scratch. The span was
+ * validated when the handle was read, so decoding cannot fail.
+ */
+static size_t c_json_string_next(const CJsonString *string, const char **pp, char scratch[4], const char **piecep) {
+        const char *p = *pp, *end = string->raw + string->n_raw, *q;
+        size_t n_piece;
+        int r;
+
+        if (*p != '\\') {
+                q = string->escaped ? memchr(p, '\\', end - p) : NULL;
+                if (!q)
+                        q = end;
+
+                *piecep = p;
+                *pp = q;
+                return q - p;
+        }
+
+        r = c_json_decode_string(pp, end, scratch, 4, &n_piece);
+        assert(!r);
+
+        *piecep = scratch;
+        return n_piece;
+}
+
+/*
+ * Compares the decoded contents of @string against the first @n_other
+ * bytes of @other. Returns the memcmp() result of the first differing
+ * byte, or the difference of the lengths if one is a prefix of the
+ * other. With @prefix set, @string may be longer than @other.
+ */
+static int c_json_string_compare_n(const CJsonString *string, const char *other, size_t n_other, bool prefix) {
+        const char *p = string->raw, *end = string->raw + string->n_raw, *piece;
+        size_t n_piece, n_matched = 0;
+        char scratch[4];
+        int r;
+
+        while (p < end) {
+                n_piece = c_json_string_next(string, &p, scratch, &piece);
+
+                if (n_piece > n_other - n_matched) {
+                        r = memcmp(piece, other + n_matched, n_other - n_matched);
+                        return r ?: (prefix ? 0 : 1);
+                }
+
+                r = memcmp(piece, other + n_matched, n_piece);
+                if (r)
+                        return r;
+
+                n_matched += n_piece;
+        }
+
+        return n_matched < n_other ? -1 : 0;
+}
+
+/**
+ * c_json_reader_read_string_lazy() - read a string without decoding it
+ * @reader              reader object
+ * @stringp             return location for the string handle
+ *
+ * Validates the next string and returns a handle to its raw bytes in the
+ * input, rather than decoding and copying it. The c_json_string_*()
+ * helpers operate on the handle with the semantics of the decoded string,
+ * and only decode escape sequences as they pass them. The handle is valid
+ * as long as the input is.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a reader function
+ *         C_JSON_E_INVALID_TYPE if then next value is not a string
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ */
+_c_public_ int c_json_reader_read_string_lazy(CJsonReader *reader, CJsonString *stringp) {
+        const char *end;
+        bool escaped;
+        int r;
+
+        if (_c_unlikely_(reader->poison))
+                return reader->poison;
+
+        if (*reader->p != '"')
+                return (reader->poison = C_JSON_E_INVALID_TYPE);
+
+        end = reader->p + 1;
+        r = c_json_reader_scan_string(reader, &end, &escaped);
+        if (r) {
+                reader->p = end;
+                return (reader->poison = r);
+        }
+
+        *stringp = (CJsonString){
+                .raw = reader->p + 1,
+                .n_raw = end - reader->p - 1,
+                .escaped = escaped,
+        };
+
+        reader->p = end + 1;
+        return c_json_reader_advance(reader);
+}
+
+/**
+ * c_json_string_length() - length of a string handle
+ * @string              string handle
+ *
+ * Return: the length of the decoded string, in bytes
+ */
+_c_public_ size_t c_json_string_length(const CJsonString *string) {
+        const char *p = string->raw, *end = string->raw + string->n_raw, *piece;
+        char scratch[4];
+        size_t n = 0;
+
+        if (!string->escaped)
+                return string->n_raw;
+
+        while (p < end)
+                n += c_json_string_next(string, &p, scratch, &piece);
+
+        return n;
+}
+
+/**
+ * c_json_string_compare() - compare a string handle against a C string
+ * @string              string handle
+ * @other               0-terminated string to compare against
+ *
+ * Compares the decoded string byte-wise, like strcmp(). A decoded
+ * 0-byte compares like any other byte, so a string with embedded
+ * 0-bytes never equals a C string.
+ *
+ * Return: <0, 0 or >0 if @string sorts before, equal to or after @other
+ */
+_c_public_ int c_json_string_compare(const CJsonString *string, const char *other) {
+        size_t n_other = strlen(other);
+        int r;
+
+        if (!string->escaped) {
+                r = memcmp(string->raw, other, c_min(string->n_raw, n_other));
+                return r ?: (string->n_raw > n_other) - (string->n_raw < n_other);
+        }
+
+        return c_json_string_compare_n(string, other, n_other, false);
+}
+
+/**
+ * c_json_string_has_prefix() - check the start of a string handle
+ * @string              string handle
+ * @prefix              0-terminated prefix
+ *
+ * Return: true if the decoded string starts with @prefix
+ */
+_c_public_ bool c_json_string_has_prefix(const CJsonString *string, const char *prefix) {
+        size_t n_prefix = strlen(prefix);
+
+        if (!string->escaped)
+                return string->n_raw >= n_prefix && !memcmp(string->raw, prefix, n_prefix);
+
+        return !c_json_string_compare_n(string, prefix, n_prefix, true);
+}
+
+/**
+ * c_json_string_hash() - hash a string handle
+ * @string              string handle
+ *
+ * Hashes the decoded string with 64-bit FNV-1a, so equal strings hash
+ * equally regardless of how they were escaped.
+ *
+ * Return: the hash of the decoded string
+ */
+_c_public_ uint64_t c_json_string_hash(const CJsonString *string) {
+        const char *p = string->raw, *end = string->raw + string->n_raw, *piece;
+        uint64_t hash = UINT64_C(0xcbf29ce484222325);
+        size_t n_piece;
+        char scratch[4];
+
+        while (p < end) {
+                n_piece = c_json_string_next(string, &p, scratch, &piece);
+
+                for (size_t i = 0; i < n_piece; i += 1) {
+                        hash ^= (uint8_t)piece[i];
+                        hash *= UINT64_C(0x100000001b3);
+                }
+        }
+
+        return hash;
+}
+
+/**
+ * c_json_string_decode() - decode a string handle into a buffer
+ * @string              string handle
+ * @buffer              buffer to decode into
+ * @n_buffer            size of @buffer
+ * @n_stringp           return location for the decoded length, or NULL
+ *
+ * Writes the decoded string and a 0-terminator to @buffer. A buffer of
+ * the raw length plus one is always large enough.
+ *
+ * Return: 0 on success
+ *         -ENOBUFS if @buffer is too small, its contents are undefined
+ */
+_c_public_ int c_json_string_decode(const CJsonString *string, char *buffer, size_t n_buffer, size_t *n_stringp) {
+        const char *p = string->raw, *end = string->raw + string->n_raw, *piece;
+        size_t n_piece, n = 0;
+        char scratch[4];
+
+        while (p < end) {
+                n_piece = c_json_string_next(string, &p, scratch, &piece);
+                if (n_piece >= n_buffer - n)
+                        return -ENOBUFS;
+
+                memcpy(buffer + n, piece, n_piece);
+                n += n_piece;
+        }
+
+        if (n >= n_buffer)
+                return -ENOBUFS;
+
+        buffer[n] = '\0';
+        if (n_stringp)
+                *n_stringp = n;
+
+        return 0;
+}
+
+/**
+ * c_json_string_dup() - decode a string handle into a new string
+ * @string              string handle
+ * @stringp             return location for the string
+ *
+ * The returned string must be freed.
+ *
+ * Return: 0 on success
+ *         -ENOMEM if allocating the string failed
+ */
+_c_public_ int c_json_string_dup(const CJsonString *string, char **stringp) {
+        char *buffer;
+        int r;
+
+        buffer = malloc(string->n_raw + 1);
+        if (!buffer)
+                return -ENOMEM;
+
+        r = c_json_string_decode(string, buffer, string->n_raw + 1, NULL);
+        assert(!r);
+
+        *stringp = buffer;
+        return 0;
+}
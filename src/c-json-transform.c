@@ -0,0 +1,527 @@
+
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+typedef struct CJsonTransformSegment CJsonTransformSegment;
+typedef struct CJsonTransformRule CJsonTransformRule;
+typedef struct CJsonTransformContext CJsonTransformContext;
+
+struct CJsonTransformSegment {
+        /* unescaped object key, or NULL for the wildcard segment */
+        char *key;
+        /* array index, or SIZE_MAX if @key is not a valid index */
+        size_t index;
+};
+
+struct CJsonTransformRule {
+        int action;
+        CJsonTransformSegment *segments;
+        size_t n_segments;
+
+        /*
+         * JSON text that is emitted when the rule matches: the
+         * replacement value for C_JSON_TRANSFORM_REPLACE and the encoded
+         * key for C_JSON_TRANSFORM_RENAME.
+         */
+        char *text;
+        size_t n_text;
+};
+
+struct CJsonTransform {
+        CJsonTransformRule *rules;
+        size_t n_rules;
+        size_t max_segments;
+};
+
+struct CJsonTransformContext {
+        CJsonTransform *transform;
+        CJsonReader *reader;
+        FILE *output;
+
+        /* end of the input that was already written to @output */
+        const char *copied;
+
+        /* rule indices that are still alive, @transform->n_rules per level */
+        size_t *alive;
+};
+
+static void c_json_transform_rule_deinit(CJsonTransformRule *rule) {
+        for (size_t i = 0; i < rule->n_segments; i += 1)
+                free(rule->segments[i].key);
+        free(rule->segments);
+        free(rule->text);
+}
+
+/*
+ * Splits a JSON pointer (RFC 6901) into its segments. A segment that
+ * consists of a single '*' matches every key and every array index.
+ */
+static int c_json_transform_parse_path(CJsonTransformRule *rule, const char *path) {
+        if (*path != '/')
+                return -EINVAL;
+
+        while (*path == '/') {
+                CJsonTransformSegment *segments, *segment;
+                const char *end;
+                char *key;
+
+                path += 1;
+                end = strchrnul(path, '/');
+
+                segments = realloc(rule->segments, (rule->n_segments + 1) * sizeof(*segments));
+                if (!segments)
+                        return -ENOMEM;
+
+                rule->segments = segments;
+                segment = &rule->segments[rule->n_segments];
+                *segment = (CJsonTransformSegment){ .index = SIZE_MAX };
+
+                if (end - path == 1 && *path == '*') {
+                        rule->n_segments += 1;
+                        path = end;
+                        continue;
+                }
+
+                key = malloc(end - path + 1);
+                if (!key)
+                        return -ENOMEM;
+
+                segment->key = key;
+                rule->n_segments += 1;
+
+                for (; path < end; path += 1) {
+                        if (*path != '~') {
+                                *key++ = *path;
+                                continue;
+                        }
+
+                        path += 1;
+                        if (path < end && *path == '0')
+                                *key++ = '~';
+                        else if (path < end && *path == '1')
+                                *key++ = '/';
+                        else
+                                return -EINVAL;
+                }
+                *key = '\0';
+
+                if (segment->key[0] >= '0' && segment->key[0] <= '9' &&
+                    (segment->key[0] != '0' || segment->key[1] == '\0')) {
+                        char *digits;
+                        unsigned long long index;
+
+                        errno = 0;
+                        index = strtoull(segment->key, &digits, 10);
+                        if (!errno && *digits == '\0' && index < SIZE_MAX)
+                                segment->index = index;
+                }
+        }
+
+        return 0;
+}
+
+static int c_json_transform_encode_key(CJsonTransformRule *rule, const char *key) {
+        _c_cleanup_(c_fclosep) FILE *stream = NULL;
+        _c_cleanup_(c_freep) char *text = NULL;
+        size_t n_text;
+
+        stream = open_memstream(&text, &n_text);
+        if (!stream)
+                return -ENOMEM;
+
+        fputc('"', stream);
+        for (const char *p = key; *p; p += 1) {
+                switch (*p) {
+                case '"':
+                        fputs("\\\"", stream);
+                        break;
+                case '\\':
+                        fputs("\\\\", stream);
+                        break;
+                case '\n':
+                        fputs("\\n", stream);
+                        break;
+                case '\r':
+                        fputs("\\r", stream);
+                        break;
+                case '\t':
+                        fputs("\\t", stream);
+                        break;
+                case 0x01 ... 0x08:
+                case 0x0b ... 0x0c:
+                case 0x0e ... 0x1f:
+                        fprintf(stream, "\\u%04x", (unsigned int)*p);
+                        break;
+                default:
+                        fputc(*p, stream);
+                        break;
+                }
+        }
+        fputc('"', stream);
+
+        if (ferror(stream))
+                return -ENOMEM;
+
+        stream = c_fclose(stream);
+
+        rule->text = text;
+        rule->n_text = n_text;
+        text = NULL;
+
+        return 0;
+}
+
+static int c_json_transform_copy_value(CJsonTransformRule *rule, const char *value) {
+        int r;
+
+        r = c_json_validate(value, strlen(value), C_JSON_VALIDATE_DEPTH_MAX, NULL);
+        if (r)
+                return r;
+
+        rule->text = strdup(value);
+        if (!rule->text)
+                return -ENOMEM;
+
+        rule->n_text = strlen(value);
+
+        return 0;
+}
+
+/**
+ * c_json_transform_new() - allocate an empty transform
+ * @transformp:         return location
+ *
+ * Return: <0 on fatal failures
+ *         0 on success
+ */
+_c_public_ int c_json_transform_new(CJsonTransform **transformp) {
+        CJsonTransform *transform;
+
+        transform = calloc(1, sizeof(*transform));
+        if (!transform)
+                return -ENOMEM;
+
+        *transformp = transform;
+
+        return 0;
+}
+
+/**
+ * c_json_transform_free() - free a transform and all its rules
+ * @transform:          transform to free
+ *
+ * Return: NULL
+ */
+_c_public_ CJsonTransform * c_json_transform_free(CJsonTransform *transform) {
+        if (!transform)
+                return NULL;
+
+        for (size_t i = 0; i < transform->n_rules; i += 1)
+                c_json_transform_rule_deinit(&transform->rules[i]);
+        free(transform->rules);
+        free(transform);
+
+        return NULL;
+}
+
+/**
+ * c_json_transform_add() - add a rule to a transform
+ * @transform           transform object
+ * @path                JSON pointer of the values the rule applies to
+ * @action              one of the C_JSON_TRANSFORM_ actions
+ * @argument            replacement value or new key, depending on @action
+ *
+ * Adds a rule that applies @action to every value matching @path. The
+ * path is a JSON pointer as described in RFC 6901, with the addition
+ * that a segment consisting of a single '*' matches any key or index.
+ *
+ * C_JSON_TRANSFORM_DROP removes the matching member or element
+ * altogether, @argument must be NULL. C_JSON_TRANSFORM_REPLACE replaces
+ * the matching value with @argument, which must be a valid JSON value
+ * nested at most C_JSON_VALIDATE_DEPTH_MAX levels deep.
+ * C_JSON_TRANSFORM_RENAME renames the key of the matching member to
+ * @argument, which is a plain string that is escaped as needed. Nested
+ * values of a renamed member are still subject to the other rules.
+ *
+ * If more than one rule matches the same value, the rule that was added
+ * first takes effect.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         -EINVAL if @path or @action is invalid
+ *         C_JSON_E_INVALID_JSON if the replacement value is malformed
+ *         C_JSON_E_DEPTH_OVERFLOW if the replacement value is nested deeper
+ *                                 than C_JSON_VALIDATE_DEPTH_MAX
+ */
+_c_public_ int c_json_transform_add(CJsonTransform *transform, const char *path, int action, const char *argument) {
+        CJsonTransformRule rule = { .action = action };
+        CJsonTransformRule *rules;
+        int r;
+
+        switch (action) {
+        case C_JSON_TRANSFORM_DROP:
+                if (argument)
+                        return -EINVAL;
+                break;
+        case C_JSON_TRANSFORM_REPLACE:
+        case C_JSON_TRANSFORM_RENAME:
+                if (!argument)
+                        return -EINVAL;
+                break;
+        default:
+                return -EINVAL;
+        }
+
+        r = c_json_transform_parse_path(&rule, path);
+        if (r)
+                goto error;
+
+        if (action == C_JSON_TRANSFORM_REPLACE)
+                r = c_json_transform_copy_value(&rule, argument);
+        else if (action == C_JSON_TRANSFORM_RENAME)
+                r = c_json_transform_encode_key(&rule, argument);
+        if (r)
+                goto error;
+
+        rules = realloc(transform->rules, (transform->n_rules + 1) * sizeof(*rules));
+        if (!rules) {
+                r = -ENOMEM;
+                goto error;
+        }
+
+        transform->rules = rules;
+        transform->rules[transform->n_rules++] = rule;
+        transform->max_segments = c_max(transform->max_segments, rule.n_segments);
+
+        return 0;
+
+error:
+        c_json_transform_rule_deinit(&rule);
+        return r;
+}
+
+static bool c_json_transform_segment_matches(CJsonTransformSegment *segment, const char *key, size_t index) {
+        if (!segment->key)
+                return true;
+
+        if (key)
+                return !strcmp(segment->key, key);
+
+        return segment->index == index;
+}
+
+/*
+ * Returns the end of the token that precedes @p, given that @p was
+ * reached by skipping whitespace and at most one separator behind it.
+ */
+static const char * c_json_transform_token_end(const char *start, const char *p) {
+        while (p > start && is_whitespace(p[-1]))
+                p -= 1;
+
+        if (p > start && (p[-1] == ',' || p[-1] == ':')) {
+                p -= 1;
+                while (p > start && is_whitespace(p[-1]))
+                        p -= 1;
+        }
+
+        return p;
+}
+
+static int c_json_transform_write(CJsonTransformContext *ctx, const char *data, size_t n_data) {
+        if (n_data && fwrite(data, 1, n_data, ctx->output) != n_data)
+                return -ENOTRECOVERABLE;
+
+        return 0;
+}
+
+/* copies the input up to @end verbatim, unless it was copied or dropped already */
+static int c_json_transform_flush(CJsonTransformContext *ctx, const char *end) {
+        int r;
+
+        if (end <= ctx->copied)
+                return 0;
+
+        r = c_json_transform_write(ctx, ctx->copied, end - ctx->copied);
+        if (r)
+                return r;
+
+        ctx->copied = end;
+
+        return 0;
+}
+
+static int c_json_transform_value(CJsonTransformContext *ctx, size_t depth, const size_t *alive, size_t n_alive);
+
+static int c_json_transform_container(CJsonTransformContext *ctx, size_t depth, const size_t *alive, size_t n_alive, bool object) {
+        CJsonTransform *transform = ctx->transform;
+        CJsonReader *reader = ctx->reader;
+        size_t *next = ctx->alive + (depth + 1) * transform->n_rules;
+        const char *previous = NULL;
+        bool skip_separator = false;
+        int r;
+
+        r = object ? c_json_reader_enter_object(reader) : c_json_reader_enter_array(reader);
+        if (r)
+                return r;
+
+        for (size_t index = 0; c_json_reader_more(reader); index += 1) {
+                _c_cleanup_(c_freep) char *key = NULL;
+                CJsonTransformRule *match = NULL;
+                const char *member = reader->p, *value;
+                size_t n_next = 0;
+
+                if (skip_separator) {
+                        ctx->copied = member;
+                        skip_separator = false;
+                }
+
+                if (object) {
+                        r = c_json_reader_read_string(reader, &key);
+                        if (r)
+                                return r;
+                }
+
+                value = reader->p;
+
+                for (size_t i = 0; i < n_alive; i += 1) {
+                        CJsonTransformRule *rule = &transform->rules[alive[i]];
+
+                        if (!c_json_transform_segment_matches(&rule->segments[depth], key, index))
+                                continue;
+
+                        if (rule->n_segments > depth + 1)
+                                next[n_next++] = alive[i];
+                        else if (!match && (object || rule->action != C_JSON_TRANSFORM_RENAME))
+                                match = rule;
+                }
+
+                if (match && match->action == C_JSON_TRANSFORM_DROP) {
+                        r = c_json_reader_skip(reader);
+                        if (r)
+                                return r;
+
+                        /*
+                         * Drop the separator in front of the member if
+                         * there is a previous member left, otherwise the
+                         * one behind it.
+                         */
+                        if (previous) {
+                                r = c_json_transform_flush(ctx, previous);
+                        } else {
+                                r = c_json_transform_flush(ctx, member);
+                                skip_separator = true;
+                        }
+                        if (r)
+                                return r;
+
+                        ctx->copied = c_json_transform_token_end(value, reader->p);
+                        continue;
+                }
+
+                if (match && match->action == C_JSON_TRANSFORM_REPLACE) {
+                        r = c_json_transform_flush(ctx, value);
+                        if (r)
+                                return r;
+
+                        r = c_json_transform_write(ctx, match->text, match->n_text);
+                        if (r)
+                                return r;
+
+                        r = c_json_reader_skip(reader);
+                        if (r)
+                                return r;
+
+                        ctx->copied = c_json_transform_token_end(value, reader->p);
+                } else {
+                        if (match) {
+                                r = c_json_transform_flush(ctx, member);
+                                if (r)
+                                        return r;
+
+                                r = c_json_transform_write(ctx, match->text, match->n_text);
+                                if (r)
+                                        return r;
+
+                                ctx->copied = c_json_transform_token_end(member, value);
+                        }
+
+                        r = c_json_transform_value(ctx, depth + 1, next, n_next);
+                        if (r)
+                                return r;
+                }
+
+                previous = c_json_transform_token_end(value, reader->p);
+        }
+
+        return object ? c_json_reader_exit_object(reader) : c_json_reader_exit_array(reader);
+}
+
+static int c_json_transform_value(CJsonTransformContext *ctx, size_t depth, const size_t *alive, size_t n_alive) {
+        if (n_alive) {
+                switch (c_json_reader_peek(ctx->reader)) {
+                case C_JSON_TYPE_ARRAY:
+                        return c_json_transform_container(ctx, depth, alive, n_alive, false);
+                case C_JSON_TYPE_OBJECT:
+                        return c_json_transform_container(ctx, depth, alive, n_alive, true);
+                }
+        }
+
+        return c_json_reader_skip(ctx->reader);
+}
+
+/**
+ * c_json_transform_run() - transform the next value of a reader
+ * @transform           transform object
+ * @reader              reader to read the input from
+ * @output              stream to write the result to
+ *
+ * Reads the root value from @reader, which must be positioned at the
+ * start of its input, and writes it to @output with the rules of
+ * @transform applied. Everything that is not affected by a rule,
+ * including whitespace, is copied verbatim from the input. Only
+ * containers that lie on the path of a rule are parsed, everything else
+ * is skipped and copied as a whole.
+ *
+ * The caller is expected to call c_json_reader_end_read() afterwards to
+ * check for trailing garbage. If the input is malformed, the output is
+ * truncated at an unspecified position.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a reader function
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
+ */
+_c_public_ int c_json_transform_run(CJsonTransform *transform, CJsonReader *reader, FILE *output) {
+        _c_cleanup_(c_freep) size_t *alive = NULL;
+        CJsonTransformContext ctx = {
+                .transform = transform,
+                .reader = reader,
+                .output = output,
+                .copied = reader->input,
+        };
+        int r;
+
+        assert(reader->input && reader->level == 0);
+
+        if (transform->n_rules) {
+                alive = malloc((transform->max_segments + 1) * transform->n_rules * sizeof(*alive));
+                if (!alive)
+                        return -ENOMEM;
+
+                for (size_t i = 0; i < transform->n_rules; i += 1)
+                        alive[i] = i;
+        }
+
+        ctx.alive = alive;
+
+        r = c_json_transform_value(&ctx, 0, alive, transform->n_rules);
+        if (r)
+                return r;
+
+        return c_json_transform_flush(&ctx, reader->p);
+}
@@ -0,0 +1,333 @@
+
+#include <c-stdaux.h>
+#include <c-utf8.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+enum {
+        C_JSON_VALIDATE_VALUE,
+        C_JSON_VALIDATE_KEY,
+        C_JSON_VALIDATE_NEXT,
+};
+
+static bool c_json_validate_in_object(const uint64_t *objects, size_t depth) {
+        return objects[(depth - 1) / 64] & (UINT64_C(1) << ((depth - 1) % 64));
+}
+
+static const char * c_json_validate_skip_space(const char *p, const char *end) {
+        while (p < end && is_whitespace(*p))
+                p += 1;
+
+        return p;
+}
+
+/*
+ * Validates the string contents at *@pp, which must not extend beyond
+ * @end. The input up to @verified is known to be valid UTF-8. Plain
+ * ASCII is skipped directly, everything else is passed to
+ * c_json_decode_string() one unit at a time. Close to @end, the rest of
+ * the input is copied into a 0-terminated scratch buffer first, so that
+ * the decoder never reads beyond the input.
+ *
+ * On return, *@pp points behind the closing '"', or to the faulty byte.
+ */
+static int c_json_validate_string(const char **pp, const char *end, const char *verified) {
+        const char *p = *pp, *q;
+        char scratch[4];
+        size_t n_scratch;
+        int r = 0;
+
+        for (;;) {
+                if (_c_unlikely_(p >= end)) {
+                        r = C_JSON_E_INVALID_JSON;
+                        break;
+                }
+
+                switch ((uint8_t)*p) {
+                case '"':
+                        p += 1;
+                        goto out;
+                case 0x20 ... '"' - 1:
+                case '"' + 1 ... '\\' - 1:
+                case '\\' + 1 ... 0x7F:
+                        p += 1;
+                        continue;
+                default:
+                        break;
+                }
+
+                /* the longest unit is a surrogate pair of two \uXXXX escapes */
+                if (end - p >= 12) {
+                        q = p;
+                        r = c_json_decode_string(&q, verified, scratch, sizeof(scratch), &n_scratch);
+                        p = q;
+                } else {
+                        char tail[13] = {};
+
+                        memcpy(tail, p, end - p);
+                        q = tail;
+                        r = c_json_decode_string(&q, tail, scratch, sizeof(scratch), &n_scratch);
+                        p += q - tail;
+                }
+                if (r)
+                        break;
+        }
+
+out:
+        *pp = p;
+        return r;
+}
+
+/**
+ * c_json_validate() - validate a JSON document
+ * @input               input to validate
+ * @n_input             length of @input in bytes
+ * @max_depth           maximum nesting depth
+ * @offsetp             return location for the offset of the first error, or NULL
+ *
+ * Checks whether @input is a single, well-formed JSON value, optionally
+ * surrounded by whitespace. Numbers, escape sequences, surrogate pairs and
+ * UTF-8 are checked by the same code as in the reader functions.
+ *
+ * Unlike the reader, @input does not need to be 0-terminated. It is
+ * validated in a single pass, without recursion and without allocating
+ * memory. The nesting state is kept in a bit-stack on the stack, which
+ * limits @max_depth to C_JSON_VALIDATE_DEPTH_MAX.
+ *
+ * If @input is not valid, *@offsetp is set to the offset of the byte at
+ * which the error was detected. On success, it is set to @n_input.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         -EINVAL if @max_depth is larger than C_JSON_VALIDATE_DEPTH_MAX
+ *         C_JSON_E_INVALID_JSON if the JSON input is malformed
+ *         C_JSON_E_DEPTH_OVERFLOW if the nesting depth is too high
+ */
+_c_public_ int c_json_validate(const char *input, size_t n_input, size_t max_depth, size_t *offsetp) {
+        uint64_t objects[C_JSON_VALIDATE_DEPTH_MAX / 64];
+        const char *p = input, *end = input + n_input, *verified = input;
+        size_t depth = 0, n_number, n_verified = n_input;
+        int state = C_JSON_VALIDATE_VALUE, r = 0;
+
+        if (max_depth > C_JSON_VALIDATE_DEPTH_MAX)
+                return -EINVAL;
+
+        /* one pass over the whole input, strings then skip their UTF-8 checks */
+        c_utf8_verify(&verified, &n_verified);
+
+        p = c_json_validate_skip_space(p, end);
+
+        for (;;) {
+                switch (state) {
+                case C_JSON_VALIDATE_VALUE:
+                        if (p >= end) {
+                                r = C_JSON_E_INVALID_JSON;
+                                goto out;
+                        }
+
+                        switch (*p) {
+                        case '[':
+                        case '{':
+                                if (depth >= max_depth) {
+                                        r = C_JSON_E_DEPTH_OVERFLOW;
+                                        goto out;
+                                }
+
+                                if (*p == '{')
+                                        objects[depth / 64] |= UINT64_C(1) << (depth % 64);
+                                else
+                                        objects[depth / 64] &= ~(UINT64_C(1) << (depth % 64));
+                                depth += 1;
+
+                                p = c_json_validate_skip_space(p + 1, end);
+                                if (p < end && (*p == ']' || *p == '}')) {
+                                        /* empty container, closed by the NEXT state */
+                                        state = C_JSON_VALIDATE_NEXT;
+                                } else if (c_json_validate_in_object(objects, depth)) {
+                                        state = C_JSON_VALIDATE_KEY;
+                                }
+                                continue;
+
+                        case '"':
+                                p += 1;
+                                r = c_json_validate_string(&p, end, verified);
+                                if (r)
+                                        goto out;
+                                break;
+
+                        case '-':
+                        case '0' ... '9':
+                                if (!c_json_reader_parse_number(p, end - p, &n_number)) {
+                                        p += n_number;
+                                        r = C_JSON_E_INVALID_JSON;
+                                        goto out;
+                                }
+                                p += n_number;
+                                break;
+
+                        case 't':
+                                if (end - p < 4 || memcmp(p, "true", 4)) {
+                                        r = C_JSON_E_INVALID_JSON;
+                                        goto out;
+                                }
+                                p += 4;
+                                break;
+
+                        case 'f':
+                                if (end - p < 5 || memcmp(p, "false", 5)) {
+                                        r = C_JSON_E_INVALID_JSON;
+                                        goto out;
+                                }
+                                p += 5;
+                                break;
+
+                        case 'n':
+                                if (end - p < 4 || memcmp(p, "null", 4)) {
+                                        r = C_JSON_E_INVALID_JSON;
+                                        goto out;
+                                }
+                                p += 4;
+                                break;
+
+                        default:
+                                r = C_JSON_E_INVALID_JSON;
+                                goto out;
+                        }
+
+                        state = C_JSON_VALIDATE_NEXT;
+                        continue;
+
+                case C_JSON_VALIDATE_KEY:
+                        if (p >= end || *p != '"') {
+                                r = C_JSON_E_INVALID_JSON;
+                                goto out;
+                        }
+
+                        p += 1;
+                        r = c_json_validate_string(&p, end, verified);
+                        if (r)
+                                goto out;
+
+                        p = c_json_validate_skip_space(p, end);
+                        if (p >= end || *p != ':') {
+                                r = C_JSON_E_INVALID_JSON;
+                                goto out;
+                        }
+
+                        p = c_json_validate_skip_space(p + 1, end);
+                        state = C_JSON_VALIDATE_VALUE;
+                        continue;
+
+                case C_JSON_VALIDATE_NEXT:
+                        p = c_json_validate_skip_space(p, end);
+                        if (depth == 0)
+                                goto out;
+
+                        if (p >= end) {
+                                r = C_JSON_E_INVALID_JSON;
+                                goto out;
+                        }
+
+                        if (c_json_validate_in_object(objects, depth)) {
+                                if (*p == ',') {
+                                        p = c_json_validate_skip_space(p + 1, end);
+                                        state = C_JSON_VALIDATE_KEY;
+                                } else if (*p == '}') {
+                                        p += 1;
+                                        depth -= 1;
+                                } else {
+                                        r = C_JSON_E_INVALID_JSON;
+                                        goto out;
+                                }
+                        } else {
+                                if (*p == ',') {
+                                        p = c_json_validate_skip_space(p + 1, end);
+                                        state = C_JSON_VALIDATE_VALUE;
+                                } else if (*p == ']') {
+                                        p += 1;
+                                        depth -= 1;
+                                } else {
+                                        r = C_JSON_E_INVALID_JSON;
+                                        goto out;
+                                }
+                        }
+                        continue;
+                }
+        }
+
+out:
+        if (!r && p != end)
+                r = C_JSON_E_INVALID_JSON;
+
+        if (offsetp)
+                *offsetp = r ? (size_t)(p - input) : n_input;
+
+        return r;
+}
+
+/*
+ * Counts the '\n' in @n bytes at @p, 8 bytes at a time. XOR-ing each
+ * byte with '\n' turns newlines into 0-bytes, which are then counted.
+ */
+static size_t c_json_count_newlines(const char *p, size_t n) {
+        const uint64_t ones = UINT64_C(0x0101010101010101);
+        size_t n_newlines = 0;
+        uint64_t word;
+
+        for (; n >= 8; p += 8, n -= 8) {
+                memcpy(&word, p, 8);
+                n_newlines += __builtin_popcountll(c_json_zero_bytes(word ^ ('\n' * ones)));
+        }
+
+        for (; n > 0; p += 1, n -= 1)
+                n_newlines += *p == '\n';
+
+        return n_newlines;
+}
+
+/**
+ * c_json_locate() - describe a position in the input
+ * @input               input
+ * @n_input             length of @input in bytes
+ * @offset              offset of the position in @input
+ * @locationp           return location
+ *
+ * Computes the line and column of the byte at @offset, both starting at
+ * 1, with columns counted in bytes. This is meant for error messages,
+ * with offsets from c_json_validate() or c_json_reader_error_offset(),
+ * and takes a pass over @input up to @offset to count the lines.
+ *
+ * The context is the part of the line around @offset, with at most
+ * C_JSON_CONTEXT_MAX bytes on either side of it. It points into @input
+ * and is not 0-terminated. @offset is at @context_offset in it.
+ *
+ * An @offset beyond @n_input is treated like @n_input.
+ */
+_c_public_ void c_json_locate(const char *input, size_t n_input, size_t offset, CJsonLocation *locationp) {
+        const char *p, *start, *end;
+
+        if (offset > n_input)
+                offset = n_input;
+
+        p = input + offset;
+
+        start = p;
+        while (start > input && start[-1] != '\n')
+                start -= 1;
+
+        end = memchr(p, '\n', n_input - offset) ?: input + n_input;
+
+        locationp->line = c_json_count_newlines(input, start - input) + 1;
+        locationp->column = p - start + 1;
+
+        if (p - start > C_JSON_CONTEXT_MAX)
+                start = p - C_JSON_CONTEXT_MAX;
+        if (end - p > C_JSON_CONTEXT_MAX)
+                end = p + C_JSON_CONTEXT_MAX;
+
+        locationp->context = start;
+        locationp->n_context = end - start;
+        locationp->context_offset = p - start;
+}
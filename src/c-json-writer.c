@@ -0,0 +1,831 @@
+
+#include <c-stdaux.h>
+#include <c-utf8.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include "c-json.h"
+#include "c-json-private.h"
+
+/* size of the buffer for structural output and short strings */
+#define C_JSON_WRITER_BUFFER (64 * 1024)
+
+/* maximum number of iovec entries passed to a single writev() */
+#define C_JSON_WRITER_IOV 64
+
+/* minimum length of a run of string bytes that is referenced, not copied */
+#define C_JSON_WRITER_REF_MIN 4096
+
+typedef struct CJsonWriterBatch CJsonWriterBatch;
+
+/*
+ * Output collected for a single writev(). The iovec entries point either
+ * into @buffer or to caller memory passed to c_json_writer_write_string_ref().
+ * Buffered bytes from @segment onwards are not yet covered by an entry.
+ */
+struct CJsonWriterBatch {
+        char buffer[C_JSON_WRITER_BUFFER];
+        size_t n_buffer;
+        size_t segment;
+        struct iovec iov[C_JSON_WRITER_IOV];
+        size_t n_iov;
+};
+
+struct CJsonWriter {
+        int fd;
+
+        /*
+         * Last error code. If it is non-zero, every function turns into
+         * a no-op and returns this value.
+         */
+        int poison;
+
+        /*
+         * The batch being filled. In async mode, the other batch is
+         * handed to the background thread once this one is full, and
+         * @pending is the batch the thread is draining, if any. @error is
+         * the first write error of the thread.
+         */
+        CJsonWriterBatch *batch;
+        CJsonWriterBatch batches[2];
+
+        bool async;
+        bool stop;
+        pthread_t thread;
+        pthread_mutex_t lock;
+        pthread_cond_t cond;
+        CJsonWriterBatch *pending;
+        int error;
+
+        /*
+         * State for each nesting level. @n_states is the maximum
+         * nesting depth. For each level, the state can be:
+         *
+         *  0: root level, before the value
+         *  '.': root level, behind the value
+         *
+         *  '[': in an array, before the first value
+         *  ',': in an array, behind a value
+         *
+         *  '{': in an object, before the first key
+         *  'k': in an object, behind a value
+         *  ':': in an object, behind a key
+         */
+        size_t n_states;
+        size_t level;
+        char states[];
+};
+
+static void c_json_writer_batch_reset(CJsonWriterBatch *batch) {
+        batch->n_buffer = 0;
+        batch->segment = 0;
+        batch->n_iov = 0;
+}
+
+static void c_json_writer_batch_close(CJsonWriterBatch *batch) {
+        if (batch->n_buffer > batch->segment) {
+                batch->iov[batch->n_iov++] = (struct iovec){
+                        .iov_base = batch->buffer + batch->segment,
+                        .iov_len = batch->n_buffer - batch->segment,
+                };
+                batch->segment = batch->n_buffer;
+        }
+}
+
+/*
+ * Writes all entries of @batch to @fd, continuing after short writes.
+ */
+static int c_json_writer_batch_write(CJsonWriterBatch *batch, int fd) {
+        struct iovec *iov = batch->iov;
+        size_t n_iov = batch->n_iov;
+        ssize_t l;
+
+        while (n_iov) {
+                l = writev(fd, iov, n_iov);
+                if (l < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        return -errno;
+                }
+
+                while (n_iov && (size_t)l >= iov->iov_len) {
+                        l -= iov->iov_len;
+                        iov += 1;
+                        n_iov -= 1;
+                }
+
+                if (n_iov) {
+                        iov->iov_base = (char *)iov->iov_base + l;
+                        iov->iov_len -= l;
+                }
+        }
+
+        return 0;
+}
+
+static void *c_json_writer_thread(void *userdata) {
+        CJsonWriter *writer = userdata;
+        CJsonWriterBatch *batch;
+        int r;
+
+        pthread_mutex_lock(&writer->lock);
+
+        for (;;) {
+                while (!writer->pending && !writer->stop)
+                        pthread_cond_wait(&writer->cond, &writer->lock);
+
+                if (!writer->pending)
+                        break;
+
+                batch = writer->pending;
+                pthread_mutex_unlock(&writer->lock);
+
+                r = c_json_writer_batch_write(batch, writer->fd);
+                c_json_writer_batch_reset(batch);
+
+                pthread_mutex_lock(&writer->lock);
+                if (r && !writer->error)
+                        writer->error = r;
+                writer->pending = NULL;
+                pthread_cond_broadcast(&writer->cond);
+        }
+
+        pthread_mutex_unlock(&writer->lock);
+
+        return NULL;
+}
+
+/*
+ * Waits for the background thread to finish the pending batch, if any.
+ *
+ * Return: 0 on success, or the first write error of the thread
+ */
+static int c_json_writer_wait(CJsonWriter *writer) {
+        int r;
+
+        pthread_mutex_lock(&writer->lock);
+        while (writer->pending)
+                pthread_cond_wait(&writer->cond, &writer->lock);
+        r = writer->error;
+        pthread_mutex_unlock(&writer->lock);
+
+        return r;
+}
+
+/*
+ * Passes the current batch on to the output. In async mode it is handed
+ * to the background thread and serialization continues on the other
+ * batch, which has been drained by then.
+ */
+static int c_json_writer_flush(CJsonWriter *writer) {
+        CJsonWriterBatch *batch = writer->batch;
+        int r;
+
+        c_json_writer_batch_close(batch);
+        if (!batch->n_iov)
+                return 0;
+
+        if (!writer->async) {
+                r = c_json_writer_batch_write(batch, writer->fd);
+                c_json_writer_batch_reset(batch);
+                return r;
+        }
+
+        r = c_json_writer_wait(writer);
+        if (r)
+                return r;
+
+        pthread_mutex_lock(&writer->lock);
+        writer->pending = batch;
+        pthread_cond_broadcast(&writer->cond);
+        pthread_mutex_unlock(&writer->lock);
+
+        writer->batch = batch == &writer->batches[0] ? &writer->batches[1] : &writer->batches[0];
+
+        return 0;
+}
+
+static int c_json_writer_append(CJsonWriter *writer, const char *data, size_t n_data) {
+        CJsonWriterBatch *batch = writer->batch;
+        size_t n;
+        int r;
+
+        /* the common case, @data fits into the buffer */
+        if (_c_likely_(n_data <= sizeof(batch->buffer) - batch->n_buffer)) {
+                memcpy(batch->buffer + batch->n_buffer, data, n_data);
+                batch->n_buffer += n_data;
+                return 0;
+        }
+
+        while (n_data) {
+                if (batch->n_buffer == sizeof(batch->buffer)) {
+                        r = c_json_writer_flush(writer);
+                        if (r)
+                                return r;
+
+                        batch = writer->batch;
+                }
+
+                n = c_min(n_data, sizeof(batch->buffer) - batch->n_buffer);
+                memcpy(batch->buffer + batch->n_buffer, data, n);
+                batch->n_buffer += n;
+                data += n;
+                n_data -= n;
+        }
+
+        return 0;
+}
+
+/*
+ * Adds @data to the output by reference. It is passed to writev() as its
+ * own entry, between the buffered output before and after it.
+ */
+static int c_json_writer_reference(CJsonWriter *writer, const char *data, size_t n_data) {
+        CJsonWriterBatch *batch = writer->batch;
+        int r;
+
+        if (batch->n_iov + 2 >= C_JSON_WRITER_IOV) {
+                r = c_json_writer_flush(writer);
+                if (r)
+                        return r;
+
+                batch = writer->batch;
+        }
+
+        c_json_writer_batch_close(batch);
+        batch->iov[batch->n_iov++] = (struct iovec){
+                .iov_base = (void *)data,
+                .iov_len = n_data,
+        };
+
+        return 0;
+}
+
+/*
+ * Returns the length of the prefix of @p that needs no escaping and is
+ * plain ASCII, looking at no more than @n bytes. Checks 8 bytes at a
+ * time: a byte is flagged if it is below 0x20, '"', '\\', or has its high
+ * bit set.
+ */
+static size_t c_json_writer_plain(const char *p, size_t n) {
+        const uint64_t ones = UINT64_C(0x0101010101010101), highs = UINT64_C(0x8080808080808080);
+        size_t i = 0;
+        uint64_t w, q, b;
+
+        for (; i + 8 <= n; i += 8) {
+                memcpy(&w, p + i, 8);
+                q = w ^ (ones * '"');
+                b = w ^ (ones * '\\');
+                if (((w - ones * 0x20) | (q - ones) | (b - ones) | w) & highs)
+                        break;
+        }
+
+        while (i < n && (uint8_t)p[i] >= 0x20 && (uint8_t)p[i] < 0x80 && p[i] != '"' && p[i] != '\\')
+                i += 1;
+
+        return i;
+}
+
+static int c_json_writer_run(CJsonWriter *writer, const char *run, size_t n_run, bool ref) {
+        if (ref && n_run >= C_JSON_WRITER_REF_MIN)
+                return c_json_writer_reference(writer, run, n_run);
+
+        return c_json_writer_append(writer, run, n_run);
+}
+
+/*
+ * Writes @string as quoted JSON string. Runs of bytes that need no
+ * escaping are copied as a whole, or with @ref set, referenced if they
+ * are long enough.
+ *
+ * Return: 0 on success
+ *         C_JSON_E_INVALID_JSON if @string is not valid UTF-8
+ */
+static int c_json_writer_string(CJsonWriter *writer, const char *string, size_t n_string, bool ref) {
+        static const char hex[] = "0123456789abcdef";
+        const char *run = string, *p = string, *end = string + n_string;
+        char escape[6];
+        size_t n_escape;
+        int r;
+
+        r = c_json_writer_append(writer, "\"", 1);
+        if (r)
+                return r;
+
+        while (p < end) {
+                p += c_json_writer_plain(p, end - p);
+                if (p == end)
+                        break;
+
+                switch ((uint8_t)*p) {
+                case '"':
+                case '\\':
+                        escape[0] = '\\';
+                        escape[1] = *p;
+                        n_escape = 2;
+                        break;
+                case '\b':
+                        memcpy(escape, "\\b", n_escape = 2);
+                        break;
+                case '\f':
+                        memcpy(escape, "\\f", n_escape = 2);
+                        break;
+                case '\n':
+                        memcpy(escape, "\\n", n_escape = 2);
+                        break;
+                case '\r':
+                        memcpy(escape, "\\r", n_escape = 2);
+                        break;
+                case '\t':
+                        memcpy(escape, "\\t", n_escape = 2);
+                        break;
+                case 0x00 ... 0x07:
+                case 0x0B:
+                case 0x0E ... 0x1F:
+                        memcpy(escape, "\\u00", 4);
+                        escape[4] = hex[(uint8_t)*p >> 4];
+                        escape[5] = hex[(uint8_t)*p & 0xF];
+                        n_escape = 6;
+                        break;
+                case 0x20 ... '"' - 1:
+                case '"' + 1 ... '\\' - 1:
+                case '\\' + 1 ... 0x7F:
+                        p += 1;
+                        continue;
+                default:
+                {
+                        const char *str = p;
+                        size_t n_str = c_min((size_t)(end - p), (uint8_t)*p < 0xE0 ? 2 : (uint8_t)*p < 0xF0 ? 3 : 4);
+
+                        c_utf8_verify(&str, &n_str);
+                        if (str == p)
+                                return C_JSON_E_INVALID_JSON;
+
+                        p = str;
+                        continue;
+                }
+                }
+
+                r = c_json_writer_run(writer, run, p - run, ref);
+                if (r)
+                        return r;
+
+                r = c_json_writer_append(writer, escape, n_escape);
+                if (r)
+                        return r;
+
+                run = ++p;
+        }
+
+        r = c_json_writer_run(writer, run, p - run, ref);
+        if (r)
+                return r;
+
+        return c_json_writer_append(writer, "\"", 1);
+}
+
+/*
+ * Prepares the output for the next value: writes the separator and
+ * advances the state of the current level. If an object key is expected
+ * instead, *@keyp is set and nothing is written.
+ *
+ * Return: 0 on success
+ *         C_JSON_E_INVALID_TYPE if an object key is expected, but @keyp
+ *                               is NULL
+ *         C_JSON_E_INVALID_JSON if the document is complete
+ */
+static int c_json_writer_next(CJsonWriter *writer, bool *keyp) {
+        switch (writer->states[writer->level]) {
+        case 0:
+                writer->states[writer->level] = '.';
+                break;
+        case '[':
+                writer->states[writer->level] = ',';
+                break;
+        case ',':
+                return c_json_writer_append(writer, ",", 1);
+        case ':':
+                writer->states[writer->level] = 'k';
+                break;
+        case '{':
+        case 'k':
+                if (!keyp)
+                        return C_JSON_E_INVALID_TYPE;
+
+                *keyp = true;
+                break;
+        default:
+                return C_JSON_E_INVALID_JSON;
+        }
+
+        return 0;
+}
+
+static int c_json_writer_write_raw(CJsonWriter *writer, const char *data, size_t n_data) {
+        int r;
+
+        if (_c_unlikely_(writer->poison))
+                return writer->poison;
+
+        r = c_json_writer_next(writer, NULL);
+        if (r)
+                return (writer->poison = r);
+
+        r = c_json_writer_append(writer, data, n_data);
+        if (r)
+                return (writer->poison = r);
+
+        return 0;
+}
+
+/**
+ * c_json_writer_new() - allocate and initialize a writer
+ * @writerp:            return location
+ * @max_depth:          maximum nesting depth
+ * @flags:              C_JSON_WRITER_* flags
+ *
+ * With C_JSON_WRITER_ASYNC, the writer starts a background thread that
+ * writes out full buffers while serialization continues into a second
+ * buffer.
+ *
+ * Return: <0 on fatal failures
+ *         0 on success
+ */
+_c_public_ int c_json_writer_new(CJsonWriter **writerp, size_t max_depth, unsigned int flags) {
+        _c_cleanup_(c_json_writer_freep) CJsonWriter *writer = NULL;
+        int r;
+
+        writer = calloc(1, sizeof(*writer) + max_depth + 1);
+        if (!writer)
+                return -ENOMEM;
+
+        writer->fd = -1;
+        writer->batch = &writer->batches[0];
+        writer->n_states = max_depth;
+
+        if (flags & C_JSON_WRITER_ASYNC) {
+                pthread_mutex_init(&writer->lock, NULL);
+                pthread_cond_init(&writer->cond, NULL);
+
+                r = pthread_create(&writer->thread, NULL, c_json_writer_thread, writer);
+                if (r) {
+                        pthread_cond_destroy(&writer->cond);
+                        pthread_mutex_destroy(&writer->lock);
+                        return -r;
+                }
+
+                writer->async = true;
+        }
+
+        *writerp = writer;
+        writer = NULL;
+
+        return 0;
+}
+
+/**
+ * c_json_writer_free() - deinitialize and free a writer
+ * @writer:             writer to free
+ *
+ * Return: NULL
+ */
+_c_public_ CJsonWriter * c_json_writer_free(CJsonWriter *writer) {
+        if (!writer)
+                return NULL;
+
+        if (writer->async) {
+                pthread_mutex_lock(&writer->lock);
+                writer->stop = true;
+                pthread_cond_broadcast(&writer->cond);
+                pthread_mutex_unlock(&writer->lock);
+
+                pthread_join(writer->thread, NULL);
+                pthread_cond_destroy(&writer->cond);
+                pthread_mutex_destroy(&writer->lock);
+        }
+
+        free(writer);
+
+        return NULL;
+}
+
+/**
+ * c_json_writer_begin_write() - begin writing JSON to a file descriptor
+ * @writer              writer object
+ * @fd                  file descriptor to write to
+ *
+ * Output is buffered and written with writev(). Short writes are
+ * continued, so @fd should be blocking.
+ *
+ * It is an error to call this function multiple times without calling
+ * c_json_writer_end_write().
+ */
+_c_public_ void c_json_writer_begin_write(CJsonWriter *writer, int fd) {
+        assert(writer->fd < 0);
+
+        writer->fd = fd;
+}
+
+/**
+ * c_json_writer_end_write() - end writing
+ * @writer              writer object
+ *
+ * Writes out all buffered output and waits until it is written. Memory
+ * passed to c_json_writer_write_string_ref() is no longer referenced
+ * once this returns. If there was a previous error, it is returned. The
+ * previous error is reset, so that the object can be reused.
+ *
+ * Return: <0 on fatal error, including write errors
+ *         0 on success
+ *         the last error that occured in a writer function
+ *         C_JSON_E_INVALID_JSON if the document is incomplete
+ */
+_c_public_ int c_json_writer_end_write(CJsonWriter *writer) {
+        int r = writer->poison;
+
+        if (!r && (writer->level > 0 || writer->states[0] != '.'))
+                r = C_JSON_E_INVALID_JSON;
+
+        if (!r)
+                r = c_json_writer_flush(writer);
+
+        if (writer->async) {
+                int k = c_json_writer_wait(writer);
+
+                r = r ?: k;
+                writer->error = 0;
+        }
+
+        c_json_writer_batch_reset(&writer->batches[0]);
+        c_json_writer_batch_reset(&writer->batches[1]);
+        writer->batch = &writer->batches[0];
+        writer->level = 0;
+        writer->states[0] = 0;
+        writer->fd = -1;
+        writer->poison = 0;
+
+        return r;
+}
+
+/**
+ * c_json_writer_write_null() - write `null`
+ * @writer              writer object
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a writer function
+ *         C_JSON_E_INVALID_TYPE if an object key is expected
+ *         C_JSON_E_INVALID_JSON if the document is already complete
+ */
+_c_public_ int c_json_writer_write_null(CJsonWriter *writer) {
+        return c_json_writer_write_raw(writer, "null", strlen("null"));
+}
+
+/**
+ * c_json_writer_write_bool() - write `true` or `false`
+ * @writer              writer object
+ * @b                   value to write
+ *
+ * Return: see c_json_writer_write_null()
+ */
+_c_public_ int c_json_writer_write_bool(CJsonWriter *writer, bool b) {
+        if (b)
+                return c_json_writer_write_raw(writer, "true", strlen("true"));
+        else
+                return c_json_writer_write_raw(writer, "false", strlen("false"));
+}
+
+/**
+ * c_json_writer_write_number() - write a number
+ * @writer              writer object
+ * @number              number in JSON syntax
+ * @n_number            length of @number
+ *
+ * Return: see c_json_writer_write_null()
+ *         C_JSON_E_INVALID_JSON if @number is not a valid JSON number
+ */
+_c_public_ int c_json_writer_write_number(CJsonWriter *writer, const char *number, size_t n_number) {
+        size_t n_parsed;
+
+        if (_c_unlikely_(writer->poison))
+                return writer->poison;
+
+        if (!c_json_reader_parse_number(number, n_number, &n_parsed) || n_parsed != n_number)
+                return (writer->poison = C_JSON_E_INVALID_JSON);
+
+        return c_json_writer_write_raw(writer, number, n_number);
+}
+
+/**
+ * c_json_writer_write_int64() - write an integer
+ * @writer              writer object
+ * @value               value to write
+ *
+ * Return: see c_json_writer_write_null()
+ */
+_c_public_ int c_json_writer_write_int64(CJsonWriter *writer, int64_t value) {
+        char buffer[C_JSON_NUMBER_MAX];
+
+        return c_json_writer_write_raw(writer, buffer, c_json_format_int64(buffer, value));
+}
+
+/**
+ * c_json_writer_write_uint64() - write an unsigned integer
+ * @writer              writer object
+ * @value               value to write
+ *
+ * Return: see c_json_writer_write_null()
+ */
+_c_public_ int c_json_writer_write_uint64(CJsonWriter *writer, uint64_t value) {
+        char buffer[C_JSON_NUMBER_MAX];
+
+        return c_json_writer_write_raw(writer, buffer, c_json_format_uint64(buffer, value));
+}
+
+/**
+ * c_json_writer_write_double() - write a floating point number
+ * @writer              writer object
+ * @value               value to write
+ *
+ * Return: see c_json_writer_write_null()
+ *         C_JSON_E_INVALID_TYPE if @value is not finite
+ */
+_c_public_ int c_json_writer_write_double(CJsonWriter *writer, double value) {
+        char buffer[C_JSON_NUMBER_MAX];
+        size_t n;
+
+        if (_c_unlikely_(writer->poison))
+                return writer->poison;
+
+        n = c_json_format_double(buffer, value);
+        if (!n)
+                return (writer->poison = C_JSON_E_INVALID_TYPE);
+
+        return c_json_writer_write_raw(writer, buffer, n);
+}
+
+static int c_json_writer_write_string_internal(CJsonWriter *writer, const char *string, size_t n_string, bool ref) {
+        bool key = false;
+        int r;
+
+        if (_c_unlikely_(writer->poison))
+                return writer->poison;
+
+        r = c_json_writer_next(writer, &key);
+        if (r)
+                return (writer->poison = r);
+
+        if (key && writer->states[writer->level] == 'k') {
+                r = c_json_writer_append(writer, ",", 1);
+                if (r)
+                        return (writer->poison = r);
+        }
+
+        r = c_json_writer_string(writer, string, n_string, ref);
+        if (r)
+                return (writer->poison = r);
+
+        if (key) {
+                writer->states[writer->level] = ':';
+                r = c_json_writer_append(writer, ":", 1);
+                if (r)
+                        return (writer->poison = r);
+        }
+
+        return 0;
+}
+
+/**
+ * c_json_writer_write_string() - write a string or object key
+ * @writer              writer object
+ * @string              UTF-8 string to write
+ * @n_string            length of @string
+ *
+ * Escapes and copies @string, so it can be released right after this
+ * returns. Where an object key is expected, @string is written as key.
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a writer function
+ *         C_JSON_E_INVALID_JSON if @string is not valid UTF-8, or the
+ *                               document is already complete
+ */
+_c_public_ int c_json_writer_write_string(CJsonWriter *writer, const char *string, size_t n_string) {
+        return c_json_writer_write_string_internal(writer, string, n_string, false);
+}
+
+/**
+ * c_json_writer_write_string_ref() - write a string without copying it
+ * @writer              writer object
+ * @string              UTF-8 string to write
+ * @n_string            length of @string
+ *
+ * Writes @string like c_json_writer_write_string(), but long runs of
+ * bytes that need no escaping are not copied into the writer's buffer.
+ * They are passed to writev() in place instead. @string must stay valid
+ * and unmodified until c_json_writer_end_write() returns.
+ *
+ * Return: see c_json_writer_write_string()
+ */
+_c_public_ int c_json_writer_write_string_ref(CJsonWriter *writer, const char *string, size_t n_string) {
+        return c_json_writer_write_string_internal(writer, string, n_string, true);
+}
+
+static int c_json_writer_enter(CJsonWriter *writer, char state) {
+        int r;
+
+        if (_c_unlikely_(writer->poison))
+                return writer->poison;
+
+        r = c_json_writer_next(writer, NULL);
+        if (r)
+                return (writer->poison = r);
+
+        if (writer->level >= writer->n_states)
+                return (writer->poison = C_JSON_E_DEPTH_OVERFLOW);
+
+        r = c_json_writer_append(writer, &state, 1);
+        if (r)
+                return (writer->poison = r);
+
+        writer->states[++writer->level] = state;
+
+        return 0;
+}
+
+static int c_json_writer_exit(CJsonWriter *writer, char state, char close) {
+        char current = writer->states[writer->level];
+        int r;
+
+        if (_c_unlikely_(writer->poison))
+                return writer->poison;
+
+        if (!writer->level || current == ':')
+                return (writer->poison = C_JSON_E_INVALID_JSON);
+
+        if ((state == '[') != (current == '[' || current == ','))
+                return (writer->poison = C_JSON_E_INVALID_TYPE);
+
+        r = c_json_writer_append(writer, &close, 1);
+        if (r)
+                return (writer->poison = r);
+
+        writer->level -= 1;
+
+        return 0;
+}
+
+/**
+ * c_json_writer_enter_array() - begin writing an array
+ * @writer              writer object
+ *
+ * Return: see c_json_writer_write_null()
+ *         C_JSON_E_DEPTH_OVERFLOW if the maximum depth is exceeded
+ */
+_c_public_ int c_json_writer_enter_array(CJsonWriter *writer) {
+        return c_json_writer_enter(writer, '[');
+}
+
+/**
+ * c_json_writer_exit_array() - end writing an array
+ * @writer              writer object
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a writer function
+ *         C_JSON_E_INVALID_TYPE if not in an array
+ *         C_JSON_E_INVALID_JSON if not in a container
+ */
+_c_public_ int c_json_writer_exit_array(CJsonWriter *writer) {
+        return c_json_writer_exit(writer, '[', ']');
+}
+
+/**
+ * c_json_writer_enter_object() - begin writing an object
+ * @writer              writer object
+ *
+ * Keys and values are written alternately, keys with
+ * c_json_writer_write_string() or c_json_writer_write_string_ref().
+ *
+ * Return: see c_json_writer_enter_array()
+ */
+_c_public_ int c_json_writer_enter_object(CJsonWriter *writer) {
+        return c_json_writer_enter(writer, '{');
+}
+
+/**
+ * c_json_writer_exit_object() - end writing an object
+ * @writer              writer object
+ *
+ * Return: <0 on fatal error
+ *         0 on success
+ *         the last error that occured in a writer function
+ *         C_JSON_E_INVALID_TYPE if not in an object
+ *         C_JSON_E_INVALID_JSON if not in a container, or a key has no
+ *                               value
+ */
+_c_public_ int c_json_writer_exit_object(CJsonWriter *writer) {
+        return c_json_writer_exit(writer, '{', '}');
+}
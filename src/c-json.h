@@ -6,16 +6,58 @@ extern "C" {
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 
 typedef struct CJsonReader CJsonReader;
 typedef struct CJsonWriter CJsonWriter;
 typedef struct CJsonLevel CJsonLevel;
+typedef struct CJsonTransform CJsonTransform;
+typedef struct CJsonInternTable CJsonInternTable;
+typedef struct CJsonMessage CJsonMessage;
+typedef struct CJsonCursor CJsonCursor;
+typedef struct CJsonSchema CJsonSchema;
+typedef struct CJsonString CJsonString;
+typedef struct CJsonDocument CJsonDocument;
+typedef struct CJsonHandler CJsonHandler;
+typedef struct CJsonLocation CJsonLocation;
+typedef struct CJsonLimits CJsonLimits;
+typedef struct CJsonCheckpoint CJsonCheckpoint;
+
+/* maximum size of a chunk passed to a CJsonChunkFn */
+#define C_JSON_CHUNK_MAX 4096
+
+/* ID returned for strings that are not in an intern table */
+#define C_JSON_INTERN_NONE SIZE_MAX
+
+/* offset returned for members that are not in a document */
+#define C_JSON_DOCUMENT_NONE SIZE_MAX
+
+/* maximum number of bytes on either side of an error in a CJsonLocation */
+#define C_JSON_CONTEXT_MAX 32
+
+/* maximum nesting depth supported by c_json_validate() */
+#define C_JSON_VALIDATE_DEPTH_MAX (64 * 1024)
+
+/* size of the digest written by c_json_canonical_hash() */
+#define C_JSON_HASH_SIZE 32
+
+/* buffer size sufficient for any number written by c_json_format_*() */
+#define C_JSON_NUMBER_MAX 32
 
 enum  {
         _C_JSON_E_SUCCESS,
         C_JSON_E_INVALID_JSON,
         C_JSON_E_INVALID_TYPE,
         C_JSON_E_DEPTH_OVERFLOW,
+        C_JSON_E_SCHEMA_VIOLATION,
+        C_JSON_E_YIELD,
+        C_JSON_E_INPUT_TOO_LARGE,
+        C_JSON_E_STRING_TOO_LONG,
+        C_JSON_E_STRINGS_TOO_LARGE,
+        C_JSON_E_TOO_MANY_VALUES,
+        C_JSON_E_NUMBER_TOO_LONG,
+        C_JSON_E_TOO_MANY_MEMBERS,
 };
 
 enum {
@@ -27,15 +69,96 @@ enum {
         C_JSON_TYPE_OBJECT,
 };
 
+enum {
+        C_JSON_TRANSFORM_DROP,
+        C_JSON_TRANSFORM_REPLACE,
+        C_JSON_TRANSFORM_RENAME,
+};
+
+enum {
+        C_JSON_READER_TRUSTED = (1 << 0),
+};
+
+enum {
+        C_JSON_PARALLEL_UNORDERED = (1 << 0),
+};
+
+enum {
+        C_JSON_WRITER_ASYNC = (1 << 0),
+};
+
+struct CJsonMessage {
+        const char *data;
+        size_t n_data;
+};
+
+struct CJsonString {
+        const char *raw;
+        size_t n_raw;
+        bool escaped;
+};
+
+struct CJsonLimits {
+        size_t max_input;
+        size_t max_string;
+        size_t max_strings;
+        size_t max_values;
+        size_t max_number;
+        size_t max_members;
+};
+
+struct CJsonCheckpoint {
+        const char *p;
+        size_t level;
+        size_t n_strings_left;
+        size_t n_values_left;
+        char *states;
+        size_t *members;
+        size_t n_allocated;
+};
+
+struct CJsonLocation {
+        size_t line;
+        size_t column;
+        const char *context;
+        size_t n_context;
+        size_t context_offset;
+};
+
+struct CJsonHandler {
+        int (*begin_object)(void *userdata);
+        int (*end_object)(void *userdata);
+        int (*begin_array)(void *userdata);
+        int (*end_array)(void *userdata);
+        int (*key)(void *userdata, const CJsonString *key);
+        int (*string)(void *userdata, const CJsonString *string);
+        int (*number)(void *userdata, const char *number, size_t n_number);
+        int (*boolean)(void *userdata, bool b);
+        int (*null)(void *userdata);
+};
+
+typedef int (*CJsonChunkFn)(void *userdata, const char *chunk, size_t n_chunk);
+typedef int (*CJsonMessageFn)(void *userdata, CJsonReader *reader, size_t index);
+typedef int (*CJsonElementFn)(void *userdata, CJsonReader *reader, size_t index, void **resultp);
+typedef int (*CJsonResultFn)(void *userdata, size_t index, void *result);
+
 /* readers */
 int c_json_reader_new(CJsonReader **readerp, size_t max_depth);
 CJsonReader * c_json_reader_free(CJsonReader *reader);
+void c_json_reader_set_flags(CJsonReader *reader, unsigned int flags);
+void c_json_reader_set_limits(CJsonReader *reader, const CJsonLimits *limits);
 
 void c_json_reader_begin_read(CJsonReader *reader, const char *string);
+void c_json_reader_begin_read_mutable(CJsonReader *reader, char *string);
 int c_json_reader_end_read(CJsonReader *reader);
+size_t c_json_reader_error_offset(CJsonReader *reader);
 int c_json_reader_peek(CJsonReader *reader);
 int c_json_reader_read_null(CJsonReader *reader);
 int c_json_reader_read_string(CJsonReader *reader, char **stringp);
+int c_json_reader_read_string_in_place(CJsonReader *reader, char **stringp);
+int c_json_reader_read_string_chunked(CJsonReader *reader, CJsonChunkFn fn, void *userdata);
+int c_json_reader_read_base64(CJsonReader *reader, CJsonChunkFn fn, void *userdata);
+int c_json_reader_read_interned(CJsonReader *reader, CJsonInternTable *table, const char **stringp, size_t *idp);
 int c_json_reader_read_number(CJsonReader *reader, const char **numberp, size_t *n_numberp);
 int c_json_reader_read_bool(CJsonReader *reader, bool *boolp);
 bool c_json_reader_more(CJsonReader *reader);
@@ -43,12 +166,165 @@ int c_json_reader_enter_array(CJsonReader *reader);
 int c_json_reader_exit_array(CJsonReader *reader);
 int c_json_reader_enter_object(CJsonReader *reader);
 int c_json_reader_exit_object(CJsonReader *reader);
+int c_json_reader_skip(CJsonReader *reader);
+
+int c_json_reader_checkpoint(CJsonReader *reader, CJsonCheckpoint *checkpoint);
+void c_json_reader_restore(CJsonReader *reader, const CJsonCheckpoint *checkpoint);
+void c_json_checkpoint_deinit(CJsonCheckpoint *checkpoint);
 
 static inline void c_json_reader_freep(CJsonReader **readerp) {
         if (*readerp)
                 c_json_reader_free(*readerp);
 }
 
+static inline void c_json_checkpoint_deinitp(CJsonCheckpoint *checkpoint) {
+        c_json_checkpoint_deinit(checkpoint);
+}
+
+/* writers */
+int c_json_writer_new(CJsonWriter **writerp, size_t max_depth, unsigned int flags);
+CJsonWriter * c_json_writer_free(CJsonWriter *writer);
+
+void c_json_writer_begin_write(CJsonWriter *writer, int fd);
+int c_json_writer_end_write(CJsonWriter *writer);
+int c_json_writer_write_null(CJsonWriter *writer);
+int c_json_writer_write_bool(CJsonWriter *writer, bool b);
+int c_json_writer_write_number(CJsonWriter *writer, const char *number, size_t n_number);
+int c_json_writer_write_int64(CJsonWriter *writer, int64_t value);
+int c_json_writer_write_uint64(CJsonWriter *writer, uint64_t value);
+int c_json_writer_write_double(CJsonWriter *writer, double value);
+int c_json_writer_write_string(CJsonWriter *writer, const char *string, size_t n_string);
+int c_json_writer_write_string_ref(CJsonWriter *writer, const char *string, size_t n_string);
+int c_json_writer_enter_array(CJsonWriter *writer);
+int c_json_writer_exit_array(CJsonWriter *writer);
+int c_json_writer_enter_object(CJsonWriter *writer);
+int c_json_writer_exit_object(CJsonWriter *writer);
+
+static inline void c_json_writer_freep(CJsonWriter **writerp) {
+        if (*writerp)
+                c_json_writer_free(*writerp);
+}
+
+/* lazy strings */
+int c_json_reader_read_string_lazy(CJsonReader *reader, CJsonString *stringp);
+
+size_t c_json_string_length(const CJsonString *string);
+int c_json_string_compare(const CJsonString *string, const char *other);
+bool c_json_string_has_prefix(const CJsonString *string, const char *prefix);
+uint64_t c_json_string_hash(const CJsonString *string);
+int c_json_string_decode(const CJsonString *string, char *buffer, size_t n_buffer, size_t *n_stringp);
+int c_json_string_dup(const CJsonString *string, char **stringp);
+
+/* event parsing */
+void c_json_reader_set_budget(CJsonReader *reader, size_t n_budget);
+int c_json_reader_parse(CJsonReader *reader, const CJsonHandler *handler, void *userdata);
+
+/* documents */
+int c_json_document_new(CJsonDocument **documentp, const char *input, size_t max_depth);
+CJsonDocument * c_json_document_free(CJsonDocument *document);
+
+size_t c_json_document_root(CJsonDocument *document);
+int c_json_document_lookup(CJsonDocument *document, size_t object, const char *key, size_t *valuep);
+void c_json_document_begin_read(CJsonDocument *document, CJsonReader *reader, size_t value);
+int c_json_document_end_read(CJsonDocument *document, CJsonReader *reader);
+
+static inline void c_json_document_freep(CJsonDocument **documentp) {
+        if (*documentp)
+                c_json_document_free(*documentp);
+}
+
+/* validation */
+int c_json_validate(const char *input, size_t n_input, size_t max_depth, size_t *offsetp);
+void c_json_locate(const char *input, size_t n_input, size_t offset, CJsonLocation *locationp);
+
+/* batches */
+int c_json_reader_read_batch(CJsonReader *reader,
+                             const CJsonMessage *messages,
+                             size_t n_messages,
+                             CJsonMessageFn fn,
+                             void *userdata,
+                             int *results);
+
+/* parallel reading */
+int c_json_read_array_parallel(const char *input,
+                               size_t max_depth,
+                               size_t n_threads,
+                               unsigned int flags,
+                               CJsonElementFn element_fn,
+                               CJsonResultFn result_fn,
+                               void *userdata);
+
+/* binary caches */
+int c_json_cache_encode(CJsonReader *reader, char **datap, size_t *n_datap);
+
+int c_json_cursor_new(CJsonCursor **cursorp, size_t max_depth);
+CJsonCursor * c_json_cursor_free(CJsonCursor *cursor);
+
+void c_json_cursor_begin_read(CJsonCursor *cursor, const char *data, size_t n_data);
+int c_json_cursor_end_read(CJsonCursor *cursor);
+int c_json_cursor_peek(CJsonCursor *cursor);
+int c_json_cursor_read_null(CJsonCursor *cursor);
+int c_json_cursor_read_string(CJsonCursor *cursor, char **stringp);
+int c_json_cursor_read_string_ref(CJsonCursor *cursor, const char **stringp, size_t *n_stringp);
+int c_json_cursor_read_number(CJsonCursor *cursor, const char **numberp, size_t *n_numberp);
+int c_json_cursor_read_bool(CJsonCursor *cursor, bool *boolp);
+bool c_json_cursor_more(CJsonCursor *cursor);
+int c_json_cursor_enter_array(CJsonCursor *cursor);
+int c_json_cursor_exit_array(CJsonCursor *cursor);
+int c_json_cursor_enter_object(CJsonCursor *cursor);
+int c_json_cursor_exit_object(CJsonCursor *cursor);
+int c_json_cursor_skip(CJsonCursor *cursor);
+
+static inline void c_json_cursor_freep(CJsonCursor **cursorp) {
+        if (*cursorp)
+                c_json_cursor_free(*cursorp);
+}
+
+/* canonicalization */
+int c_json_canonicalize(CJsonReader *reader, CJsonChunkFn fn, void *userdata);
+int c_json_canonical_hash(CJsonReader *reader, uint8_t digest[C_JSON_HASH_SIZE]);
+
+/* schemas */
+int c_json_schema_new(CJsonSchema **schemap, const char *text);
+CJsonSchema * c_json_schema_free(CJsonSchema *schema);
+
+int c_json_schema_check(CJsonSchema *schema, CJsonReader *reader, char **pointerp);
+
+static inline void c_json_schema_freep(CJsonSchema **schemap) {
+        if (*schemap)
+                c_json_schema_free(*schemap);
+}
+
+/* intern tables */
+int c_json_intern_table_new(CJsonInternTable **tablep, size_t max_entries);
+CJsonInternTable * c_json_intern_table_free(CJsonInternTable *table);
+
+int c_json_intern_table_add(CJsonInternTable *table, const char *key, size_t *idp);
+const char * c_json_intern_table_get(CJsonInternTable *table, size_t id);
+void c_json_intern_table_freeze(CJsonInternTable *table);
+
+static inline void c_json_intern_table_freep(CJsonInternTable **tablep) {
+        if (*tablep)
+                c_json_intern_table_free(*tablep);
+}
+
+/* numbers */
+size_t c_json_format_int64(char *buffer, int64_t value);
+size_t c_json_format_uint64(char *buffer, uint64_t value);
+size_t c_json_format_double(char *buffer, double value);
+
+/* transforms */
+int c_json_transform_new(CJsonTransform **transformp);
+CJsonTransform * c_json_transform_free(CJsonTransform *transform);
+
+int c_json_transform_add(CJsonTransform *transform, const char *path, int action, const char *argument);
+int c_json_transform_run(CJsonTransform *transform, CJsonReader *reader, FILE *output);
+
+static inline void c_json_transform_freep(CJsonTransform **transformp) {
+        if (*transformp)
+                c_json_transform_free(*transformp);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,257 @@
+
+#undef NDEBUG
+#include <c-stdaux.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "c-json.h"
+#include "json-util.h"
+
+/*
+ * Cache files start with the size and modification time of the JSON file
+ * they were created from, followed by the output of c_json_cache_encode().
+ * A cache is only used if both still match the JSON file.
+ */
+typedef struct {
+        uint64_t size;
+        int64_t mtime_sec;
+        int64_t mtime_nsec;
+} CacheKey;
+
+static bool verbose;
+
+static int walk_value(CJsonCursor *cursor) {
+        switch (c_json_cursor_peek(cursor)) {
+                case C_JSON_TYPE_NULL:
+                        return c_json_cursor_read_null(cursor);
+
+                case C_JSON_TYPE_BOOLEAN:
+                        return c_json_cursor_read_bool(cursor, NULL);
+
+                case C_JSON_TYPE_STRING:
+                        return c_json_cursor_read_string_ref(cursor, NULL, NULL);
+
+                case C_JSON_TYPE_NUMBER:
+                        return c_json_cursor_read_number(cursor, NULL, NULL);
+
+                case C_JSON_TYPE_ARRAY:
+                        c_json_cursor_enter_array(cursor);
+                        while (c_json_cursor_more(cursor)) {
+                                int r = walk_value(cursor);
+                                if (r)
+                                        return r;
+                        }
+                        return c_json_cursor_exit_array(cursor);
+
+                case C_JSON_TYPE_OBJECT:
+                        c_json_cursor_enter_object(cursor);
+                        while (c_json_cursor_more(cursor)) {
+                                int r = walk_value(cursor);
+                                if (r)
+                                        return r;
+                        }
+                        return c_json_cursor_exit_object(cursor);
+
+                default:
+                        return C_JSON_E_INVALID_JSON;
+        }
+}
+
+static int walk_cache(const char *data, size_t n_data) {
+        _c_cleanup_ (c_json_cursor_freep) CJsonCursor *cursor = NULL;
+        int r;
+
+        r = c_json_cursor_new(&cursor, 256);
+        if (r)
+                return r;
+
+        c_json_cursor_begin_read(cursor, data, n_data);
+        r = walk_value(cursor);
+        if (r) {
+                c_json_cursor_end_read(cursor);
+                return r;
+        }
+
+        return c_json_cursor_end_read(cursor);
+}
+
+/* returns 0 if a valid cache was walked, >0 if the cache must be rebuilt */
+static int load_cache(const char *path, const CacheKey *key) {
+        _c_cleanup_ (c_closep) int fd = -1;
+        CacheKey cached;
+        struct stat st;
+        void *map;
+        int r;
+
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+                return errno == ENOENT ? 1 : -errno;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        if ((size_t)st.st_size < sizeof(cached))
+                return 1;
+
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+                return -errno;
+
+        memcpy(&cached, map, sizeof(cached));
+        if (memcmp(&cached, key, sizeof(cached))) {
+                r = 1;
+        } else {
+                r = walk_cache((const char *)map + sizeof(cached), st.st_size - sizeof(cached));
+                /* a damaged cache is rebuilt, the JSON file is authoritative */
+                if (r > 0)
+                        r = 1;
+        }
+
+        munmap(map, st.st_size);
+        return r;
+}
+
+static int write_cache(const char *path, const CacheKey *key, const char *data, size_t n_data) {
+        _c_cleanup_ (c_fclosep) FILE *file = NULL;
+        _c_cleanup_ (c_freep) char *tmp = NULL;
+        int fd, r;
+
+        if (asprintf(&tmp, "%s.XXXXXX", path) < 0)
+                return -ENOMEM;
+
+        fd = mkostemp(tmp, O_CLOEXEC);
+        if (fd < 0)
+                return -errno;
+
+        file = fdopen(fd, "w");
+        if (!file) {
+                r = -errno;
+                close(fd);
+                unlink(tmp);
+                return r;
+        }
+
+        if (fwrite(key, sizeof(*key), 1, file) != 1 ||
+            fwrite(data, 1, n_data, file) != n_data ||
+            fflush(file) ||
+            rename(tmp, path) < 0) {
+                r = -errno;
+                unlink(tmp);
+                return r;
+        }
+
+        return 0;
+}
+
+static int build_cache(const char *path, const char *cache_path, const CacheKey *key) {
+        _c_cleanup_ (c_fclosep) FILE *file = NULL;
+        _c_cleanup_ (c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_ (c_freep) char *input = NULL;
+        _c_cleanup_ (c_freep) char *data = NULL;
+        size_t n_input, n_data;
+        int r;
+
+        file = fopen(path, "r");
+        if (!file)
+                return -errno;
+
+        r = read_file(file, &input, &n_input);
+        if (r)
+                return r;
+
+        r = c_json_reader_new(&reader, 256);
+        if (r)
+                return r;
+
+        c_json_reader_begin_read(reader, input);
+        r = c_json_cache_encode(reader, &data, &n_data);
+        if (r) {
+                c_json_reader_end_read(reader);
+                return r;
+        }
+
+        r = c_json_reader_end_read(reader);
+        if (r)
+                return r;
+
+        return write_cache(cache_path, key, data, n_data);
+}
+
+static void usage(const char *name) {
+        fprintf(stderr,
+                "Usage: %s [OPTIONS] FILE\n"
+                "\n"
+                "Validate a JSON document through a binary cache. If the cache is\n"
+                "up to date with FILE, it is mapped and read instead of FILE.\n"
+                "Otherwise, FILE is parsed and the cache is rebuilt.\n"
+                "\n"
+                "  -c, --cache PATH            Cache file to use (default: FILE.cache)\n"
+                "  -v, --verbose               Report whether the cache was used\n",
+                name);
+}
+
+int main(int argc, char **argv) {
+        static const struct option options[] = {
+                { "cache",      required_argument,      NULL,   'c' },
+                { "verbose",    no_argument,            NULL,   'v' },
+                { "help",       no_argument,            NULL,   'h' },
+                {}
+        };
+        _c_cleanup_ (c_freep) char *cache_path = NULL;
+        CacheKey key = {};
+        struct stat st;
+        int c, r;
+
+        while ((c = getopt_long(argc, argv, "c:vh", options, NULL)) >= 0) {
+                switch (c) {
+                case 'c':
+                        free(cache_path);
+                        cache_path = strdup(optarg);
+                        if (!cache_path)
+                                return 1;
+                        break;
+                case 'v':
+                        verbose = true;
+                        break;
+                case 'h':
+                        usage(argv[0]);
+                        return 0;
+                default:
+                        usage(argv[0]);
+                        return 1;
+                }
+        }
+
+        if (optind + 1 != argc) {
+                usage(argv[0]);
+                return 1;
+        }
+
+        if (!cache_path && asprintf(&cache_path, "%s.cache", argv[optind]) < 0)
+                return 1;
+
+        if (stat(argv[optind], &st) < 0)
+                return 1;
+
+        key.size = st.st_size;
+        key.mtime_sec = st.st_mtim.tv_sec;
+        key.mtime_nsec = st.st_mtim.tv_nsec;
+
+        r = load_cache(cache_path, &key);
+        if (r == 0) {
+                if (verbose)
+                        fprintf(stderr, "%s: cache hit\n", cache_path);
+                return 0;
+        } else if (r < 0) {
+                return 1;
+        }
+
+        if (verbose)
+                fprintf(stderr, "%s: cache miss\n", cache_path);
+
+        r = build_cache(argv[optind], cache_path, &key);
+        return r < 0 ? 1 : r;
+}
@@ -0,0 +1,336 @@
+
+#undef NDEBUG
+#include <c-stdaux.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "c-json.h"
+#include "json-util.h"
+
+#define FMT_MAX_DEPTH 256
+#define FMT_MAX_INDENT 16
+
+/*
+ * The output is collected in a fixed buffer and written out whenever it
+ * is full, so memory use does not depend on the size of the input.
+ * Indentation is copied from a prepared newline followed by enough spaces
+ * for the deepest level.
+ */
+typedef struct Fmt {
+        char buffer[65536];
+        size_t n_buffer;
+        char *indent;
+        size_t n_indent;
+        size_t level;
+        bool first;
+        bool key;
+} Fmt;
+
+static int fmt_flush(Fmt *fmt) {
+        if (fmt->n_buffer && fwrite(fmt->buffer, 1, fmt->n_buffer, stdout) != fmt->n_buffer)
+                return -errno;
+
+        fmt->n_buffer = 0;
+        return 0;
+}
+
+static int fmt_write(Fmt *fmt, const char *data, size_t n_data) {
+        int r;
+
+        if (_c_likely_(n_data <= sizeof(fmt->buffer) - fmt->n_buffer)) {
+                memcpy(fmt->buffer + fmt->n_buffer, data, n_data);
+                fmt->n_buffer += n_data;
+                return 0;
+        }
+
+        r = fmt_flush(fmt);
+        if (r)
+                return r;
+
+        /* tokens larger than the buffer are written directly */
+        if (n_data >= sizeof(fmt->buffer))
+                return fwrite(data, 1, n_data, stdout) == n_data ? 0 : -errno;
+
+        memcpy(fmt->buffer, data, n_data);
+        fmt->n_buffer = n_data;
+        return 0;
+}
+
+/* starts a new value, with a comma and a line break inside of containers */
+static int fmt_separator(Fmt *fmt) {
+        int r;
+
+        if (fmt->key) {
+                fmt->key = false;
+                return 0;
+        }
+
+        if (!fmt->level)
+                return 0;
+
+        if (!fmt->first) {
+                r = fmt_write(fmt, ",", 1);
+                if (r)
+                        return r;
+        }
+
+        fmt->first = false;
+
+        if (!fmt->n_indent)
+                return 0;
+
+        return fmt_write(fmt, fmt->indent, 1 + fmt->level * fmt->n_indent);
+}
+
+static int fmt_begin(Fmt *fmt, char c) {
+        int r;
+
+        r = fmt_separator(fmt);
+        if (r)
+                return r;
+
+        fmt->level += 1;
+        fmt->first = true;
+
+        return fmt_write(fmt, &c, 1);
+}
+
+static int fmt_end(Fmt *fmt, char c) {
+        int r;
+
+        fmt->level -= 1;
+
+        if (!fmt->first && fmt->n_indent) {
+                r = fmt_write(fmt, fmt->indent, 1 + fmt->level * fmt->n_indent);
+                if (r)
+                        return r;
+        }
+
+        fmt->first = false;
+
+        return fmt_write(fmt, &c, 1);
+}
+
+static int fmt_begin_object(void *userdata) {
+        return fmt_begin(userdata, '{');
+}
+
+static int fmt_end_object(void *userdata) {
+        return fmt_end(userdata, '}');
+}
+
+static int fmt_begin_array(void *userdata) {
+        return fmt_begin(userdata, '[');
+}
+
+static int fmt_end_array(void *userdata) {
+        return fmt_end(userdata, ']');
+}
+
+static int fmt_key(void *userdata, const CJsonString *key) {
+        Fmt *fmt = userdata;
+        int r;
+
+        r = fmt_separator(fmt);
+        if (r)
+                return r;
+
+        /* the quotes are copied along with the raw string */
+        r = fmt_write(fmt, key->raw - 1, key->n_raw + 2);
+        if (r)
+                return r;
+
+        fmt->key = true;
+
+        return fmt->n_indent ? fmt_write(fmt, ": ", 2) : fmt_write(fmt, ":", 1);
+}
+
+static int fmt_string(void *userdata, const CJsonString *string) {
+        Fmt *fmt = userdata;
+        int r;
+
+        r = fmt_separator(fmt);
+        if (r)
+                return r;
+
+        return fmt_write(fmt, string->raw - 1, string->n_raw + 2);
+}
+
+static int fmt_number(void *userdata, const char *number, size_t n_number) {
+        Fmt *fmt = userdata;
+        int r;
+
+        r = fmt_separator(fmt);
+        if (r)
+                return r;
+
+        return fmt_write(fmt, number, n_number);
+}
+
+static int fmt_boolean(void *userdata, bool b) {
+        Fmt *fmt = userdata;
+        int r;
+
+        r = fmt_separator(fmt);
+        if (r)
+                return r;
+
+        return b ? fmt_write(fmt, "true", 4) : fmt_write(fmt, "false", 5);
+}
+
+static int fmt_null(void *userdata) {
+        Fmt *fmt = userdata;
+        int r;
+
+        r = fmt_separator(fmt);
+        if (r)
+                return r;
+
+        return fmt_write(fmt, "null", 4);
+}
+
+static const CJsonHandler fmt_handler = {
+        .begin_object = fmt_begin_object,
+        .end_object = fmt_end_object,
+        .begin_array = fmt_begin_array,
+        .end_array = fmt_end_array,
+        .key = fmt_key,
+        .string = fmt_string,
+        .number = fmt_number,
+        .boolean = fmt_boolean,
+        .null = fmt_null,
+};
+
+static const char * error_string(int r) {
+        switch (r) {
+        case C_JSON_E_INVALID_JSON:
+                return "invalid JSON";
+        case C_JSON_E_DEPTH_OVERFLOW:
+                return "nesting too deep";
+        default:
+                return r < 0 ? strerror(-r) : "unknown error";
+        }
+}
+
+static void usage(const char *name) {
+        fprintf(stderr,
+                "Usage: %s [OPTIONS] [FILE]\n"
+                "\n"
+                "Copy a JSON document to stdout, either minified or pretty-printed.\n"
+                "Strings and numbers are copied verbatim.\n"
+                "\n"
+                "  -m, --minify                Remove all whitespace\n"
+                "  -i, --indent N              Indent by N spaces per level (default: 2)\n"
+                "  -t, --trusted               Skip the checks for trusted input\n",
+                name);
+}
+
+int main(int argc, char **argv) {
+        static const struct option options[] = {
+                { "minify",     no_argument,            NULL,   'm' },
+                { "indent",     required_argument,      NULL,   'i' },
+                { "trusted",    no_argument,            NULL,   't' },
+                { "help",       no_argument,            NULL,   'h' },
+                {}
+        };
+        _c_cleanup_ (c_fclosep) FILE *file = NULL;
+        _c_cleanup_ (c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_ (c_freep) char *contents = NULL;
+        _c_cleanup_ (c_freep) Fmt *fmt = NULL;
+        const char *name = "<stdin>", *input = NULL;
+        size_t n_input, n_map = 0, n_indent = 2;
+        unsigned int flags = 0;
+        CJsonLocation location;
+        char *end;
+        int c, r;
+
+        while ((c = getopt_long(argc, argv, "mi:th", options, NULL)) >= 0) {
+                switch (c) {
+                case 'm':
+                        n_indent = 0;
+                        break;
+                case 'i':
+                        n_indent = strtoul(optarg, &end, 10);
+                        if (*end || !*optarg || n_indent > FMT_MAX_INDENT) {
+                                fprintf(stderr, "Invalid indentation: %s\n", optarg);
+                                return 1;
+                        }
+                        break;
+                case 't':
+                        flags |= C_JSON_READER_TRUSTED;
+                        break;
+                case 'h':
+                        usage(argv[0]);
+                        return 0;
+                default:
+                        usage(argv[0]);
+                        return 1;
+                }
+        }
+
+        if (optind < argc) {
+                name = argv[optind];
+                file = fopen(name, "r");
+                if (!file) {
+                        fprintf(stderr, "%s: %s\n", name, strerror(errno));
+                        return 1;
+                }
+        }
+
+        r = map_file(fileno(file ?: stdin), &input, &n_input, &n_map);
+        if (r > 0) {
+                r = read_file(file ?: stdin, &contents, &n_input);
+                input = contents;
+        }
+        if (r) {
+                fprintf(stderr, "%s: %s\n", name, strerror(-r));
+                return 1;
+        }
+
+        fmt = calloc(1, sizeof(*fmt));
+        if (!fmt)
+                return 1;
+
+        /* every level fits into the indentation, the reader limits the depth */
+        fmt->n_indent = n_indent;
+        fmt->indent = malloc(1 + FMT_MAX_DEPTH * n_indent);
+        if (!fmt->indent)
+                return 1;
+        fmt->indent[0] = '\n';
+        memset(fmt->indent + 1, ' ', FMT_MAX_DEPTH * n_indent);
+
+        r = c_json_reader_new(&reader, FMT_MAX_DEPTH);
+        if (r)
+                return 1;
+
+        c_json_reader_set_flags(reader, flags);
+        c_json_reader_begin_read(reader, input);
+        r = c_json_reader_parse(reader, &fmt_handler, fmt);
+
+        /* trailing garbage is only noticed when ending the read */
+        if (r)
+                c_json_reader_end_read(reader);
+        else
+                r = c_json_reader_end_read(reader);
+
+        if (!r)
+                r = fmt_write(fmt, "\n", 1);
+        if (!r)
+                r = fmt_flush(fmt);
+        if (!r && fflush(stdout))
+                r = -errno;
+
+        if (r > 0) {
+                c_json_locate(input, n_input, c_json_reader_error_offset(reader), &location);
+                fprintf(stderr, "%s:%zu:%zu: %s\n", name, location.line, location.column, error_string(r));
+        } else if (r < 0) {
+                fprintf(stderr, "%s: %s\n", name, strerror(-r));
+        }
+
+        free(fmt->indent);
+        if (n_map)
+                munmap((void *)input, n_map);
+
+        return r ? 1 : 0;
+}
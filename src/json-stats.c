@@ -0,0 +1,865 @@
+
+#undef NDEBUG
+#include <c-stdaux.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "c-json.h"
+#include "json-util.h"
+
+#define STATS_MAX_DEPTH 256
+#define STATS_N_BUCKETS 65
+
+/* inputs smaller than this are not worth splitting across threads */
+#define STATS_MIN_PARALLEL (1024 * 1024)
+
+/*
+ * Keys are counted by their decoded contents, so differently escaped
+ * spellings of a key count as one. Only new keys are decoded and copied,
+ * keys that were seen before are matched against the input in place.
+ */
+typedef struct StatsKey {
+        char *key;
+        size_t n_key;
+        uint64_t hash;
+        uint64_t count;
+} StatsKey;
+
+typedef struct StatsKeys {
+        StatsKey *entries;
+        size_t n_entries;
+        size_t n_allocated;
+        size_t max_entries;
+        uint64_t n_untracked;
+} StatsKeys;
+
+/*
+ * Lengths and sizes are collected in power-of-two histograms: bucket 0
+ * counts 0, bucket i counts [2^(i-1), 2^i). Lengths are measured in
+ * bytes of input, which is also what the reader limits count.
+ */
+typedef struct Stats {
+        uint64_t n_documents;
+        uint64_t n_values[C_JSON_TYPE_OBJECT + 1];
+        uint64_t depths[STATS_MAX_DEPTH + 1];
+
+        uint64_t n_strings_escaped;
+        uint64_t n_string_bytes;
+        uint64_t max_string;
+        uint64_t strings[STATS_N_BUCKETS];
+
+        uint64_t n_keys;
+        uint64_t n_keys_escaped;
+        uint64_t max_key;
+        uint64_t key_lengths[STATS_N_BUCKETS];
+        StatsKeys keys;
+
+        uint64_t n_negative;
+        uint64_t n_integer;
+        uint64_t n_fraction;
+        uint64_t n_exponent;
+        uint64_t max_number;
+
+        uint64_t max_array;
+        uint64_t max_object;
+        uint64_t arrays[STATS_N_BUCKETS];
+        uint64_t objects[STATS_N_BUCKETS];
+
+        /* the depth of the next value, and the sizes of the open containers */
+        size_t level;
+        uint64_t members[STATS_MAX_DEPTH + 1];
+} Stats;
+
+typedef struct StatsWorker {
+        pthread_t thread;
+        const char *input;
+        const char *start;
+        const char *end;
+        unsigned int flags;
+        size_t error_offset;
+        int r;
+        Stats stats;
+} StatsWorker;
+
+/* workers of c_json_read_array_parallel() find their statistics here */
+typedef struct StatsArray {
+        pthread_mutex_t lock;
+        Stats **stats;
+        size_t n_stats;
+        size_t max_keys;
+} StatsArray;
+
+static _Thread_local Stats *thread_stats;
+
+static size_t stats_bucket(uint64_t n) {
+        return n ? 64 - __builtin_clzll(n) : 0;
+}
+
+static void stats_keys_deinit(StatsKeys *keys) {
+        for (size_t i = 0; i < keys->n_allocated; i += 1)
+                free(keys->entries[i].key);
+        free(keys->entries);
+        *keys = (StatsKeys){};
+}
+
+static int stats_keys_grow(StatsKeys *keys) {
+        size_t n_allocated = keys->n_allocated ? keys->n_allocated * 2 : 64;
+        StatsKey *entries;
+
+        entries = calloc(n_allocated, sizeof(*entries));
+        if (!entries)
+                return -ENOMEM;
+
+        for (size_t i = 0; i < keys->n_allocated; i += 1) {
+                StatsKey *entry = &keys->entries[i];
+                size_t j;
+
+                if (!entry->key)
+                        continue;
+
+                for (j = entry->hash & (n_allocated - 1); entries[j].key; j = (j + 1) & (n_allocated - 1))
+                        ;
+                entries[j] = *entry;
+        }
+
+        free(keys->entries);
+        keys->entries = entries;
+        keys->n_allocated = n_allocated;
+
+        return 0;
+}
+
+static bool stats_key_equal(const StatsKey *entry, const CJsonString *key) {
+        if (!key->escaped)
+                return entry->n_key == key->n_raw && !memcmp(entry->key, key->raw, key->n_raw);
+
+        /* keys with embedded 0-bytes never match and are counted apart */
+        return !c_json_string_compare(key, entry->key);
+}
+
+/*
+ * Returns the entry of @key, or the empty slot it would be inserted at.
+ * Either @key is set, or the decoded @decoded of length @n_decoded.
+ */
+static StatsKey * stats_keys_find(StatsKeys *keys, uint64_t hash, const CJsonString *key,
+                                 const char *decoded, size_t n_decoded) {
+        size_t mask = keys->n_allocated - 1;
+        StatsKey *entry;
+
+        for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+                entry = &keys->entries[i];
+                if (!entry->key)
+                        return entry;
+
+                if (entry->hash != hash)
+                        continue;
+
+                if (key ? stats_key_equal(entry, key)
+                        : entry->n_key == n_decoded && !memcmp(entry->key, decoded, n_decoded))
+                        return entry;
+        }
+}
+
+/*
+ * Inserts a new key into the empty slot @entry, unless the table is full.
+ * Returns 1 if the key was not tracked.
+ */
+static int stats_keys_insert(StatsKeys *keys, StatsKey *entry, char *key, size_t n_key, uint64_t hash, uint64_t count) {
+        if (keys->n_entries >= keys->max_entries) {
+                keys->n_untracked += count;
+                free(key);
+                return 1;
+        }
+
+        *entry = (StatsKey){ .key = key, .n_key = n_key, .hash = hash, .count = count };
+        keys->n_entries += 1;
+
+        return 0;
+}
+
+static int stats_keys_add(StatsKeys *keys, const CJsonString *key) {
+        StatsKey *entry;
+        uint64_t hash;
+        char *copy;
+        int r;
+
+        if (keys->n_entries * 2 >= keys->n_allocated) {
+                r = stats_keys_grow(keys);
+                if (r)
+                        return r;
+        }
+
+        hash = c_json_string_hash(key);
+        entry = stats_keys_find(keys, hash, key, NULL, 0);
+        if (entry->key) {
+                entry->count += 1;
+                return 0;
+        }
+
+        /* once the table is full, new keys are only counted */
+        if (keys->n_entries >= keys->max_entries) {
+                keys->n_untracked += 1;
+                return 0;
+        }
+
+        r = c_json_string_dup(key, &copy);
+        if (r)
+                return r;
+
+        stats_keys_insert(keys, entry, copy, c_json_string_length(key), hash, 1);
+        return 0;
+}
+
+static int stats_keys_merge(StatsKeys *keys, StatsKeys *from) {
+        StatsKey *entry;
+        int r;
+
+        for (size_t i = 0; i < from->n_allocated; i += 1) {
+                StatsKey *other = &from->entries[i];
+
+                if (!other->key)
+                        continue;
+
+                if (keys->n_entries * 2 >= keys->n_allocated) {
+                        r = stats_keys_grow(keys);
+                        if (r)
+                                return r;
+                }
+
+                entry = stats_keys_find(keys, other->hash, NULL, other->key, other->n_key);
+                if (entry->key) {
+                        entry->count += other->count;
+                } else {
+                        stats_keys_insert(keys, entry, other->key, other->n_key, other->hash, other->count);
+                        other->key = NULL;
+                }
+        }
+
+        keys->n_untracked += from->n_untracked;
+        return 0;
+}
+
+static void stats_value(Stats *stats, int type) {
+        stats->n_values[type] += 1;
+        stats->depths[stats->level] += 1;
+        stats->members[stats->level] += 1;
+}
+
+static int stats_begin(Stats *stats, int type) {
+        stats_value(stats, type);
+        stats->level += 1;
+        stats->members[stats->level] = 0;
+        return 0;
+}
+
+static int stats_begin_object(void *userdata) {
+        return stats_begin(userdata, C_JSON_TYPE_OBJECT);
+}
+
+static int stats_end_object(void *userdata) {
+        Stats *stats = userdata;
+        uint64_t n = stats->members[stats->level--];
+
+        stats->objects[stats_bucket(n)] += 1;
+        stats->max_object = c_max(stats->max_object, n);
+        return 0;
+}
+
+static int stats_begin_array(void *userdata) {
+        return stats_begin(userdata, C_JSON_TYPE_ARRAY);
+}
+
+static int stats_end_array(void *userdata) {
+        Stats *stats = userdata;
+        uint64_t n = stats->members[stats->level--];
+
+        stats->arrays[stats_bucket(n)] += 1;
+        stats->max_array = c_max(stats->max_array, n);
+        return 0;
+}
+
+static int stats_key(void *userdata, const CJsonString *key) {
+        Stats *stats = userdata;
+
+        stats->n_keys += 1;
+        stats->n_keys_escaped += key->escaped;
+        stats->key_lengths[stats_bucket(key->n_raw)] += 1;
+        stats->max_key = c_max(stats->max_key, (uint64_t)key->n_raw);
+
+        return stats_keys_add(&stats->keys, key);
+}
+
+static int stats_string(void *userdata, const CJsonString *string) {
+        Stats *stats = userdata;
+
+        stats_value(stats, C_JSON_TYPE_STRING);
+        stats->n_strings_escaped += string->escaped;
+        stats->n_string_bytes += string->n_raw;
+        stats->strings[stats_bucket(string->n_raw)] += 1;
+        stats->max_string = c_max(stats->max_string, (uint64_t)string->n_raw);
+        return 0;
+}
+
+static int stats_number(void *userdata, const char *number, size_t n_number) {
+        Stats *stats = userdata;
+        bool fraction = false, exponent = false;
+
+        stats_value(stats, C_JSON_TYPE_NUMBER);
+
+        for (size_t i = 0; i < n_number; i += 1) {
+                if (number[i] == '.')
+                        fraction = true;
+                else if (number[i] == 'e' || number[i] == 'E')
+                        exponent = true;
+        }
+
+        stats->n_negative += number[0] == '-';
+        stats->n_fraction += fraction;
+        stats->n_exponent += exponent;
+        stats->n_integer += !fraction && !exponent;
+        stats->max_number = c_max(stats->max_number, (uint64_t)n_number);
+        return 0;
+}
+
+static int stats_boolean(void *userdata, bool b) {
+        stats_value(userdata, C_JSON_TYPE_BOOLEAN);
+        return 0;
+}
+
+static int stats_null(void *userdata) {
+        stats_value(userdata, C_JSON_TYPE_NULL);
+        return 0;
+}
+
+static const CJsonHandler stats_handler = {
+        .begin_object = stats_begin_object,
+        .end_object = stats_end_object,
+        .begin_array = stats_begin_array,
+        .end_array = stats_end_array,
+        .key = stats_key,
+        .string = stats_string,
+        .number = stats_number,
+        .boolean = stats_boolean,
+        .null = stats_null,
+};
+
+static void stats_add(uint64_t *counts, const uint64_t *from, size_t n) {
+        for (size_t i = 0; i < n; i += 1)
+                counts[i] += from[i];
+}
+
+static int stats_merge(Stats *stats, Stats *from) {
+        stats->n_documents += from->n_documents;
+        stats_add(stats->n_values, from->n_values, C_ARRAY_SIZE(stats->n_values));
+        stats_add(stats->depths, from->depths, C_ARRAY_SIZE(stats->depths));
+
+        stats->n_strings_escaped += from->n_strings_escaped;
+        stats->n_string_bytes += from->n_string_bytes;
+        stats->max_string = c_max(stats->max_string, from->max_string);
+        stats_add(stats->strings, from->strings, STATS_N_BUCKETS);
+
+        stats->n_keys += from->n_keys;
+        stats->n_keys_escaped += from->n_keys_escaped;
+        stats->max_key = c_max(stats->max_key, from->max_key);
+        stats_add(stats->key_lengths, from->key_lengths, STATS_N_BUCKETS);
+
+        stats->n_negative += from->n_negative;
+        stats->n_integer += from->n_integer;
+        stats->n_fraction += from->n_fraction;
+        stats->n_exponent += from->n_exponent;
+        stats->max_number = c_max(stats->max_number, from->max_number);
+
+        stats->max_array = c_max(stats->max_array, from->max_array);
+        stats->max_object = c_max(stats->max_object, from->max_object);
+        stats_add(stats->arrays, from->arrays, STATS_N_BUCKETS);
+        stats_add(stats->objects, from->objects, STATS_N_BUCKETS);
+
+        return stats_keys_merge(&stats->keys, &from->keys);
+}
+
+/*
+ * Reads the lines from @start to @end as separate documents. The reader
+ * needs each one 0-terminated, so they are copied one at a time into a
+ * buffer that is reused.
+ */
+static void *stats_lines_thread(void *userdata) {
+        _c_cleanup_ (c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_ (c_freep) char *line = NULL;
+        StatsWorker *worker = userdata;
+        const char *p, *next;
+        size_t n, n_line = 0;
+        char *buffer;
+        int r;
+
+        r = c_json_reader_new(&reader, STATS_MAX_DEPTH);
+        if (r) {
+                worker->r = r;
+                return NULL;
+        }
+
+        c_json_reader_set_flags(reader, worker->flags);
+
+        for (p = worker->start; p < worker->end; p = next) {
+                next = memchr(p, '\n', worker->end - p) ?: worker->end;
+                n = next - p;
+                next += next < worker->end;
+
+                if (n >= n_line) {
+                        n_line = c_max(n + 1, n_line * 2);
+                        buffer = realloc(line, n_line);
+                        if (!buffer) {
+                                worker->r = -ENOMEM;
+                                return NULL;
+                        }
+                        line = buffer;
+                }
+
+                memcpy(line, p, n);
+                line[n] = 0;
+
+                /* blank lines separate nothing */
+                if (!*skip_space(line))
+                        continue;
+
+                c_json_reader_begin_read(reader, line);
+                worker->stats.level = 0;
+                r = c_json_reader_parse(reader, &stats_handler, &worker->stats);
+                if (r)
+                        c_json_reader_end_read(reader);
+                else
+                        r = c_json_reader_end_read(reader);
+                if (r) {
+                        worker->r = r;
+                        worker->error_offset = p - worker->input + c_json_reader_error_offset(reader);
+                        return NULL;
+                }
+
+                worker->stats.n_documents += 1;
+        }
+
+        return NULL;
+}
+
+static int stats_element(void *userdata, CJsonReader *reader, size_t index, void **resultp) {
+        StatsArray *array = userdata;
+        Stats **list;
+
+        if (!thread_stats) {
+                thread_stats = calloc(1, sizeof(*thread_stats));
+                if (!thread_stats)
+                        return -ENOMEM;
+                thread_stats->keys.max_entries = array->max_keys;
+
+                pthread_mutex_lock(&array->lock);
+                list = realloc(array->stats, (array->n_stats + 1) * sizeof(*list));
+                if (list) {
+                        array->stats = list;
+                        array->stats[array->n_stats++] = thread_stats;
+                }
+                pthread_mutex_unlock(&array->lock);
+
+                if (!list) {
+                        thread_stats = c_free(thread_stats);
+                        return -ENOMEM;
+                }
+        }
+
+        /* the elements are nested in the array the caller accounts for */
+        thread_stats->level = 1;
+        return c_json_reader_parse(reader, &stats_handler, thread_stats);
+}
+
+/*
+ * Splits @input into one range of whole lines per worker, and merges the
+ * statistics of all of them into @stats.
+ */
+static int stats_lines(Stats *stats, const char *input, size_t n_input, size_t n_threads,
+                       unsigned int flags, size_t *error_offsetp) {
+        _c_cleanup_ (c_freep) StatsWorker *workers = NULL;
+        const char *p = input, *end = input + n_input;
+        size_t n_started = 0;
+        int r = 0;
+
+        workers = calloc(n_threads, sizeof(*workers));
+        if (!workers)
+                return -ENOMEM;
+
+        for (size_t i = 0; i < n_threads; i += 1) {
+                StatsWorker *worker = &workers[i];
+                const char *split = input + n_input / n_threads * (i + 1);
+
+                if (i + 1 == n_threads || split >= end)
+                        split = end;
+                else if (split > p)
+                        split = (memchr(split, '\n', end - split) ?: (void *)end);
+                else
+                        split = p;
+
+                *worker = (StatsWorker){
+                        .input = input,
+                        .start = p,
+                        .end = split,
+                        .flags = flags,
+                        .stats.keys.max_entries = stats->keys.max_entries,
+                };
+                p = split;
+        }
+
+        /* the last range runs on the calling thread */
+        for (; n_started + 1 < n_threads; n_started += 1) {
+                r = -pthread_create(&workers[n_started].thread, NULL, stats_lines_thread, &workers[n_started]);
+                if (r)
+                        break;
+        }
+
+        if (!r)
+                stats_lines_thread(&workers[n_threads - 1]);
+
+        for (size_t i = 0; i < n_started; i += 1)
+                pthread_join(workers[i].thread, NULL);
+
+        /* report the first error in the input */
+        for (size_t i = 0; !r && i < n_threads; i += 1) {
+                r = workers[i].r;
+                *error_offsetp = workers[i].error_offset;
+        }
+
+        for (size_t i = 0; i < n_threads; i += 1) {
+                if (!r)
+                        r = stats_merge(stats, &workers[i].stats);
+                stats_keys_deinit(&workers[i].stats.keys);
+        }
+
+        return r;
+}
+
+/*
+ * Reads a single document. If it is a large array, its elements are read
+ * on @n_threads workers.
+ */
+static int stats_document(Stats *stats, const char *input, size_t n_input, size_t n_threads,
+                          unsigned int flags, size_t *error_offsetp) {
+        _c_cleanup_ (c_json_reader_freep) CJsonReader *reader = NULL;
+        StatsArray array = { .max_keys = stats->keys.max_entries };
+        uint64_t n_elements;
+        int r, k;
+
+        /* the workers check their input fully, even if it is trusted */
+        if (n_threads > 1 && *skip_space(input) == '[') {
+                pthread_mutex_init(&array.lock, NULL);
+                r = c_json_read_array_parallel(input, STATS_MAX_DEPTH, n_threads, C_JSON_PARALLEL_UNORDERED,
+                                               stats_element, NULL, &array);
+
+                for (size_t i = 0; i < array.n_stats; i += 1) {
+                        if (!r)
+                                r = stats_merge(stats, array.stats[i]);
+                        stats_keys_deinit(&array.stats[i]->keys);
+                        free(array.stats[i]);
+                }
+                free(array.stats);
+                pthread_mutex_destroy(&array.lock);
+
+                if (r) {
+                        /* the workers do not report positions, so validate again to find it */
+                        if (r > 0)
+                                c_json_validate(input, n_input, STATS_MAX_DEPTH, error_offsetp);
+                        return r;
+                }
+
+                /* account for the array itself, with the elements at depth 1 */
+                n_elements = stats->depths[1];
+                stats->n_documents = 1;
+                stats->n_values[C_JSON_TYPE_ARRAY] += 1;
+                stats->depths[0] += 1;
+                stats->arrays[stats_bucket(n_elements)] += 1;
+                stats->max_array = c_max(stats->max_array, n_elements);
+                return 0;
+        }
+
+        r = c_json_reader_new(&reader, STATS_MAX_DEPTH);
+        if (r)
+                return r;
+
+        c_json_reader_set_flags(reader, flags);
+        c_json_reader_begin_read(reader, input);
+        r = c_json_reader_parse(reader, &stats_handler, stats);
+        k = c_json_reader_end_read(reader);
+        r = r ?: k;
+        if (r) {
+                *error_offsetp = c_json_reader_error_offset(reader);
+                return r;
+        }
+
+        stats->n_documents = 1;
+        return 0;
+}
+
+static void write_histogram(CJsonWriter *writer, const char *name, const uint64_t *counts, size_t n_counts) {
+        while (n_counts > 0 && !counts[n_counts - 1])
+                n_counts -= 1;
+
+        c_json_writer_write_string(writer, name, strlen(name));
+        c_json_writer_enter_array(writer);
+        for (size_t i = 0; i < n_counts; i += 1)
+                c_json_writer_write_uint64(writer, counts[i]);
+        c_json_writer_exit_array(writer);
+}
+
+static void write_count(CJsonWriter *writer, const char *name, uint64_t count) {
+        c_json_writer_write_string(writer, name, strlen(name));
+        c_json_writer_write_uint64(writer, count);
+}
+
+static int compare_keys(const void *a, const void *b) {
+        const StatsKey *x = *(StatsKey * const *)a, *y = *(StatsKey * const *)b;
+
+        if (x->count != y->count)
+                return x->count < y->count ? 1 : -1;
+
+        return memcmp(x->key, y->key, c_min(x->n_key, y->n_key)) ?: (x->n_key > y->n_key) - (x->n_key < y->n_key);
+}
+
+static int write_keys(CJsonWriter *writer, const StatsKeys *keys, size_t n_top) {
+        _c_cleanup_ (c_freep) StatsKey **sorted = NULL;
+        size_t n = 0;
+
+        sorted = calloc(keys->n_entries ?: 1, sizeof(*sorted));
+        if (!sorted)
+                return -ENOMEM;
+
+        for (size_t i = 0; i < keys->n_allocated; i += 1)
+                if (keys->entries[i].key)
+                        sorted[n++] = &keys->entries[i];
+
+        qsort(sorted, n, sizeof(*sorted), compare_keys);
+
+        c_json_writer_write_string(writer, "top", strlen("top"));
+        c_json_writer_enter_object(writer);
+        for (size_t i = 0; i < n && (!n_top || i < n_top); i += 1) {
+                c_json_writer_write_string(writer, sorted[i]->key, sorted[i]->n_key);
+                c_json_writer_write_uint64(writer, sorted[i]->count);
+        }
+        c_json_writer_exit_object(writer);
+
+        return 0;
+}
+
+static int write_stats(const Stats *stats, uint64_t n_input, size_t n_top) {
+        _c_cleanup_ (c_json_writer_freep) CJsonWriter *writer = NULL;
+        int r;
+
+        r = c_json_writer_new(&writer, 4, 0);
+        if (r)
+                return r;
+
+        c_json_writer_begin_write(writer, STDOUT_FILENO);
+        c_json_writer_enter_object(writer);
+
+        write_count(writer, "documents", stats->n_documents);
+        write_count(writer, "bytes", n_input);
+
+        c_json_writer_write_string(writer, "values", strlen("values"));
+        c_json_writer_enter_object(writer);
+        write_count(writer, "null", stats->n_values[C_JSON_TYPE_NULL]);
+        write_count(writer, "boolean", stats->n_values[C_JSON_TYPE_BOOLEAN]);
+        write_count(writer, "string", stats->n_values[C_JSON_TYPE_STRING]);
+        write_count(writer, "number", stats->n_values[C_JSON_TYPE_NUMBER]);
+        write_count(writer, "array", stats->n_values[C_JSON_TYPE_ARRAY]);
+        write_count(writer, "object", stats->n_values[C_JSON_TYPE_OBJECT]);
+        c_json_writer_exit_object(writer);
+
+        write_histogram(writer, "depths", stats->depths, C_ARRAY_SIZE(stats->depths));
+
+        c_json_writer_write_string(writer, "strings", strlen("strings"));
+        c_json_writer_enter_object(writer);
+        write_count(writer, "escaped", stats->n_strings_escaped);
+        write_count(writer, "bytes", stats->n_string_bytes);
+        write_count(writer, "max_length", stats->max_string);
+        write_histogram(writer, "lengths", stats->strings, STATS_N_BUCKETS);
+        c_json_writer_exit_object(writer);
+
+        c_json_writer_write_string(writer, "keys", strlen("keys"));
+        c_json_writer_enter_object(writer);
+        write_count(writer, "count", stats->n_keys);
+        write_count(writer, "escaped", stats->n_keys_escaped);
+        write_count(writer, "distinct", stats->keys.n_entries);
+        write_count(writer, "untracked", stats->keys.n_untracked);
+        write_count(writer, "max_length", stats->max_key);
+        write_histogram(writer, "lengths", stats->key_lengths, STATS_N_BUCKETS);
+        r = write_keys(writer, &stats->keys, n_top);
+        if (r)
+                return r;
+        c_json_writer_exit_object(writer);
+
+        c_json_writer_write_string(writer, "numbers", strlen("numbers"));
+        c_json_writer_enter_object(writer);
+        write_count(writer, "negative", stats->n_negative);
+        write_count(writer, "integer", stats->n_integer);
+        write_count(writer, "fraction", stats->n_fraction);
+        write_count(writer, "exponent", stats->n_exponent);
+        write_count(writer, "max_length", stats->max_number);
+        c_json_writer_exit_object(writer);
+
+        c_json_writer_write_string(writer, "arrays", strlen("arrays"));
+        c_json_writer_enter_object(writer);
+        write_count(writer, "max_size", stats->max_array);
+        write_histogram(writer, "sizes", stats->arrays, STATS_N_BUCKETS);
+        c_json_writer_exit_object(writer);
+
+        c_json_writer_write_string(writer, "objects", strlen("objects"));
+        c_json_writer_enter_object(writer);
+        write_count(writer, "max_size", stats->max_object);
+        write_histogram(writer, "sizes", stats->objects, STATS_N_BUCKETS);
+        c_json_writer_exit_object(writer);
+
+        c_json_writer_exit_object(writer);
+
+        r = c_json_writer_end_write(writer);
+        if (r)
+                return r;
+
+        return write(STDOUT_FILENO, "\n", 1) == 1 ? 0 : -errno;
+}
+
+static const char * error_string(int r) {
+        switch (r) {
+        case C_JSON_E_INVALID_JSON:
+                return "invalid JSON";
+        case C_JSON_E_DEPTH_OVERFLOW:
+                return "nesting too deep";
+        default:
+                return r < 0 ? strerror(-r) : "unknown error";
+        }
+}
+
+static void usage(const char *name) {
+        fprintf(stderr,
+                "Usage: %s [OPTIONS] [FILE]\n"
+                "\n"
+                "Print statistics about the shape of JSON data as a JSON object: value\n"
+                "types, depths, string and key lengths, key frequencies, number forms\n"
+                "and container sizes. Histograms have one bucket per power of two,\n"
+                "bucket 0 counts 0 and bucket i counts [2^(i-1), 2^i).\n"
+                "\n"
+                "  -l, --lines                 Read one document per line (NDJSON)\n"
+                "  -j, --threads N             Use N threads (default: one per CPU)\n"
+                "  -k, --keys N                List the N most frequent keys (default: 32, 0: all)\n"
+                "  -m, --max-keys N            Count at most N distinct keys (default: 65536)\n"
+                "  -t, --trusted               Skip the checks for trusted input\n",
+                name);
+}
+
+static bool parse_size(const char *arg, size_t *sizep) {
+        char *end;
+
+        *sizep = strtoul(arg, &end, 10);
+        return *arg && !*end;
+}
+
+int main(int argc, char **argv) {
+        static const struct option options[] = {
+                { "lines",      no_argument,            NULL,   'l' },
+                { "threads",    required_argument,      NULL,   'j' },
+                { "keys",       required_argument,      NULL,   'k' },
+                { "max-keys",   required_argument,      NULL,   'm' },
+                { "trusted",    no_argument,            NULL,   't' },
+                { "help",       no_argument,            NULL,   'h' },
+                {}
+        };
+        _c_cleanup_ (c_fclosep) FILE *file = NULL;
+        _c_cleanup_ (c_freep) char *contents = NULL;
+        _c_cleanup_ (c_freep) Stats *stats = NULL;
+        size_t n_input, n_map = 0, n_threads = 0, n_top = 32, max_keys = 65536, offset = 0;
+        const char *name = "<stdin>", *input = NULL;
+        unsigned int flags = 0;
+        CJsonLocation location;
+        bool lines = false;
+        int c, r;
+
+        while ((c = getopt_long(argc, argv, "lj:k:m:th", options, NULL)) >= 0) {
+                switch (c) {
+                case 'l':
+                        lines = true;
+                        break;
+                case 'j':
+                        if (!parse_size(optarg, &n_threads) || !n_threads) {
+                                fprintf(stderr, "Invalid number of threads: %s\n", optarg);
+                                return 1;
+                        }
+                        break;
+                case 'k':
+                        if (!parse_size(optarg, &n_top)) {
+                                fprintf(stderr, "Invalid number of keys: %s\n", optarg);
+                                return 1;
+                        }
+                        break;
+                case 'm':
+                        if (!parse_size(optarg, &max_keys)) {
+                                fprintf(stderr, "Invalid number of keys: %s\n", optarg);
+                                return 1;
+                        }
+                        break;
+                case 't':
+                        flags |= C_JSON_READER_TRUSTED;
+                        break;
+                case 'h':
+                        usage(argv[0]);
+                        return 0;
+                default:
+                        usage(argv[0]);
+                        return 1;
+                }
+        }
+
+        if (optind < argc) {
+                name = argv[optind];
+                file = fopen(name, "r");
+                if (!file) {
+                        fprintf(stderr, "%s: %s\n", name, strerror(errno));
+                        return 1;
+                }
+        }
+
+        r = map_file(fileno(file ?: stdin), &input, &n_input, &n_map);
+        if (r > 0) {
+                r = read_file(file ?: stdin, &contents, &n_input);
+                input = contents;
+        }
+        if (r) {
+                fprintf(stderr, "%s: %s\n", name, strerror(-r));
+                return 1;
+        }
+
+        if (!n_threads)
+                n_threads = c_max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+        if (n_input < STATS_MIN_PARALLEL)
+                n_threads = 1;
+
+        stats = calloc(1, sizeof(*stats));
+        if (!stats)
+                return 1;
+        stats->keys.max_entries = max_keys;
+
+        if (lines)
+                r = stats_lines(stats, input, n_input, n_threads, flags, &offset);
+        else
+                r = stats_document(stats, input, n_input, n_threads, flags, &offset);
+        if (!r)
+                r = write_stats(stats, n_input, n_top);
+
+        if (r > 0) {
+                c_json_locate(input, n_input, offset, &location);
+                fprintf(stderr, "%s:%zu:%zu: %s\n", name, location.line, location.column, error_string(r));
+        } else if (r < 0) {
+                fprintf(stderr, "%s: %s\n", name, strerror(-r));
+        }
+
+        stats_keys_deinit(&stats->keys);
+        if (n_map)
+                munmap((void *)input, n_map);
+
+        return r ? 1 : 0;
+}
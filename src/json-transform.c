@@ -0,0 +1,115 @@
+
+#undef NDEBUG
+#include <c-stdaux.h>
+#include <getopt.h>
+#include <stdio.h>
+#include "c-json.h"
+#include "json-util.h"
+
+static void usage(const char *name) {
+        fprintf(stderr,
+                "Usage: %s [OPTIONS] [FILE]\n"
+                "\n"
+                "Copy a JSON document to stdout, with the selected members removed,\n"
+                "replaced or renamed. Everything else is copied verbatim.\n"
+                "\n"
+                "  -d, --drop PATH             Remove the values at PATH\n"
+                "  -r, --redact PATH[=JSON]    Replace the values at PATH (default: null)\n"
+                "  -n, --rename PATH=NAME      Rename the members at PATH to NAME\n"
+                "\n"
+                "PATH is a JSON pointer, where '*' matches any key or index.\n",
+                name);
+}
+
+static int add_rule(CJsonTransform *transform, int action, char *arg) {
+        const char *argument = NULL;
+        char *eq;
+
+        if (action != C_JSON_TRANSFORM_DROP) {
+                eq = strchr(arg, '=');
+                if (eq) {
+                        *eq = '\0';
+                        argument = eq + 1;
+                } else if (action == C_JSON_TRANSFORM_REPLACE) {
+                        argument = "null";
+                } else {
+                        return -EINVAL;
+                }
+        }
+
+        return c_json_transform_add(transform, arg, action, argument);
+}
+
+int main(int argc, char **argv) {
+        static const struct option options[] = {
+                { "drop",       required_argument,      NULL,   'd' },
+                { "redact",     required_argument,      NULL,   'r' },
+                { "rename",     required_argument,      NULL,   'n' },
+                { "help",       no_argument,            NULL,   'h' },
+                {}
+        };
+        _c_cleanup_ (c_fclosep) FILE *file = NULL;
+        _c_cleanup_ (c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_ (c_json_transform_freep) CJsonTransform *transform = NULL;
+        _c_cleanup_ (c_freep) char *input = NULL;
+        size_t n_input;
+        int c, r;
+
+        r = c_json_transform_new(&transform);
+        if (r)
+                return 1;
+
+        while ((c = getopt_long(argc, argv, "d:r:n:h", options, NULL)) >= 0) {
+                switch (c) {
+                case 'd':
+                        r = add_rule(transform, C_JSON_TRANSFORM_DROP, optarg);
+                        break;
+                case 'r':
+                        r = add_rule(transform, C_JSON_TRANSFORM_REPLACE, optarg);
+                        break;
+                case 'n':
+                        r = add_rule(transform, C_JSON_TRANSFORM_RENAME, optarg);
+                        break;
+                case 'h':
+                        usage(argv[0]);
+                        return 0;
+                default:
+                        usage(argv[0]);
+                        return 1;
+                }
+
+                if (r) {
+                        fprintf(stderr, "Invalid rule: %s\n", optarg);
+                        return 1;
+                }
+        }
+
+        if (optind >= argc) {
+                r = read_file(stdin, &input, &n_input);
+                if (r)
+                        return 1;
+        } else {
+                file = fopen(argv[optind], "r");
+                if (!file)
+                        return 1;
+
+                r = read_file(file, &input, &n_input);
+                if (r)
+                        return 1;
+        }
+
+        r = c_json_reader_new(&reader, 256);
+        if (r)
+                return 1;
+
+        c_json_reader_begin_read(reader, input);
+        r = c_json_transform_run(transform, reader, stdout);
+        if (r)
+                return r < 0 ? 1 : r;
+
+        r = c_json_reader_end_read(reader);
+        if (r)
+                return r < 0 ? 1 : r;
+
+        return fflush(stdout) ? 1 : 0;
+}
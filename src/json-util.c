@@ -0,0 +1,85 @@
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "json-util.h"
+
+/*
+ * Reads all of @file into a 0-terminated buffer, for input that cannot be
+ * mapped, like pipes.
+ */
+int read_file(FILE *file, char **contentsp, size_t *n_contentsp) {
+        _c_cleanup_ (c_fclosep) FILE *stream = NULL;
+        _c_cleanup_ (c_freep) char *contents = NULL;
+        size_t n_input;
+
+        stream = open_memstream(&contents, &n_input);
+        if (!stream)
+                return -errno;
+
+        for (;;) {
+                char buffer[8192];
+                size_t n;
+
+                n = fread(buffer, 1, sizeof(buffer), file);
+                if (n == 0) {
+                        if (ferror(file))
+                                return -errno;
+                        break;
+                }
+
+                if (fwrite(buffer, 1, n, stream) != n)
+                        return -errno;
+        }
+
+        stream = c_fclose(stream);
+        *contentsp = contents;
+        *n_contentsp = n_input;
+        contents = NULL;
+
+        return 0;
+}
+
+/*
+ * Maps the regular file @fd, followed by an anonymous page, which provides
+ * the 0-terminator the reader needs without copying the file. Returns 1
+ * if @fd cannot be mapped, and has to be read instead.
+ */
+int map_file(int fd, const char **inputp, size_t *n_inputp, size_t *n_mapp) {
+        size_t n_page = sysconf(_SC_PAGESIZE);
+        struct stat st;
+        size_t n_map;
+        void *map;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        if (!S_ISREG(st.st_mode) || !st.st_size)
+                return 1;
+
+        n_map = ((size_t)st.st_size + n_page) / n_page * n_page;
+
+        map = mmap(NULL, n_map, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED)
+                return -errno;
+
+        if (mmap(map, st.st_size, PROT_READ, MAP_PRIVATE | MAP_FIXED | MAP_POPULATE, fd, 0) == MAP_FAILED) {
+                munmap(map, n_map);
+                return -errno;
+        }
+
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+        *inputp = map;
+        *n_inputp = st.st_size;
+        *n_mapp = n_map;
+        return 0;
+}
+
+const char * skip_space(const char *p) {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+                p += 1;
+
+        return p;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+ * Helpers shared between the command-line tools.
+ */
+
+#include <c-stdaux.h>
+#include <stdio.h>
+
+int read_file(FILE *file, char **contentsp, size_t *n_contentsp);
+int map_file(int fd, const char **inputp, size_t *n_inputp, size_t *n_mapp);
+const char * skip_space(const char *p);
@@ -1,39 +1,11 @@
 
 #undef NDEBUG
 #include <c-stdaux.h>
+#include <getopt.h>
 #include <stdio.h>
+#include <string.h>
 #include "c-json.h"
-
-int read_file(FILE *file, char **contentsp) {
-        _c_cleanup_ (c_fclosep) FILE *stream = NULL;
-        _c_cleanup_ (c_freep) char *contents = NULL;
-        size_t n_input;
-
-        stream = open_memstream(&contents, &n_input);
-        if (!stream)
-                return -errno;
-
-        for (;;) {
-                char buffer[8192];
-                size_t n;
-
-                n = fread(buffer, 1, sizeof(buffer), file);
-                if (n == 0) {
-                        if (ferror(file))
-                                return -errno;
-                        break;
-                }
-
-                if (fwrite(buffer, 1, n, stream) != n)
-                        return -errno;
-        }
-
-        stream = c_fclose(stream);
-        *contentsp = contents;
-        contents = NULL;
-
-        return 0;
-}
+#include "json-util.h"
 
 int json_read_value(CJsonReader *reader) {
         switch (c_json_reader_peek(reader)) {
@@ -72,31 +44,110 @@ int json_read_value(CJsonReader *reader) {
         }
 }
 
+static const char * error_string(int r) {
+        switch (r) {
+        case C_JSON_E_INVALID_JSON:
+                return "invalid JSON";
+        case C_JSON_E_INVALID_TYPE:
+                return "unexpected type";
+        case C_JSON_E_DEPTH_OVERFLOW:
+                return "nesting too deep";
+        case C_JSON_E_INPUT_TOO_LARGE:
+                return "input too large";
+        case C_JSON_E_STRING_TOO_LONG:
+                return "string too long";
+        case C_JSON_E_STRINGS_TOO_LARGE:
+                return "too much string data";
+        case C_JSON_E_TOO_MANY_VALUES:
+                return "too many values";
+        case C_JSON_E_NUMBER_TOO_LONG:
+                return "number too long";
+        case C_JSON_E_TOO_MANY_MEMBERS:
+                return "container too large";
+        default:
+                return r < 0 ? strerror(-r) : "unknown error";
+        }
+}
+
+/* prints "file:line:column: error", followed by the context and a marker */
+static void print_error(const char *name, const char *input, size_t n_input, size_t offset, int r) {
+        CJsonLocation location;
+
+        c_json_locate(input, n_input, offset, &location);
+
+        fprintf(stderr, "%s:%zu:%zu: %s (offset %zu)\n",
+                name, location.line, location.column, error_string(r), offset);
+        fprintf(stderr, "    %.*s\n", (int)location.n_context, location.context);
+        fprintf(stderr, "    %*s^\n", (int)location.context_offset, "");
+}
+
 int main(int argc, char **argv) {
+        static const struct option options[] = {
+                { "reader",     no_argument,    NULL,   'r' },
+                { "trusted",    no_argument,    NULL,   't' },
+                {}
+        };
         _c_cleanup_ (c_fclosep) FILE *file = NULL;
         _c_cleanup_ (c_json_reader_freep) CJsonReader *reader = NULL;
         _c_cleanup_ (c_freep) char *input = NULL;
-        int r;
+        bool use_reader = false;
+        unsigned int flags = 0;
+        const char *name = "<stdin>";
+        size_t n_input, offset;
+        int c, r;
+
+        while ((c = getopt_long(argc, argv, "rt", options, NULL)) >= 0) {
+                switch (c) {
+                case 'r':
+                        use_reader = true;
+                        break;
+                case 't':
+                        use_reader = true;
+                        flags |= C_JSON_READER_TRUSTED;
+                        break;
+                default:
+                        return 1;
+                }
+        }
 
-        if (argc < 2) {
-                r = read_file(stdin, &input);
+        if (optind >= argc) {
+                r = read_file(stdin, &input, &n_input);
                 if (r)
                         return 1;
         } else {
-                file = fopen(argv[1], "r");
+                name = argv[optind];
+                file = fopen(name, "r");
                 if (!file)
                         return -errno;
 
-                r = read_file(file, &input);
+                r = read_file(file, &input, &n_input);
                 if (r)
                         return 1;
         }
 
+        if (!use_reader) {
+                r = c_json_validate(input, n_input, 256, &offset);
+                if (r > 0)
+                        print_error(name, input, n_input, offset, r);
+                return r < 0 ? 1 : r;
+        }
+
+        /* walk the document through the reader API instead */
         c_json_reader_new(&reader, 256);
+        c_json_reader_set_flags(reader, flags);
         c_json_reader_begin_read(reader, input);
         r = json_read_value(reader);
+
+        /*
+         * A failed peek does not poison the reader, so its error takes
+         * precedence, but ending the read still records the position.
+         */
+        if (r)
+                c_json_reader_end_read(reader);
+        else
+                r = c_json_reader_end_read(reader);
         if (r)
-                return r;
+                print_error(name, input, n_input, c_json_reader_error_offset(reader), r);
 
-        return c_json_reader_end_read(reader);
+        return r;
 }
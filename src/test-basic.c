@@ -149,10 +149,231 @@ static void test_peek(void) {
         reader = c_json_reader_free(reader);
 }
 
+static void test_trusted(void) {
+        static const char *input = "{\"a\": [\"b\\u00e4\", \"\xc3\xa4\", -1.5e3, true, null], \"c\": {}}";
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *a = NULL, *b = NULL, *c = NULL, *d = NULL;
+        const char *number;
+        size_t n_number;
+        bool v;
+
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_set_flags(reader, C_JSON_READER_TRUSTED);
+
+        /* valid input reads the same as without the flag */
+        c_json_reader_begin_read(reader, input);
+        assert(!c_json_reader_enter_object(reader));
+        assert(!c_json_reader_read_string(reader, &a));
+        assert(!strcmp(a, "a"));
+        assert(!c_json_reader_enter_array(reader));
+        assert(!c_json_reader_read_string(reader, &b));
+        assert(!strcmp(b, "b\xc3\xa4"));
+        assert(!c_json_reader_read_string(reader, &c));
+        assert(!strcmp(c, "\xc3\xa4"));
+        assert(!c_json_reader_read_number(reader, &number, &n_number));
+        assert(n_number == strlen("-1.5e3") && !strncmp(number, "-1.5e3", n_number));
+        assert(!c_json_reader_read_bool(reader, &v));
+        assert(v);
+        assert(!c_json_reader_read_null(reader));
+        assert(!c_json_reader_exit_array(reader));
+        assert(!c_json_reader_skip(reader));
+        assert(!c_json_reader_skip(reader));
+        assert(!c_json_reader_exit_object(reader));
+        assert(!c_json_reader_end_read(reader));
+
+        /* malformed input may be accepted, but is never read past its end */
+        c_json_reader_begin_read(reader, "[1-2, \"\x01\xff\"]");
+        assert(!c_json_reader_skip(reader));
+        assert(!c_json_reader_end_read(reader));
+
+        c_json_reader_begin_read(reader, "\"\xf4\"");
+        assert(c_json_reader_read_string(reader, &d) == C_JSON_E_INVALID_JSON);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_JSON);
+
+        c_json_reader_begin_read(reader, "\"\xc3\"  \"");
+        assert(c_json_reader_read_string(reader, &d) == C_JSON_E_INVALID_JSON);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_JSON);
+
+        c_json_reader_begin_read(reader, "\"a\\u12\"");
+        assert(c_json_reader_skip(reader) == C_JSON_E_INVALID_JSON);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_JSON);
+}
+
+static void assert_error_offset(const char *input, int expected_r, size_t expected_offset) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+
+        assert(!c_json_reader_new(&reader, 2));
+
+        c_json_reader_begin_read(reader, input);
+        c_json_reader_skip(reader);
+        assert(c_json_reader_end_read(reader) == expected_r);
+        assert(c_json_reader_error_offset(reader) == expected_offset);
+}
+
+static void test_error_offset(void) {
+        assert_error_offset("[1, 2, x]", C_JSON_E_INVALID_JSON, 7);
+        assert_error_offset("[1, 2,\n 01]", C_JSON_E_INVALID_JSON, 9);
+        assert_error_offset("{\"a\": \"b\\q\"}", C_JSON_E_INVALID_JSON, 9);
+        assert_error_offset("{\"a\" 1}", C_JSON_E_INVALID_JSON, 5);
+        assert_error_offset("[[[1]]]", C_JSON_E_DEPTH_OVERFLOW, 2);
+        assert_error_offset("[1] x", C_JSON_E_INVALID_JSON, 4);
+}
+
+static int read_limited(const char *input, const CJsonLimits *limits, bool parse) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        CJsonHandler handler = {};
+        int r;
+
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_set_limits(reader, limits);
+
+        /* the reader functions and the event parser enforce the same limits */
+        c_json_reader_begin_read(reader, input);
+        if (parse)
+                c_json_reader_parse(reader, &handler, NULL);
+        else
+                c_json_reader_skip(reader);
+        r = c_json_reader_end_read(reader);
+
+        /* limits apply per document */
+        c_json_reader_begin_read(reader, input);
+        c_json_reader_skip(reader);
+        assert(c_json_reader_end_read(reader) == r);
+
+        return r;
+}
+
+static void assert_limited(const char *input, const CJsonLimits *limits, int expected_r) {
+        assert(read_limited(input, limits, false) == expected_r);
+        assert(read_limited(input, limits, true) == expected_r);
+}
+
+static void test_limits(void) {
+        static const char *input = "{\"ab\": [1, 22, 333], \"c\": \"de\\n\"}";
+        static const char unterminated[5] = "[1,2,";
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *string = NULL;
+
+        assert_limited(input, &(CJsonLimits){}, 0);
+
+        /* each limit is inclusive and has its own error */
+        assert_limited(input, &(CJsonLimits){ .max_input = strlen(input) }, 0);
+        assert_limited(input, &(CJsonLimits){ .max_input = strlen(input) - 1 }, C_JSON_E_INPUT_TOO_LARGE);
+        assert_limited(input, &(CJsonLimits){ .max_string = 4 }, 0);
+        assert_limited(input, &(CJsonLimits){ .max_string = 3 }, C_JSON_E_STRING_TOO_LONG);
+        assert_limited(input, &(CJsonLimits){ .max_strings = 7 }, 0);
+        assert_limited(input, &(CJsonLimits){ .max_strings = 6 }, C_JSON_E_STRINGS_TOO_LARGE);
+        assert_limited(input, &(CJsonLimits){ .max_values = 8 }, 0);
+        assert_limited(input, &(CJsonLimits){ .max_values = 7 }, C_JSON_E_TOO_MANY_VALUES);
+        assert_limited(input, &(CJsonLimits){ .max_number = 3 }, 0);
+        assert_limited(input, &(CJsonLimits){ .max_number = 2 }, C_JSON_E_NUMBER_TOO_LONG);
+        assert_limited(input, &(CJsonLimits){ .max_members = 3 }, 0);
+        assert_limited(input, &(CJsonLimits){ .max_members = 2 }, C_JSON_E_TOO_MANY_MEMBERS);
+
+        /* oversized input is rejected without reading past the limit */
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_set_limits(reader, &(CJsonLimits){ .max_input = 4 });
+        c_json_reader_begin_read(reader, unterminated);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INPUT_TOO_LARGE);
+        reader = c_json_reader_free(reader);
+
+        /* long strings are rejected before they are allocated */
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_set_limits(reader, &(CJsonLimits){ .max_string = 3 });
+        c_json_reader_begin_read(reader, "[\"abc\", \"abcd\"]");
+        assert(!c_json_reader_enter_array(reader));
+        assert(!c_json_reader_read_string(reader, &string));
+        string = c_free(string);
+        assert(c_json_reader_read_string(reader, &string) == C_JSON_E_STRING_TOO_LONG);
+        assert(!string);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_STRING_TOO_LONG);
+        reader = c_json_reader_free(reader);
+
+        /* values beyond the limit are rejected before they are read */
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_set_limits(reader, &(CJsonLimits){ .max_values = 1 });
+        c_json_reader_begin_read(reader, "[\"abc\"]");
+        assert(c_json_reader_enter_array(reader) == C_JSON_E_TOO_MANY_VALUES);
+        assert(c_json_reader_read_string(reader, &string) == C_JSON_E_TOO_MANY_VALUES);
+        assert(!string);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_TOO_MANY_VALUES);
+}
+
+static void test_checkpoint(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_json_checkpoint_deinitp) CJsonCheckpoint outer = {}, inner = {};
+        _c_cleanup_(c_freep) char *string = NULL;
+        const char *number;
+        bool b;
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        /* a failed attempt to read a value can be retried as another type */
+        c_json_reader_begin_read(reader, "[{\"a\": [1, 2]}, true]");
+        assert(!c_json_reader_enter_array(reader));
+        assert(!c_json_reader_checkpoint(reader, &outer));
+        assert(c_json_reader_enter_array(reader) == C_JSON_E_INVALID_TYPE);
+        c_json_reader_restore(reader, &outer);
+        assert(!c_json_reader_enter_object(reader));
+        assert(!c_json_reader_read_string(reader, &string));
+        assert(!strcmp(string, "a"));
+        string = c_free(string);
+
+        /* speculation can fail below the level of the checkpoint */
+        assert(!c_json_reader_checkpoint(reader, &inner));
+        assert(!c_json_reader_enter_array(reader));
+        assert(!c_json_reader_read_number(reader, &number, NULL));
+        assert(c_json_reader_read_string(reader, &string) == C_JSON_E_INVALID_TYPE);
+        assert(!string);
+        c_json_reader_restore(reader, &inner);
+        assert(!c_json_reader_skip(reader));
+        assert(!c_json_reader_exit_object(reader));
+
+        /* ...as well as after leaving it */
+        assert(!c_json_reader_read_bool(reader, &b));
+        assert(!c_json_reader_exit_array(reader));
+        c_json_reader_restore(reader, &inner);
+        assert(!c_json_reader_enter_array(reader));
+        assert(!c_json_reader_skip(reader));
+        assert(!c_json_reader_skip(reader));
+        assert(!c_json_reader_exit_array(reader));
+        assert(!c_json_reader_exit_object(reader));
+        assert(!c_json_reader_read_bool(reader, &b));
+        assert(b);
+        assert(!c_json_reader_exit_array(reader));
+
+        /* checkpoints can be restored more than once, even after the end */
+        c_json_reader_restore(reader, &outer);
+        assert(!c_json_reader_skip(reader));
+        assert(!c_json_reader_skip(reader));
+        assert(!c_json_reader_exit_array(reader));
+        assert(!c_json_reader_end_read(reader));
+
+        /* checkpoints can be reused at deeper levels */
+        c_json_reader_begin_read(reader, "[[[[[1]]]], 2]");
+        assert(!c_json_reader_checkpoint(reader, &outer));
+        for (size_t i = 0; i < 5; i += 1) {
+                assert(!c_json_reader_enter_array(reader));
+                assert(!c_json_reader_checkpoint(reader, &outer));
+        }
+        assert(c_json_reader_read_bool(reader, &b) == C_JSON_E_INVALID_TYPE);
+        c_json_reader_restore(reader, &outer);
+        assert(!c_json_reader_read_number(reader, &number, NULL));
+        for (size_t i = 0; i < 4; i += 1)
+                assert(!c_json_reader_exit_array(reader));
+        assert(!c_json_reader_read_number(reader, &number, NULL));
+        assert(!c_json_reader_exit_array(reader));
+        assert(!c_json_reader_end_read(reader));
+}
+
 int main(int argc, char **argv) {
         test_basic();
         test_array();
         test_object();
         test_peek();
+        test_trusted();
+        test_error_offset();
+        test_limits();
+        test_checkpoint();
         return 0;
 }
@@ -0,0 +1,158 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+
+#define MESSAGE(_x) { .data = (_x), .n_data = sizeof(_x) - 1 }
+
+static const CJsonMessage messages[] = {
+        MESSAGE("{ \"method\": \"ping\", \"id\": 1 }"),
+        MESSAGE("{ \"method\": \"echo\", \"id\": 2 }trailing"),
+        MESSAGE("[ 1, 2"),
+        MESSAGE("{ \"method\": \"stop\", \"id\": 3 }"),
+        MESSAGE("{ \"method\": \"x\", \"id\": 4 } \0 {}"),
+        MESSAGE("[[[[[]]]]]"),
+        MESSAGE(""),
+        MESSAGE("42"),
+};
+
+typedef struct Calls {
+        size_t n_calls;
+        uint64_t ids;
+} Calls;
+
+static int read_call(void *userdata, CJsonReader *reader, size_t index) {
+        Calls *calls = userdata;
+        _c_cleanup_(c_freep) char *key = NULL, *method = NULL;
+        const char *id;
+        int r;
+
+        calls->n_calls += 1;
+
+        r = c_json_reader_enter_object(reader);
+        if (r)
+                return r;
+
+        assert(!c_json_reader_read_string(reader, &key));
+        assert(!strcmp(key, "method"));
+        assert(!c_json_reader_read_string(reader, &method));
+        if (!strcmp(method, "echo"))
+                assert(index == 1);
+
+        assert(!c_json_reader_read_string(reader, NULL));
+        assert(!c_json_reader_read_number(reader, &id, NULL));
+        calls->ids |= UINT64_C(1) << strtoul(id, NULL, 10);
+
+        if (!strcmp(method, "stop"))
+                return -EPIPE;
+
+        return c_json_reader_exit_object(reader);
+}
+
+static void test_validate(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        int results[C_ARRAY_SIZE(messages)];
+
+        assert(!c_json_reader_new(&reader, 4));
+        assert(!c_json_reader_read_batch(reader, messages, C_ARRAY_SIZE(messages), NULL, NULL, results));
+
+        assert(results[0] == 0);
+        assert(results[1] == C_JSON_E_INVALID_JSON);
+        assert(results[2] == C_JSON_E_INVALID_JSON);
+        assert(results[3] == 0);
+        assert(results[4] == C_JSON_E_INVALID_JSON);
+        assert(results[5] == C_JSON_E_DEPTH_OVERFLOW);
+        assert(results[6] == C_JSON_E_INVALID_JSON);
+        assert(results[7] == 0);
+}
+
+static void test_limits(void) {
+        static const CJsonMessage limited[] = {
+                MESSAGE("[1,2,3,4,5,6]"),
+                MESSAGE("[1]"),
+                MESSAGE("\"abcdef\""),
+        };
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        int results[C_ARRAY_SIZE(limited)];
+
+        /* limits apply to messages that are only validated, too */
+        assert(!c_json_reader_new(&reader, 4));
+        c_json_reader_set_limits(reader, &(CJsonLimits){ .max_values = 2 });
+        assert(!c_json_reader_read_batch(reader, limited, C_ARRAY_SIZE(limited), NULL, NULL, results));
+        assert(results[0] == C_JSON_E_TOO_MANY_VALUES);
+        assert(results[1] == 0);
+        assert(results[2] == 0);
+
+        c_json_reader_set_limits(reader, &(CJsonLimits){ .max_input = 4 });
+        assert(!c_json_reader_read_batch(reader, limited, C_ARRAY_SIZE(limited), NULL, NULL, results));
+        assert(results[0] == C_JSON_E_INPUT_TOO_LARGE);
+        assert(results[1] == 0);
+        assert(results[2] == C_JSON_E_INPUT_TOO_LARGE);
+}
+
+static void test_read(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        int results[C_ARRAY_SIZE(messages)];
+        Calls calls = {};
+
+        assert(!c_json_reader_new(&reader, 4));
+
+        /* a fatal error in the callback stops the batch */
+        assert(c_json_reader_read_batch(reader, messages, C_ARRAY_SIZE(messages), read_call, &calls, results) == -EPIPE);
+        assert(calls.n_calls == 4);
+        assert(results[0] == 0);
+        assert(results[1] == C_JSON_E_INVALID_JSON);
+        assert(results[2] == C_JSON_E_INVALID_TYPE);
+
+        /* the reader can be reused after a fatal error */
+        calls = (Calls){};
+        assert(!c_json_reader_read_batch(reader, messages, 2, read_call, &calls, results));
+        assert(calls.n_calls == 2);
+        assert(calls.ids == ((1 << 1) | (1 << 2)));
+        assert(results[0] == 0);
+        assert(results[1] == C_JSON_E_INVALID_JSON);
+}
+
+static int skip_value(void *userdata, CJsonReader *reader, size_t index) {
+        return c_json_reader_skip(reader);
+}
+
+static void test_large(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *data = NULL;
+        CJsonMessage message;
+        size_t n_data = 3 * 4096;
+        int result;
+
+        /* messages larger than the stack buffer */
+        data = malloc(n_data);
+        assert(data);
+        memset(data, 'a', n_data);
+        data[0] = '"';
+        data[n_data - 1] = '"';
+        message = (CJsonMessage){ .data = data, .n_data = n_data };
+
+        /* too deep for c_json_validate(), so the reader is used */
+        assert(!c_json_reader_new(&reader, C_JSON_VALIDATE_DEPTH_MAX + 1));
+        assert(!c_json_reader_read_batch(reader, &message, 1, NULL, NULL, &result));
+        assert(result == 0);
+        assert(!c_json_reader_read_batch(reader, &message, 1, skip_value, NULL, &result));
+        assert(result == 0);
+
+        data[n_data - 1] = 'a';
+        assert(!c_json_reader_read_batch(reader, &message, 1, NULL, NULL, &result));
+        assert(result == C_JSON_E_INVALID_JSON);
+        assert(!c_json_reader_read_batch(reader, &message, 1, skip_value, NULL, &result));
+        assert(result == C_JSON_E_INVALID_JSON);
+}
+
+int main(int argc, char **argv) {
+        test_validate();
+        test_limits();
+        test_read();
+        test_large();
+        return 0;
+}
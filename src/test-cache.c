@@ -0,0 +1,241 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <string.h>
+#include "c-json.h"
+
+static int encode(const char *input, char **datap, size_t *n_datap) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        int r;
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        c_json_reader_begin_read(reader, input);
+        r = c_json_cache_encode(reader, datap, n_datap);
+        if (r) {
+                c_json_reader_end_read(reader);
+                return r;
+        }
+
+        return c_json_reader_end_read(reader);
+}
+
+static void test_scalars(void) {
+        _c_cleanup_(c_json_cursor_freep) CJsonCursor *cursor = NULL;
+        const char *number, *string;
+        size_t n_number, n_string;
+        char *data;
+        size_t n_data;
+        bool b;
+
+        assert(!c_json_cursor_new(&cursor, 256));
+
+        assert(!encode(" null ", &data, &n_data));
+        c_json_cursor_begin_read(cursor, data, n_data);
+        assert(c_json_cursor_peek(cursor) == C_JSON_TYPE_NULL);
+        assert(!c_json_cursor_read_null(cursor));
+        assert(c_json_cursor_peek(cursor) == -1);
+        assert(!c_json_cursor_end_read(cursor));
+        free(data);
+
+        assert(!encode("true", &data, &n_data));
+        c_json_cursor_begin_read(cursor, data, n_data);
+        assert(c_json_cursor_read_null(cursor) == C_JSON_E_INVALID_TYPE);
+        assert(c_json_cursor_end_read(cursor) == C_JSON_E_INVALID_TYPE);
+        c_json_cursor_begin_read(cursor, data, n_data);
+        assert(!c_json_cursor_read_bool(cursor, &b));
+        assert(b);
+        assert(!c_json_cursor_end_read(cursor));
+        free(data);
+
+        assert(!encode("-1.5e+10", &data, &n_data));
+        c_json_cursor_begin_read(cursor, data, n_data);
+        assert(!c_json_cursor_read_number(cursor, &number, &n_number));
+        assert(n_number == 8 && !memcmp(number, "-1.5e+10", 8));
+        assert(!c_json_cursor_end_read(cursor));
+        free(data);
+
+        /* strings are stored decoded, including embedded 0-bytes */
+        assert(!encode("\"a\\u0000\\n\\ud83d\\ude00\"", &data, &n_data));
+        c_json_cursor_begin_read(cursor, data, n_data);
+        assert(!c_json_cursor_read_string_ref(cursor, &string, &n_string));
+        assert(n_string == 7 && !memcmp(string, "a\0\n\xf0\x9f\x98\x80", 8));
+        assert(!c_json_cursor_end_read(cursor));
+        free(data);
+}
+
+static void test_containers(void) {
+        _c_cleanup_(c_json_cursor_freep) CJsonCursor *cursor = NULL;
+        const char *number;
+        size_t n_number;
+        char *data, *string;
+        size_t n_data;
+
+        assert(!c_json_cursor_new(&cursor, 256));
+        assert(!encode("{ \"a\": [1, [], {}], \"b\": { \"c\": \"d\" }, \"e\": null }", &data, &n_data));
+
+        c_json_cursor_begin_read(cursor, data, n_data);
+        assert(c_json_cursor_peek(cursor) == C_JSON_TYPE_OBJECT);
+        assert(c_json_cursor_enter_array(cursor) == C_JSON_E_INVALID_TYPE);
+        assert(c_json_cursor_end_read(cursor) == C_JSON_E_INVALID_TYPE);
+
+        c_json_cursor_begin_read(cursor, data, n_data);
+        assert(!c_json_cursor_enter_object(cursor));
+
+        assert(c_json_cursor_more(cursor));
+        assert(c_json_cursor_peek(cursor) == C_JSON_TYPE_STRING);
+        assert(!c_json_cursor_read_string(cursor, &string));
+        assert(!strcmp(string, "a"));
+        free(string);
+
+        assert(!c_json_cursor_enter_array(cursor));
+        assert(!c_json_cursor_read_number(cursor, &number, &n_number));
+        assert(n_number == 1 && number[0] == '1');
+        assert(!c_json_cursor_enter_array(cursor));
+        assert(!c_json_cursor_more(cursor));
+        assert(!c_json_cursor_exit_array(cursor));
+        assert(!c_json_cursor_enter_object(cursor));
+        assert(!c_json_cursor_more(cursor));
+        assert(!c_json_cursor_exit_object(cursor));
+        assert(!c_json_cursor_more(cursor));
+        assert(!c_json_cursor_exit_array(cursor));
+
+        /* containers are skipped without being read */
+        assert(!c_json_cursor_read_string(cursor, NULL));
+        assert(!c_json_cursor_skip(cursor));
+
+        assert(!c_json_cursor_read_string(cursor, &string));
+        assert(!strcmp(string, "e"));
+        free(string);
+        assert(!c_json_cursor_skip(cursor));
+
+        assert(!c_json_cursor_more(cursor));
+        assert(!c_json_cursor_exit_object(cursor));
+        assert(!c_json_cursor_end_read(cursor));
+
+        /* keys must be read as strings, values must all be read */
+        c_json_cursor_begin_read(cursor, data, n_data);
+        assert(!c_json_cursor_enter_object(cursor));
+        assert(c_json_cursor_read_null(cursor) == C_JSON_E_INVALID_TYPE);
+        assert(c_json_cursor_end_read(cursor) == C_JSON_E_INVALID_TYPE);
+
+        c_json_cursor_begin_read(cursor, data, n_data);
+        assert(!c_json_cursor_enter_object(cursor));
+        assert(c_json_cursor_exit_object(cursor) == C_JSON_E_INVALID_JSON);
+        assert(c_json_cursor_end_read(cursor) == C_JSON_E_INVALID_JSON);
+
+        free(data);
+}
+
+static void test_depth(void) {
+        _c_cleanup_(c_json_cursor_freep) CJsonCursor *cursor = NULL;
+        char *data;
+        size_t n_data;
+
+        assert(!encode("[[[]]]", &data, &n_data));
+
+        assert(!c_json_cursor_new(&cursor, 2));
+        c_json_cursor_begin_read(cursor, data, n_data);
+        assert(!c_json_cursor_enter_array(cursor));
+        assert(!c_json_cursor_enter_array(cursor));
+        assert(c_json_cursor_enter_array(cursor) == C_JSON_E_DEPTH_OVERFLOW);
+        assert(c_json_cursor_end_read(cursor) == C_JSON_E_DEPTH_OVERFLOW);
+
+        /* skipping does not descend into containers */
+        c_json_cursor_begin_read(cursor, data, n_data);
+        assert(!c_json_cursor_skip(cursor));
+        assert(!c_json_cursor_end_read(cursor));
+
+        free(data);
+}
+
+static void test_invalid(void) {
+        static const char *inputs[] = {
+                "",
+                "[1,]",
+                "{\"a\" 1}",
+                "\"\\x\"",
+        };
+        char *data;
+        size_t n_data;
+
+        for (size_t i = 0; i < C_ARRAY_SIZE(inputs); i += 1)
+                assert(encode(inputs[i], &data, &n_data) == C_JSON_E_INVALID_JSON);
+}
+
+static int walk(CJsonCursor *cursor) {
+        int r;
+
+        switch (c_json_cursor_peek(cursor)) {
+        case C_JSON_TYPE_ARRAY:
+                c_json_cursor_enter_array(cursor);
+                while (c_json_cursor_more(cursor)) {
+                        r = walk(cursor);
+                        if (r)
+                                return r;
+                }
+                return c_json_cursor_exit_array(cursor);
+        case C_JSON_TYPE_OBJECT:
+                c_json_cursor_enter_object(cursor);
+                while (c_json_cursor_more(cursor)) {
+                        r = walk(cursor);
+                        if (r)
+                                return r;
+                }
+                return c_json_cursor_exit_object(cursor);
+        default:
+                return c_json_cursor_skip(cursor);
+        }
+}
+
+static void test_corrupt(void) {
+        _c_cleanup_(c_json_cursor_freep) CJsonCursor *cursor = NULL;
+        char *data, *copy;
+        size_t n_data;
+        int r;
+
+        assert(!c_json_cursor_new(&cursor, 256));
+        assert(!encode("{ \"a\": [1, \"xy\", true], \"b\": { \"c\": [null] } }", &data, &n_data));
+
+        /* truncated caches are rejected, never read beyond their end */
+        for (size_t n = 0; n < n_data; n += 1) {
+                copy = malloc(n);
+                assert(copy || !n);
+                memcpy(copy, data, n);
+
+                c_json_cursor_begin_read(cursor, copy, n);
+                walk(cursor);
+                r = c_json_cursor_end_read(cursor);
+                assert(r == C_JSON_E_INVALID_JSON || r == C_JSON_E_INVALID_TYPE);
+
+                free(copy);
+        }
+
+        /* flipped bytes might be accepted, but must not be read out of bounds */
+        for (size_t i = 0; i < n_data; i += 1) {
+                for (unsigned int bit = 0; bit < 8; bit += 1) {
+                        copy = malloc(n_data);
+                        assert(copy);
+                        memcpy(copy, data, n_data);
+                        copy[i] ^= 1 << bit;
+
+                        c_json_cursor_begin_read(cursor, copy, n_data);
+                        walk(cursor);
+                        c_json_cursor_end_read(cursor);
+
+                        free(copy);
+                }
+        }
+
+        free(data);
+}
+
+int main(int argc, char **argv) {
+        test_scalars();
+        test_containers();
+        test_depth();
+        test_invalid();
+        test_corrupt();
+        return 0;
+}
@@ -0,0 +1,218 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <locale.h>
+#include <stdio.h>
+#include <string.h>
+#include "c-json.h"
+
+static int append(void *userdata, const char *chunk, size_t n_chunk) {
+        FILE *stream = userdata;
+
+        assert(n_chunk <= C_JSON_CHUNK_MAX);
+
+        return fwrite(chunk, 1, n_chunk, stream) == n_chunk ? 0 : -EIO;
+}
+
+static int canonicalize(const char *input, char **outputp) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        FILE *stream;
+        size_t n_output;
+        int r;
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        stream = open_memstream(outputp, &n_output);
+        assert(stream);
+
+        c_json_reader_begin_read(reader, input);
+        r = c_json_canonicalize(reader, append, stream);
+        if (r)
+                c_json_reader_end_read(reader);
+        else
+                r = c_json_reader_end_read(reader);
+
+        fclose(stream);
+        return r;
+}
+
+static void assert_canonical(const char *input, const char *expected) {
+        _c_cleanup_(c_freep) char *output = NULL;
+
+        assert(!canonicalize(input, &output));
+        if (strcmp(output, expected)) {
+                fprintf(stderr, "%s: expected %s, got %s\n", input, expected, output);
+                assert(0);
+        }
+}
+
+static void test_values(void) {
+        assert_canonical(" null ", "null");
+        assert_canonical("[ true , false ]", "[true,false]");
+        assert_canonical("\"a\\/b\\u0041\\u00e9\\u001f\\u007f\"", "\"a/bA\xc3\xa9\\u001f\x7f\"");
+        assert_canonical("\"\\b\\f\\n\\r\\t\\\"\\\\\"", "\"\\b\\f\\n\\r\\t\\\"\\\\\"");
+        assert_canonical("{ \"a\" : { \"b\" : [ ] , \"c\" : { } } }", "{\"a\":{\"b\":[],\"c\":{}}}");
+}
+
+static void test_numbers(void) {
+        /* examples from RFC 8785 */
+        assert_canonical("-0", "0");
+        assert_canonical("-0.0e5", "0");
+        assert_canonical("1E30", "1e+30");
+        assert_canonical("4.50", "4.5");
+        assert_canonical("2e-3", "0.002");
+        assert_canonical("0.000001", "0.000001");
+        assert_canonical("1e-7", "1e-7");
+        assert_canonical("333333333.33333329", "333333333.3333333");
+        assert_canonical("100000000000000000000", "100000000000000000000");
+        assert_canonical("1e21", "1e+21");
+        assert_canonical("9007199254740993", "9007199254740992");
+        assert_canonical("123456789012345", "123456789012345");
+        assert_canonical("-17", "-17");
+}
+
+static void test_locale(void) {
+        /* numbers are parsed the same in locales with a decimal comma */
+        if (!setlocale(LC_NUMERIC, "de_DE.UTF-8") && !setlocale(LC_NUMERIC, "fr_FR.UTF-8"))
+                return;
+
+        assert_canonical("4.50", "4.5");
+        assert_canonical("333333333.33333329", "333333333.3333333");
+        assert_canonical("2e-3", "0.002");
+
+        setlocale(LC_NUMERIC, "C");
+}
+
+static void test_sorting(void) {
+        _c_cleanup_(c_freep) char *output = NULL;
+
+        /* the key ordering example from RFC 8785, sorted by UTF-16 code units */
+        assert_canonical("{"
+                         "\"\\u20ac\": \"Euro Sign\","
+                         "\"\\r\": \"Carriage Return\","
+                         "\"\\ufb33\": \"Hebrew Letter Dalet With Dagesh\","
+                         "\"1\": \"One\","
+                         "\"\\ud83d\\ude00\": \"Emoji: Grinning Face\","
+                         "\"\\u0080\": \"Control\","
+                         "\"\\u00f6\": \"Latin Small Letter O With Diaeresis\""
+                         "}",
+                         "{"
+                         "\"\\r\":\"Carriage Return\","
+                         "\"1\":\"One\","
+                         "\"\xc2\x80\":\"Control\","
+                         "\"\xc3\xb6\":\"Latin Small Letter O With Diaeresis\","
+                         "\"\xe2\x82\xac\":\"Euro Sign\","
+                         "\"\xf0\x9f\x98\x80\":\"Emoji: Grinning Face\","
+                         "\"\xef\xac\xb3\":\"Hebrew Letter Dalet With Dagesh\""
+                         "}");
+
+        /* nested objects are sorted independently of their parents */
+        assert_canonical("{\"b\":{\"y\":1,\"x\":2},\"a\":[{\"d\":1,\"c\":2}]}",
+                         "{\"a\":[{\"c\":2,\"d\":1}],\"b\":{\"x\":2,\"y\":1}}");
+        assert_canonical("{\"a\":{\"y\":1,\"x\":2},\"b\":0}",
+                         "{\"a\":{\"x\":2,\"y\":1},\"b\":0}");
+        assert_canonical("{\"ab\":1,\"a\":2,\"\":3}", "{\"\":3,\"a\":2,\"ab\":1}");
+        assert_canonical("{\"\":1,\"b\":2,\"a\":3}", "{\"\":1,\"a\":3,\"b\":2}");
+
+        /* sorted and unsorted objects side by side, in and out of sorted parents */
+        assert_canonical("[{\"b\":1,\"a\":{\"x\":[{\"d\":0,\"c\":0}],\"y\":\"}\"}},{\"a\":{\"c\":1,\"b\":{\"e\":0}}},{}]",
+                         "[{\"a\":{\"x\":[{\"c\":0,\"d\":0}],\"y\":\"}\"},\"b\":1},{\"a\":{\"b\":{\"e\":0},\"c\":1}},{}]");
+        assert_canonical("{\"a\":{\"a\":{\"a\":{\"b\":1,\"a\":2}}},\"b\":{\"b\":0,\"a\":0}}",
+                         "{\"a\":{\"a\":{\"a\":{\"a\":2,\"b\":1}}},\"b\":{\"a\":0,\"b\":0}}");
+
+        assert(canonicalize("{\"a\":1,\"a\":2}", &output) == C_JSON_E_INVALID_JSON);
+        output = c_free(output);
+        assert(canonicalize("{\"\":1,\"\":2}", &output) == C_JSON_E_INVALID_JSON);
+        output = c_free(output);
+        assert(canonicalize("{\"b\":1,\"a\":2,\"\\u0062\":3}", &output) == C_JSON_E_INVALID_JSON);
+        output = c_free(output);
+        assert(canonicalize("{\"b\":1,\"a\":[}", &output) == C_JSON_E_INVALID_JSON);
+        output = c_free(output);
+        assert(canonicalize("1e400", &output) == -ERANGE);
+}
+
+static void test_hash(void) {
+        static const uint8_t expected[C_JSON_HASH_SIZE] = {
+                0x1c, 0xc6, 0x9c, 0x7f, 0xa2, 0x36, 0x16, 0xca, 0x2e, 0xc3, 0xee, 0x70, 0xd2, 0x43, 0x90, 0xa6,
+                0x22, 0x5c, 0x88, 0x32, 0xdb, 0x8a, 0x4c, 0x81, 0x4c, 0x7e, 0x0e, 0x7f, 0x94, 0x2f, 0x86, 0x68,
+        };
+        static const char *inputs[] = {
+                "{\"a\":1,\"b\":[true,null]}",
+                " { \"b\" : [ true , null ] , \"a\" : 1.0 } ",
+                "{\"\\u0062\":[true,null],\"a\":10e-1}",
+        };
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        uint8_t digest[C_JSON_HASH_SIZE];
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        for (size_t i = 0; i < C_ARRAY_SIZE(inputs); i += 1) {
+                c_json_reader_begin_read(reader, inputs[i]);
+                assert(!c_json_canonical_hash(reader, digest));
+                assert(!c_json_reader_end_read(reader));
+                assert(!memcmp(digest, expected, sizeof(digest)));
+        }
+}
+
+static void test_long(void) {
+        _c_cleanup_(c_freep) char *input = NULL, *output = NULL, *expected = NULL;
+        size_t n = 3 * C_JSON_CHUNK_MAX;
+
+        /* long strings are passed on in chunks, in and out of sorted objects */
+        input = malloc(n + 32);
+        expected = malloc(n + 32);
+        assert(input && expected);
+
+        memcpy(input, "{\"b\":\"", 6);
+        memset(input + 6, 'x', n);
+        strcpy(input + 6 + n, "\\n\",\"a\":0}");
+
+        strcpy(expected, "{\"a\":0,\"b\":\"");
+        memset(expected + 12, 'x', n);
+        strcpy(expected + 12 + n, "\\n\"}");
+
+        assert(!canonicalize(input, &output));
+        assert(!strcmp(output, expected));
+}
+
+static void test_deep(void) {
+        _c_cleanup_(c_freep) char *input = NULL, *output = NULL;
+        size_t n;
+
+        /* nested objects are scanned once, also beyond the maximum depth */
+        for (size_t depth = 255; depth <= 300; depth += 45) {
+                input = malloc(depth * 12 + 2);
+                assert(input);
+
+                n = 0;
+                for (size_t i = 0; i < depth; i += 1, n += 11)
+                        memcpy(input + n, "{\"b\":0,\"a\":", 11);
+                input[n++] = '0';
+                for (size_t i = 0; i < depth; i += 1)
+                        input[n++] = '}';
+                input[n] = 0;
+
+                if (depth < 256) {
+                        assert(!canonicalize(input, &output));
+                        assert(strlen(output) == n);
+                        assert(!strncmp(output, "{\"a\":{\"a\":", 10));
+                } else {
+                        assert(canonicalize(input, &output) == C_JSON_E_DEPTH_OVERFLOW);
+                }
+
+                input = c_free(input);
+                output = c_free(output);
+        }
+}
+
+int main(int argc, char **argv) {
+        test_values();
+        test_numbers();
+        test_locale();
+        test_sorting();
+        test_hash();
+        test_long();
+        test_deep();
+        return 0;
+}
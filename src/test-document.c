@@ -0,0 +1,138 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <string.h>
+#include "c-json.h"
+
+static void assert_number(CJsonDocument *document, size_t value, const char *expected) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        const char *number;
+        size_t n_number;
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        c_json_document_begin_read(document, reader, value);
+        assert(!c_json_reader_read_number(reader, &number, &n_number));
+        assert(!c_json_document_end_read(document, reader));
+
+        assert(n_number == strlen(expected) && !memcmp(number, expected, n_number));
+}
+
+static void test_small(void) {
+        _c_cleanup_(c_json_document_freep) CJsonDocument *document = NULL;
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *string = NULL;
+        size_t root, value, inner;
+
+        assert(!c_json_document_new(&document, " { \"a\": 1, \"b\": { \"c\": \"x\" }, \"d\\u00e4\": 2, \"a\": 3 } ", 256));
+        root = c_json_document_root(document);
+
+        assert(!c_json_document_lookup(document, root, "a", &value));
+        assert_number(document, value, "1");
+        assert(!c_json_document_lookup(document, root, "d\xc3\xa4", &value));
+        assert_number(document, value, "2");
+        assert(!c_json_document_lookup(document, root, "e", &value));
+        assert(value == C_JSON_DOCUMENT_NONE);
+
+        /* nested objects are looked up by their own offset */
+        assert(!c_json_document_lookup(document, root, "b", &value));
+        assert(!c_json_document_lookup(document, value, "c", &inner));
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_document_begin_read(document, reader, inner);
+        assert(!c_json_reader_read_string(reader, &string));
+        assert(!c_json_document_end_read(document, reader));
+        assert(!strcmp(string, "x"));
+
+        /* containers must be read completely */
+        c_json_document_begin_read(document, reader, value);
+        assert(!c_json_reader_enter_object(reader));
+        assert(c_json_document_end_read(document, reader) == C_JSON_E_INVALID_TYPE);
+
+        assert(c_json_document_lookup(document, inner, "c", &value) == C_JSON_E_INVALID_TYPE);
+}
+
+static void test_large(void) {
+        _c_cleanup_(c_json_document_freep) CJsonDocument *document = NULL;
+        _c_cleanup_(c_freep) char *input = NULL;
+        size_t n_input, root, value, n_keys = 10000;
+        char key[32], number[32];
+        FILE *stream;
+
+        stream = open_memstream(&input, &n_input);
+        assert(stream);
+        fputs("{ \"0\": { }", stream);
+        for (size_t i = 1; i < n_keys; i += 1)
+                fprintf(stream, ", \"k\\u0065y%zu\": %zu", i, i * 2);
+        fputs(", \"key1\": 0 }", stream);
+        fclose(stream);
+
+        assert(!c_json_document_new(&document, input, 256));
+        root = c_json_document_root(document);
+
+        /* the first lookup builds the index, duplicates resolve to the first */
+        for (size_t round = 0; round < 2; round += 1) {
+                for (size_t i = 1; i < n_keys; i += 1) {
+                        sprintf(key, "key%zu", i);
+                        sprintf(number, "%zu", i * 2);
+                        assert(!c_json_document_lookup(document, root, key, &value));
+                        assert_number(document, value, number);
+                }
+
+                assert(!c_json_document_lookup(document, root, "key", &value));
+                assert(value == C_JSON_DOCUMENT_NONE);
+                assert(!c_json_document_lookup(document, root, "k\\u0065y1", &value));
+                assert(value == C_JSON_DOCUMENT_NONE);
+        }
+
+        assert(!c_json_document_lookup(document, root, "0", &value));
+        assert(!c_json_document_lookup(document, value, "key1", &value));
+        assert(value == C_JSON_DOCUMENT_NONE);
+}
+
+static void test_boundary(void) {
+        char input[512], key[32], number[32];
+        size_t n, root, value;
+
+        /* objects with 16 members are searched linearly, with 17 they are indexed */
+        for (size_t n_keys = 15; n_keys <= 18; n_keys += 1) {
+                _c_cleanup_(c_json_document_freep) CJsonDocument *document = NULL;
+
+                n = sprintf(input, "{");
+                for (size_t i = 0; i < n_keys; i += 1)
+                        n += sprintf(input + n, "%s\"key%zu\": %zu", i ? ", " : "", i, i * 2);
+                n += sprintf(input + n, ", \"key0\": 1 }");
+
+                assert(!c_json_document_new(&document, input, 256));
+                root = c_json_document_root(document);
+
+                for (size_t round = 0; round < 2; round += 1) {
+                        assert(!c_json_document_lookup(document, root, "missing", &value));
+                        assert(value == C_JSON_DOCUMENT_NONE);
+
+                        for (size_t i = 0; i < n_keys; i += 1) {
+                                sprintf(key, "key%zu", i);
+                                sprintf(number, "%zu", i * 2);
+                                assert(!c_json_document_lookup(document, root, key, &value));
+                                assert_number(document, value, number);
+                        }
+                }
+        }
+}
+
+static void test_invalid(void) {
+        CJsonDocument *document = NULL;
+
+        assert(c_json_document_new(&document, "{ \"a\": 1 ", 256) == C_JSON_E_INVALID_JSON);
+        assert(c_json_document_new(&document, "[[[]]]", 2) == C_JSON_E_DEPTH_OVERFLOW);
+        assert(!document);
+}
+
+int main(int argc, char **argv) {
+        test_small();
+        test_large();
+        test_boundary();
+        test_invalid();
+        return 0;
+}
@@ -0,0 +1,119 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <string.h>
+#include "c-json.h"
+
+static void test_table(void) {
+        _c_cleanup_(c_json_intern_table_freep) CJsonInternTable *table = NULL;
+        size_t id;
+
+        assert(!c_json_intern_table_new(&table, 3));
+
+        assert(!c_json_intern_table_add(table, "foo", &id));
+        assert(id == 0);
+        assert(!c_json_intern_table_add(table, "bar", &id));
+        assert(id == 1);
+        assert(!c_json_intern_table_add(table, "foo", &id));
+        assert(id == 0);
+
+        assert(!strcmp(c_json_intern_table_get(table, 0), "foo"));
+        assert(!strcmp(c_json_intern_table_get(table, 1), "bar"));
+        assert(!c_json_intern_table_get(table, 2));
+
+        assert(!c_json_intern_table_add(table, "baz", &id));
+        assert(id == 2);
+        assert(c_json_intern_table_add(table, "qux", &id) == -ENOSPC);
+        assert(!c_json_intern_table_add(table, "baz", &id));
+        assert(id == 2);
+}
+
+static void test_reader(void) {
+        _c_cleanup_(c_json_intern_table_freep) CJsonInternTable *table = NULL;
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        const char *id_key = NULL, *key;
+        size_t id;
+
+        assert(!c_json_intern_table_new(&table, 1000));
+        assert(!c_json_reader_new(&reader, 256));
+
+        /* the same key in two documents yields the same pointer */
+        for (size_t i = 0; i < 2; i += 1) {
+                c_json_reader_begin_read(reader, "{ \"id\": 1, \"na\\u006de\": \"x\", \"\\\"\": null }");
+                assert(!c_json_reader_enter_object(reader));
+
+                assert(!c_json_reader_read_interned(reader, table, &key, &id));
+                assert(!strcmp(key, "id") && id == 0);
+                assert(!id_key || id_key == key);
+                id_key = key;
+                assert(!c_json_reader_skip(reader));
+
+                assert(!c_json_reader_read_interned(reader, table, &key, &id));
+                assert(!strcmp(key, "name") && id == 1);
+                assert(!c_json_reader_skip(reader));
+
+                assert(!c_json_reader_read_interned(reader, table, &key, &id));
+                assert(!strcmp(key, "\"") && id == 2);
+                assert(!c_json_reader_read_null(reader));
+
+                assert(!c_json_reader_exit_object(reader));
+                assert(!c_json_reader_end_read(reader));
+        }
+
+        /* escaped and unescaped forms intern to the same entry */
+        c_json_reader_begin_read(reader, "[ \"\\u0069d\" ]");
+        assert(!c_json_reader_enter_array(reader));
+        assert(!c_json_reader_read_interned(reader, table, &key, &id));
+        assert(key == id_key && id == 0);
+        assert(!c_json_reader_exit_array(reader));
+        assert(!c_json_reader_end_read(reader));
+
+        c_json_reader_begin_read(reader, "\"\\ud800\"");
+        assert(c_json_reader_read_interned(reader, table, &key, &id) == C_JSON_E_INVALID_JSON);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_JSON);
+
+        c_json_reader_begin_read(reader, "42");
+        assert(c_json_reader_read_interned(reader, table, &key, &id) == C_JSON_E_INVALID_TYPE);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_TYPE);
+}
+
+static void test_frozen(void) {
+        _c_cleanup_(c_json_intern_table_freep) CJsonInternTable *table = NULL;
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *string = NULL;
+        const char *key;
+        size_t id;
+
+        assert(!c_json_intern_table_new(&table, 1000));
+        assert(!c_json_intern_table_add(table, "known", NULL));
+        c_json_intern_table_freeze(table);
+        assert(c_json_intern_table_add(table, "unknown", NULL) == -ENOSPC);
+
+        /* unknown keys are charged against the limits only once */
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_set_limits(reader, &(CJsonLimits){ .max_strings = 12 });
+        c_json_reader_begin_read(reader, "{ \"known\": 1, \"unknown\": 2 }");
+        assert(!c_json_reader_enter_object(reader));
+
+        assert(!c_json_reader_read_interned(reader, table, &key, &id));
+        assert(!strcmp(key, "known") && id == 0);
+        assert(!c_json_reader_skip(reader));
+
+        /* unknown keys are left for the caller to read */
+        assert(!c_json_reader_read_interned(reader, table, &key, &id));
+        assert(!key && id == C_JSON_INTERN_NONE);
+        assert(!c_json_reader_read_string(reader, &string));
+        assert(!strcmp(string, "unknown"));
+        assert(!c_json_reader_skip(reader));
+
+        assert(!c_json_reader_exit_object(reader));
+        assert(!c_json_reader_end_read(reader));
+}
+
+int main(int argc, char **argv) {
+        test_table();
+        test_reader();
+        test_frozen();
+        return 0;
+}
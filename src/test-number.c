@@ -0,0 +1,164 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+
+static uint64_t random_next(uint64_t *state) {
+        /* xorshift64*, deterministic so failures can be reproduced */
+        *state ^= *state >> 12;
+        *state ^= *state << 25;
+        *state ^= *state >> 27;
+        return *state * UINT64_C(2685821657736338717);
+}
+
+static size_t count_digits(const char *number) {
+        const char *first = NULL, *last = NULL;
+
+        for (const char *p = number; *p && *p != 'e'; p += 1) {
+                if (*p < '1' || *p > '9')
+                        continue;
+                if (!first)
+                        first = p;
+                last = p;
+        }
+
+        if (!first)
+                return 1;
+
+        return last - first + 1 - (memchr(first, '.', last - first) ? 1 : 0);
+}
+
+static size_t shortest_digits(double value) {
+        char buffer[64];
+
+        for (int precision = 1; precision <= 17; precision += 1) {
+                snprintf(buffer, sizeof(buffer), "%.*e", precision - 1, value);
+                if (strtod(buffer, NULL) == value)
+                        return count_digits(buffer);
+        }
+
+        assert(0);
+        return 0;
+}
+
+static void assert_roundtrip(double value) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        char buffer[C_JSON_NUMBER_MAX];
+        const char *number;
+        size_t n, n_number;
+        double parsed;
+
+        n = c_json_format_double(buffer, value);
+        assert(n > 0 && n < C_JSON_NUMBER_MAX);
+        assert(n == strlen(buffer));
+
+        parsed = strtod(buffer, NULL);
+        assert(!memcmp(&parsed, &value, sizeof(value)));
+        assert(count_digits(buffer) == shortest_digits(value));
+
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_begin_read(reader, buffer);
+        assert(!c_json_reader_read_number(reader, &number, &n_number));
+        assert(n_number == n);
+        assert(!c_json_reader_end_read(reader));
+}
+
+static void assert_format(double value, const char *expected) {
+        char buffer[C_JSON_NUMBER_MAX];
+
+        assert(c_json_format_double(buffer, value) == strlen(expected));
+        assert(!strcmp(buffer, expected));
+        assert_roundtrip(value);
+}
+
+static void test_integers(void) {
+        static const int64_t values[] = {
+                0, 1, -1, 9, 10, 99, 100, 101, 12345, -12345,
+                INT64_C(1000000000000), INT64_MAX, INT64_MIN,
+        };
+        char buffer[C_JSON_NUMBER_MAX], expected[64];
+        uint64_t state = 0x9e3779b97f4a7c15;
+
+        for (size_t i = 0; i < C_ARRAY_SIZE(values); i += 1) {
+                snprintf(expected, sizeof(expected), "%" PRId64, values[i]);
+                assert(c_json_format_int64(buffer, values[i]) == strlen(expected));
+                assert(!strcmp(buffer, expected));
+        }
+
+        assert(c_json_format_uint64(buffer, UINT64_MAX) == 20);
+        assert(!strcmp(buffer, "18446744073709551615"));
+
+        for (size_t i = 0; i < 100000; i += 1) {
+                uint64_t u = random_next(&state) >> (i % 64);
+
+                snprintf(expected, sizeof(expected), "%" PRIu64, u);
+                assert(c_json_format_uint64(buffer, u) == strlen(expected));
+                assert(!strcmp(buffer, expected));
+
+                snprintf(expected, sizeof(expected), "%" PRId64, (int64_t)u);
+                assert(c_json_format_int64(buffer, (int64_t)u) == strlen(expected));
+                assert(!strcmp(buffer, expected));
+        }
+}
+
+static void test_doubles(void) {
+        char buffer[C_JSON_NUMBER_MAX];
+
+        assert_format(0.0, "0");
+        assert_format(-0.0, "-0");
+        assert_format(1.0, "1");
+        assert_format(-1.5, "-1.5");
+        assert_format(0.1, "0.1");
+        assert_format(0.3, "0.3");
+        assert_format(100.0, "100");
+        assert_format(123456789012345680000.0, "123456789012345680000");
+        assert_format(1e21, "1e+21");
+        assert_format(1e-6, "0.000001");
+        assert_format(1e-7, "1e-7");
+        assert_format(1.5e-7, "1.5e-7");
+        assert_format(5e-324, "5e-324");
+        assert_format(DBL_MAX, "1.7976931348623157e+308");
+        assert_format(DBL_MIN, "2.2250738585072014e-308");
+        assert_format(9007199254740993.0, "9007199254740992");
+
+        assert(c_json_format_double(buffer, NAN) == 0);
+        assert(c_json_format_double(buffer, INFINITY) == 0);
+        assert(c_json_format_double(buffer, -INFINITY) == 0);
+}
+
+static void test_random_doubles(void) {
+        uint64_t state = 0x2545f4914f6cdd1d;
+        size_t n_tested = 0;
+
+        while (n_tested < 200000) {
+                uint64_t bits = random_next(&state);
+                double value;
+
+                memcpy(&value, &bits, sizeof(value));
+                if (!isfinite(value))
+                        continue;
+
+                assert_roundtrip(value);
+                n_tested += 1;
+        }
+
+        /* integers and short decimals take the rare, exact paths */
+        for (int64_t i = -1000; i <= 1000; i += 1) {
+                assert_roundtrip((double)i);
+                assert_roundtrip((double)i / 1000);
+                assert_roundtrip((double)i * 1e17);
+        }
+}
+
+int main(int argc, char **argv) {
+        test_integers();
+        test_doubles();
+        test_random_doubles();
+        return 0;
+}
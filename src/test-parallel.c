@@ -0,0 +1,165 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+
+#define N_ELEMENTS (50 * 1000)
+
+typedef struct Results {
+        size_t n_results;
+        size_t next;
+        bool ordered;
+        bool *seen;
+        size_t fail_at;
+} Results;
+
+static char * build_array(size_t n_elements) {
+        _c_cleanup_(c_fclosep) FILE *stream = NULL;
+        char *array = NULL;
+        size_t n_array;
+
+        stream = open_memstream(&array, &n_array);
+        assert(stream);
+
+        /* strings with brackets, commas and escaped quotes must not confuse the pre-scan */
+        fputs(" [", stream);
+        for (size_t i = 0; i < n_elements; i += 1)
+                fprintf(stream,
+                        "%s\n  { \"id\": %zu, \"s\": \"],}{[\\\\\\\",\", \"a\": [ %zu, {} ] }",
+                        i ? "," : "", i, i);
+        fputs("\n] ", stream);
+
+        stream = c_fclose(stream);
+        return array;
+}
+
+static int element_fn(void *userdata, CJsonReader *reader, size_t index, void **resultp) {
+        Results *results = userdata;
+        _c_cleanup_(c_freep) char *key = NULL, *string = NULL;
+        const char *number;
+        size_t n_number;
+        int r;
+
+        if (index == results->fail_at)
+                return -EPIPE;
+
+        assert(!c_json_reader_enter_object(reader));
+        assert(!c_json_reader_read_string(reader, &key));
+        assert(!strcmp(key, "id"));
+        assert(!c_json_reader_read_number(reader, &number, &n_number));
+        assert(strtoull(number, NULL, 10) == index);
+
+        assert(!c_json_reader_read_string(reader, NULL));
+        assert(!c_json_reader_read_string(reader, &string));
+        assert(!strcmp(string, "],}{[\\\","));
+        assert(!c_json_reader_read_string(reader, NULL));
+
+        r = c_json_reader_skip(reader);
+        if (r)
+                return r;
+
+        assert(!c_json_reader_exit_object(reader));
+
+        *resultp = (void *)(uintptr_t)(index + 1);
+        return 0;
+}
+
+static int result_fn(void *userdata, size_t index, void *result) {
+        Results *results = userdata;
+
+        assert((uintptr_t)result == index + 1);
+        assert(!results->seen[index]);
+        results->seen[index] = true;
+
+        if (results->ordered)
+                assert(index >= results->next);
+        results->next = index + 1;
+        results->n_results += 1;
+
+        return 0;
+}
+
+static void test_array(void) {
+        _c_cleanup_(c_freep) char *array = NULL;
+        _c_cleanup_(c_freep) bool *seen = NULL;
+        Results results = {};
+
+        array = build_array(N_ELEMENTS);
+        seen = calloc(N_ELEMENTS, sizeof(*seen));
+        assert(seen);
+
+        for (size_t n_threads = 0; n_threads <= 8; n_threads += 4) {
+                results = (Results){ .ordered = true, .seen = seen, .fail_at = SIZE_MAX };
+                memset(seen, 0, N_ELEMENTS * sizeof(*seen));
+                assert(!c_json_read_array_parallel(array, 4, n_threads, 0, element_fn, result_fn, &results));
+                assert(results.n_results == N_ELEMENTS);
+
+                results = (Results){ .seen = seen, .fail_at = SIZE_MAX };
+                memset(seen, 0, N_ELEMENTS * sizeof(*seen));
+                assert(!c_json_read_array_parallel(array, 4, n_threads, C_JSON_PARALLEL_UNORDERED,
+                                                   element_fn, result_fn, &results));
+                assert(results.n_results == N_ELEMENTS);
+        }
+
+        /* a failing callback stops processing, earlier results are still delivered */
+        results = (Results){ .ordered = true, .seen = seen, .fail_at = N_ELEMENTS / 2 };
+        memset(seen, 0, N_ELEMENTS * sizeof(*seen));
+        assert(c_json_read_array_parallel(array, 4, 4, 0, element_fn, result_fn, &results) == -EPIPE);
+        assert(results.n_results < N_ELEMENTS);
+        assert(!seen[N_ELEMENTS / 2]);
+
+        /* the elements are nested one level deeper than the array */
+        results = (Results){ .ordered = true, .seen = seen, .fail_at = SIZE_MAX };
+        assert(c_json_read_array_parallel(array, 2, 4, 0, element_fn, result_fn, &results) == C_JSON_E_DEPTH_OVERFLOW);
+}
+
+static int skip_fn(void *userdata, CJsonReader *reader, size_t index, void **resultp) {
+        return c_json_reader_skip(reader);
+}
+
+static int count_fn(void *userdata, size_t index, void *result) {
+        size_t *n_results = userdata;
+
+        *n_results += 1;
+        return 0;
+}
+
+static void assert_parallel(const char *json, int expected_r, size_t expected_n_results) {
+        size_t n_results = 0;
+
+        assert(c_json_read_array_parallel(json, 256, 2, 0, skip_fn, count_fn, &n_results) == expected_r);
+        if (!expected_r)
+                assert(n_results == expected_n_results);
+}
+
+static void test_structure(void) {
+        assert_parallel("[]", 0, 0);
+        assert_parallel(" [ ] ", 0, 0);
+        assert_parallel("[1]", 0, 1);
+        assert_parallel("[ 1 , \"a\" , null, [], {} ]\n", 0, 5);
+        assert_parallel("[\"\\\\\"]", 0, 1);
+
+        assert_parallel("{}", C_JSON_E_INVALID_TYPE, 0);
+        assert_parallel("1", C_JSON_E_INVALID_TYPE, 0);
+        assert_parallel("", C_JSON_E_INVALID_TYPE, 0);
+        assert_parallel("[", C_JSON_E_INVALID_JSON, 0);
+        assert_parallel("[1", C_JSON_E_INVALID_JSON, 0);
+        assert_parallel("[1,]", C_JSON_E_INVALID_JSON, 0);
+        assert_parallel("[,1]", C_JSON_E_INVALID_JSON, 0);
+        assert_parallel("[1 2]", C_JSON_E_INVALID_JSON, 0);
+        assert_parallel("[1}", C_JSON_E_INVALID_JSON, 0);
+        assert_parallel("[[1}]", C_JSON_E_INVALID_JSON, 0);
+        assert_parallel("[\"a]", C_JSON_E_INVALID_JSON, 0);
+        assert_parallel("[1] x", C_JSON_E_INVALID_JSON, 0);
+        assert_parallel("[tru]", C_JSON_E_INVALID_JSON, 0);
+}
+
+int main(int argc, char **argv) {
+        test_array();
+        test_structure();
+        return 0;
+}
@@ -0,0 +1,283 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <string.h>
+#include "c-json.h"
+
+typedef struct Events {
+        char buffer[1024];
+        size_t n_buffer;
+        size_t n_events;
+        size_t stop;
+} Events;
+
+static int add(void *userdata, const char *format, ...) {
+        Events *events = userdata;
+        va_list args;
+
+        va_start(args, format);
+        events->n_buffer += vsnprintf(events->buffer + events->n_buffer,
+                                      sizeof(events->buffer) - events->n_buffer,
+                                      format, args);
+        va_end(args);
+
+        assert(events->n_buffer < sizeof(events->buffer));
+
+        return ++events->n_events == events->stop ? 42 : 0;
+}
+
+static int begin_object(void *userdata) {
+        return add(userdata, "{");
+}
+
+static int end_object(void *userdata) {
+        return add(userdata, "}");
+}
+
+static int begin_array(void *userdata) {
+        return add(userdata, "[");
+}
+
+static int end_array(void *userdata) {
+        return add(userdata, "]");
+}
+
+static int key(void *userdata, const CJsonString *key) {
+        _c_cleanup_(c_freep) char *string = NULL;
+
+        assert(!c_json_string_dup(key, &string));
+        return add(userdata, "k:%s ", string);
+}
+
+static int string(void *userdata, const CJsonString *string) {
+        return add(userdata, "s:%.*s%s ", (int)string->n_raw, string->raw, string->escaped ? "*" : "");
+}
+
+static int number(void *userdata, const char *number, size_t n_number) {
+        return add(userdata, "n:%.*s ", (int)n_number, number);
+}
+
+static int boolean(void *userdata, bool b) {
+        return add(userdata, "b:%d ", b);
+}
+
+static int null(void *userdata) {
+        return add(userdata, "null ");
+}
+
+static const CJsonHandler handler = {
+        .begin_object = begin_object,
+        .end_object = end_object,
+        .begin_array = begin_array,
+        .end_array = end_array,
+        .key = key,
+        .string = string,
+        .number = number,
+        .boolean = boolean,
+        .null = null,
+};
+
+static int parse(const char *input, size_t max_depth, size_t stop, char **eventsp) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        Events events = { .stop = stop };
+        int r;
+
+        assert(!c_json_reader_new(&reader, max_depth));
+
+        c_json_reader_begin_read(reader, input);
+        r = c_json_reader_parse(reader, &handler, &events);
+
+        /* trailing garbage is only noticed by c_json_reader_end_read() */
+        if (r)
+                assert(c_json_reader_end_read(reader) == r);
+        else
+                r = c_json_reader_end_read(reader);
+
+        if (eventsp) {
+                *eventsp = strdup(events.buffer);
+                assert(*eventsp);
+        }
+
+        return r;
+}
+
+static void test_events(void) {
+        char *events;
+
+        assert(!parse("null", 256, 0, &events));
+        assert(!strcmp(events, "null "));
+        free(events);
+
+        assert(!parse(" [ ] ", 256, 0, &events));
+        assert(!strcmp(events, "[]"));
+        free(events);
+
+        assert(!parse("{\"a\": [1, -2.5e3, true, false, null, {}], \"b\\u00e4\": \"x\\ny\", \"c\": \"z\"}", 256, 0, &events));
+        assert(!strcmp(events, "{k:a [n:1 n:-2.5e3 b:1 b:0 null {}]k:b\xc3\xa4 s:x\\ny* k:c s:z }"));
+        free(events);
+
+        assert(!parse("[[[[1]],[2]],3]", 256, 0, &events));
+        assert(!strcmp(events, "[[[[n:1 ]][n:2 ]]n:3 ]"));
+        free(events);
+}
+
+static void test_whitespace(void) {
+        static const char *tokens[] = { "{", "\"a\"", ":", "[", "1", ",", "2", "]", "}" };
+        static const char *space = " \t\r\n";
+        char input[512], *events;
+        size_t n;
+
+        /* runs of whitespace of every length and mix around every token */
+        for (size_t n_space = 0; n_space < 40; n_space += 1) {
+                n = 0;
+                for (size_t i = 0; i < C_ARRAY_SIZE(tokens); i += 1) {
+                        memcpy(input + n, tokens[i], strlen(tokens[i]));
+                        n += strlen(tokens[i]);
+                        for (size_t j = 0; j < n_space; j += 1)
+                                input[n++] = space[(i + j) % 4];
+                }
+                input[n] = 0;
+
+                assert(!parse(input, 256, 0, &events));
+                assert(!strcmp(events, "{k:a [n:1 n:2 ]}"));
+                free(events);
+
+                /* a stray byte ends the trailing run at every position */
+                input[n - 1 - n_space / 2] = 'x';
+                assert(parse(input, 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        }
+}
+
+static void test_nested(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        Events events = {};
+        CJsonHandler numbers = { .number = number };
+        bool b;
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        /* values inside of containers can be parsed one by one */
+        c_json_reader_begin_read(reader, "{\"a\": [1, [2, 3], 4], \"b\": true}");
+        assert(!c_json_reader_enter_object(reader));
+        assert(c_json_reader_parse(reader, &handler, &events) == C_JSON_E_INVALID_TYPE);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_TYPE);
+
+        c_json_reader_begin_read(reader, "{\"a\": [1, [2, 3], 4], \"b\": true}");
+        assert(!c_json_reader_enter_object(reader));
+        assert(!c_json_reader_read_string(reader, NULL));
+        assert(!c_json_reader_enter_array(reader));
+        while (c_json_reader_more(reader))
+                assert(!c_json_reader_parse(reader, &numbers, &events));
+        assert(!c_json_reader_exit_array(reader));
+        assert(!c_json_reader_read_string(reader, NULL));
+        assert(!c_json_reader_read_bool(reader, &b));
+        assert(b);
+        assert(!c_json_reader_exit_object(reader));
+        assert(!c_json_reader_end_read(reader));
+
+        assert(!strcmp(events.buffer, "n:1 n:2 n:3 n:4 "));
+}
+
+static void test_errors(void) {
+        char *events;
+
+        assert(parse("", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        assert(parse("nul", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        assert(parse("truex", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        assert(parse("01", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        assert(parse("\"\xc3\"", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        assert(parse("[1,]", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        assert(parse("[1 2]", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        assert(parse("[1}", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        assert(parse("{\"a\"}", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        assert(parse("{\"a\":1,}", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        assert(parse("{1:1}", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+        assert(parse("[1] 2", 256, 0, NULL) == C_JSON_E_INVALID_JSON);
+
+        assert(!parse("[[]]", 2, 0, NULL));
+        assert(parse("[[[]]]", 2, 0, NULL) == C_JSON_E_DEPTH_OVERFLOW);
+        assert(parse("[{\"a\":{}}]", 2, 0, NULL) == C_JSON_E_DEPTH_OVERFLOW);
+
+        /* callbacks can stop parsing early */
+        assert(parse("[1, 2, 3]", 256, 3, &events) == 42);
+        assert(!strcmp(events, "[n:1 n:2 "));
+        free(events);
+}
+
+static void test_limits(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        Events events = {};
+
+        /* values beyond the limit are rejected before they are reported */
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_set_limits(reader, &(CJsonLimits){ .max_values = 3 });
+        c_json_reader_begin_read(reader, "[\"a\", {\"b\": \"c\"}]");
+        assert(c_json_reader_parse(reader, &handler, &events) == C_JSON_E_TOO_MANY_VALUES);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_TOO_MANY_VALUES);
+        assert(!strcmp(events.buffer, "[s:a {"));
+}
+
+static void test_budget(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        static const char *input = "{\"a\": [1, 2, [3, 4], {\"b\": 5}], \"c\": \"d\", \"e\": [[[]]]}";
+        char *expected;
+        Events events = {};
+        size_t n_yields = 0;
+        int r;
+
+        assert(!parse(input, 256, 0, &expected));
+
+        /* every budget produces the same events, only in more slices */
+        assert(!c_json_reader_new(&reader, 256));
+        for (size_t budget = 1; budget <= strlen(input); budget += 1) {
+                events = (Events){};
+                n_yields = 0;
+
+                c_json_reader_set_budget(reader, budget);
+                c_json_reader_begin_read(reader, input);
+                while ((r = c_json_reader_parse(reader, &handler, &events)) == C_JSON_E_YIELD)
+                        n_yields += 1;
+                assert(!r);
+                assert(!c_json_reader_end_read(reader));
+
+                assert(!strcmp(events.buffer, expected));
+                assert(budget > 1 || n_yields > 10);
+        }
+
+        free(expected);
+
+        /* values nested in containers the reader entered resume too */
+        events = (Events){};
+        c_json_reader_set_budget(reader, 1);
+        c_json_reader_begin_read(reader, "[[1, 2], 3]");
+        assert(!c_json_reader_enter_array(reader));
+        while ((r = c_json_reader_parse(reader, &handler, &events)) == C_JSON_E_YIELD)
+                ;
+        assert(!r);
+        assert(!c_json_reader_parse(reader, &handler, &events));
+        assert(!c_json_reader_exit_array(reader));
+        assert(!c_json_reader_end_read(reader));
+        assert(!strcmp(events.buffer, "[n:1 n:2 ]n:3 "));
+
+        /* reading can be abandoned while suspended */
+        c_json_reader_begin_read(reader, "[1, 2, 3]");
+        assert(c_json_reader_parse(reader, &handler, &events) == C_JSON_E_YIELD);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_TYPE);
+
+        c_json_reader_set_budget(reader, 0);
+        c_json_reader_begin_read(reader, "[1, 2, 3]");
+        assert(!c_json_reader_parse(reader, &handler, &events));
+        assert(!c_json_reader_end_read(reader));
+}
+
+int main(int argc, char **argv) {
+        test_events();
+        test_whitespace();
+        test_nested();
+        test_errors();
+        test_limits();
+        test_budget();
+        return 0;
+}
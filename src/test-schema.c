@@ -0,0 +1,215 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <locale.h>
+#include <stdio.h>
+#include <string.h>
+#include "c-json.h"
+
+static const char *schema_text =
+        "{"
+        "  \"$schema\": \"https://json-schema.org/draft/2020-12/schema\","
+        "  \"title\": \"user\","
+        "  \"type\": \"object\","
+        "  \"required\": [ \"id\", \"name\" ],"
+        "  \"properties\": {"
+        "    \"id\": { \"type\": \"integer\", \"minimum\": 1 },"
+        "    \"name\": { \"type\": \"string\", \"minLength\": 1, \"maxLength\": 4 },"
+        "    \"score\": { \"type\": \"number\", \"exclusiveMinimum\": 0, \"maximum\": 100 },"
+        "    \"role\": { \"enum\": [ \"admin\", \"user\", 7, { \"b\": 1, \"a\": [] } ] },"
+        "    \"tags\": {"
+        "      \"type\": \"array\", \"maxItems\": 2,"
+        "      \"items\": { \"type\": [ \"string\", \"null\" ] }"
+        "    },"
+        "    \"a/b~c\": { \"type\": \"object\", \"additionalProperties\": false },"
+        "    \"extra\": { \"type\": \"object\", \"additionalProperties\": { \"type\": \"boolean\" } }"
+        "  }"
+        "}";
+
+static int check(CJsonSchema *schema, const char *input, char **pointerp) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        int r;
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        c_json_reader_begin_read(reader, input);
+        r = c_json_schema_check(schema, reader, pointerp);
+        if (r) {
+                assert(c_json_reader_end_read(reader) == r);
+                return r;
+        }
+
+        return c_json_reader_end_read(reader);
+}
+
+static void assert_valid(CJsonSchema *schema, const char *input) {
+        assert(!check(schema, input, NULL));
+}
+
+static void assert_violation(CJsonSchema *schema, const char *input, const char *expected) {
+        _c_cleanup_(c_freep) char *pointer = NULL;
+        int r;
+
+        r = check(schema, input, &pointer);
+        if (r != C_JSON_E_SCHEMA_VIOLATION || strcmp(pointer, expected)) {
+                fprintf(stderr, "%s: expected violation at '%s', got %d at '%s'\n",
+                        input, expected, r, pointer ?: "");
+                assert(0);
+        }
+}
+
+static void test_keywords(void) {
+        _c_cleanup_(c_json_schema_freep) CJsonSchema *schema = NULL;
+
+        assert(!c_json_schema_new(&schema, schema_text));
+
+        assert_valid(schema, "{ \"id\": 1, \"name\": \"ab\" }");
+        assert_valid(schema, "{ \"name\": \"\xc3\xa4\xc3\xa4\xc3\xa4\xc3\xa4\", \"id\": 1e3, \"unknown\": [ 1, { } ] }");
+        assert_valid(schema, "{ \"id\": 2.0, \"name\": \"a\", \"score\": 100, \"role\": \"admin\" }");
+        assert_valid(schema, "{ \"id\": 2, \"name\": \"a\", \"role\": 7.0 }");
+        assert_valid(schema, "{ \"id\": 2, \"name\": \"a\", \"role\": { \"a\": [ ], \"b\": 1 } }");
+        assert_valid(schema, "{ \"id\": 2, \"name\": \"a\", \"tags\": [ \"x\", null ] }");
+        assert_valid(schema, "{ \"id\": 2, \"name\": \"a\", \"a/b~c\": { }, \"extra\": { \"x\": true } }");
+
+        assert_violation(schema, "[]", "");
+        assert_violation(schema, "{ \"id\": 1 }", "");
+        assert_violation(schema, "{ \"id\": 0, \"name\": \"a\" }", "/id");
+        assert_violation(schema, "{ \"id\": 1.5, \"name\": \"a\" }", "/id");
+        assert_violation(schema, "{ \"id\": 1, \"name\": \"\" }", "/name");
+        assert_violation(schema, "{ \"id\": 1, \"name\": \"abcde\" }", "/name");
+        assert_violation(schema, "{ \"id\": 1, \"name\": \"a\", \"score\": 0 }", "/score");
+        assert_violation(schema, "{ \"id\": 1, \"name\": \"a\", \"score\": 100.5 }", "/score");
+        assert_violation(schema, "{ \"id\": 1, \"name\": \"a\", \"role\": \"root\" }", "/role");
+        assert_violation(schema, "{ \"id\": 1, \"name\": \"a\", \"tags\": [ \"x\", 1 ] }", "/tags/1");
+        assert_violation(schema, "{ \"id\": 1, \"name\": \"a\", \"tags\": [ \"x\", \"y\", \"z\" ] }", "/tags");
+        assert_violation(schema, "{ \"id\": 1, \"name\": \"a\", \"a/b~c\": { \"x\": 1 } }", "/a~1b~0c/x");
+        assert_violation(schema, "{ \"id\": 1, \"name\": \"a\", \"extra\": { \"x/\": 1 } }", "/extra/x~1");
+        assert_violation(schema, "{ \"id\": 1, \"n\\u0061me\": 1 }", "/name");
+}
+
+static void test_early(void) {
+        _c_cleanup_(c_json_schema_freep) CJsonSchema *schema = NULL;
+        _c_cleanup_(c_freep) char *pointer = NULL;
+
+        assert(!c_json_schema_new(&schema, "{ \"items\": { \"type\": \"integer\" } }"));
+
+        /* reading stops at the violation, the malformed rest is never looked at */
+        assert(check(schema, "[ 1, 2, \"x\", ] ] garbage", &pointer) == C_JSON_E_SCHEMA_VIOLATION);
+        assert(!strcmp(pointer, "/2"));
+
+        pointer = c_free(pointer);
+        assert(check(schema, "[ 1, 2,, \"x\" ]", &pointer) == C_JSON_E_INVALID_JSON);
+        assert(!pointer);
+}
+
+static void test_bounds(void) {
+        static const char *schemas[] = {
+                "{ \"exclusiveMinimum\": 10, \"minimum\": 0, \"maximum\": 20, \"exclusiveMaximum\": 15 }",
+                "{ \"minimum\": 0, \"exclusiveMinimum\": 10, \"exclusiveMaximum\": 15, \"maximum\": 20 }",
+        };
+
+        /* inclusive and exclusive bounds both apply, in any order */
+        for (size_t i = 0; i < C_ARRAY_SIZE(schemas); i += 1) {
+                _c_cleanup_(c_json_schema_freep) CJsonSchema *schema = NULL;
+
+                assert(!c_json_schema_new(&schema, schemas[i]));
+                assert_valid(schema, "10.5");
+                assert_valid(schema, "14");
+                assert_violation(schema, "5", "");
+                assert_violation(schema, "10", "");
+                assert_violation(schema, "15", "");
+                assert_violation(schema, "18", "");
+        }
+}
+
+static void test_locale(void) {
+        _c_cleanup_(c_json_schema_freep) CJsonSchema *schema = NULL;
+
+        /* fractions are parsed the same in locales with a decimal comma */
+        if (!setlocale(LC_NUMERIC, "de_DE.UTF-8") && !setlocale(LC_NUMERIC, "fr_FR.UTF-8"))
+                return;
+
+        assert(!c_json_schema_new(&schema, "{ \"minimum\": 0.5, \"exclusiveMaximum\": 1.5 }"));
+        assert_valid(schema, "0.75");
+        assert_violation(schema, "0.25", "");
+        assert_violation(schema, "1.5", "");
+        schema = c_json_schema_free(schema);
+
+        assert(!c_json_schema_new(&schema, "{ \"type\": \"integer\" }"));
+        assert_valid(schema, "2.0");
+        assert_violation(schema, "2.5", "");
+
+        setlocale(LC_NUMERIC, "C");
+}
+
+static void test_enums(void) {
+        _c_cleanup_(c_json_schema_freep) CJsonSchema *schema = NULL;
+
+        /* enum values that contradict the other keywords never match */
+        assert(!c_json_schema_new(&schema, "{ \"type\": \"string\", \"enum\": [ \"a\", 1, null ] }"));
+        assert_valid(schema, "\"a\"");
+        assert_violation(schema, "1", "");
+        assert_violation(schema, "null", "");
+        schema = c_json_schema_free(schema);
+
+        assert(!c_json_schema_new(&schema, "{ \"const\": { \"k\": [ 1, \"\\u00e4\" ] } }"));
+        assert_valid(schema, "{ \"k\" : [ 1.0, \"\xc3\xa4\" ] }");
+        assert_violation(schema, "{ \"k\" : [ 1, \"a\" ] }", "");
+        schema = c_json_schema_free(schema);
+
+        /* with both keywords, values have to satisfy both, in any order */
+        assert(!c_json_schema_new(&schema, "{ \"const\": 1, \"enum\": [ 1, 2 ] }"));
+        assert_valid(schema, "1");
+        assert_violation(schema, "2", "");
+        schema = c_json_schema_free(schema);
+
+        assert(!c_json_schema_new(&schema, "{ \"enum\": [ 1, 2 ], \"const\": 1 }"));
+        assert_valid(schema, "1");
+        assert_violation(schema, "2", "");
+        schema = c_json_schema_free(schema);
+
+        assert(!c_json_schema_new(&schema, "{ \"const\": 3, \"enum\": [ 1, 2 ] }"));
+        assert_violation(schema, "1", "");
+        assert_violation(schema, "3", "");
+}
+
+static void test_booleans(void) {
+        _c_cleanup_(c_json_schema_freep) CJsonSchema *schema = NULL;
+
+        assert(!c_json_schema_new(&schema, "true"));
+        assert_valid(schema, "[ { \"x\": null } ]");
+        schema = c_json_schema_free(schema);
+
+        assert(!c_json_schema_new(&schema, "false"));
+        assert_violation(schema, "null", "");
+        schema = c_json_schema_free(schema);
+
+        assert(!c_json_schema_new(&schema, "{ \"properties\": { \"x\": false } }"));
+        assert_valid(schema, "{ \"y\": 1 }");
+        assert_violation(schema, "{ \"y\": 1, \"x\": 1 }", "/x");
+}
+
+static void test_invalid(void) {
+        CJsonSchema *schema = NULL;
+
+        assert(c_json_schema_new(&schema, "{ \"type\": \"float\" }") == -EINVAL);
+        assert(c_json_schema_new(&schema, "{ \"minLength\": -1 }") == -EINVAL);
+        assert(c_json_schema_new(&schema, "{ \"maxItems\": 1.5 }") == -EINVAL);
+        assert(c_json_schema_new(&schema, "{ \"pattern\": \"^a\" }") == -EOPNOTSUPP);
+        assert(c_json_schema_new(&schema, "{ \"items\": [ true ] }") == -EOPNOTSUPP);
+        assert(c_json_schema_new(&schema, "1") == -EINVAL);
+        assert(c_json_schema_new(&schema, "{ \"type\": \"string\"") == C_JSON_E_INVALID_JSON);
+        assert(!schema);
+}
+
+int main(int argc, char **argv) {
+        test_keywords();
+        test_early();
+        test_bounds();
+        test_locale();
+        test_enums();
+        test_booleans();
+        test_invalid();
+        return 0;
+}
@@ -0,0 +1,326 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <string.h>
+#include "c-json.h"
+
+typedef struct Collect {
+        FILE *stream;
+        size_t n_chunks;
+        int fail_after;
+} Collect;
+
+static int collect_chunk(void *userdata, const char *chunk, size_t n_chunk) {
+        Collect *collect = userdata;
+
+        assert(n_chunk > 0 && n_chunk <= C_JSON_CHUNK_MAX);
+        assert(fwrite(chunk, 1, n_chunk, collect->stream) == n_chunk);
+
+        if (++collect->n_chunks == (size_t)collect->fail_after)
+                return -EPIPE;
+
+        return 0;
+}
+
+static char * build_string(size_t n, const char *unit) {
+        size_t n_unit = strlen(unit);
+        char *json, *p;
+
+        json = malloc(n * n_unit + 3);
+        assert(json);
+
+        p = json;
+        *p++ = '"';
+        for (size_t i = 0; i < n; i += 1) {
+                memcpy(p, unit, n_unit);
+                p += n_unit;
+        }
+        *p++ = '"';
+        *p = '\0';
+
+        return json;
+}
+
+static void assert_chunked(const char *json, const char *expected, size_t n_expected) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *output = NULL, *string = NULL;
+        Collect collect = {};
+        size_t n_output;
+
+        collect.stream = open_memstream(&output, &n_output);
+        assert(collect.stream);
+
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_begin_read(reader, json);
+        assert(!c_json_reader_read_string_chunked(reader, collect_chunk, &collect));
+        assert(!c_json_reader_end_read(reader));
+
+        c_fclose(collect.stream);
+        assert(n_output == n_expected);
+        assert(!memcmp(output, expected, n_expected));
+
+        /* the allocating variant must agree */
+        c_json_reader_begin_read(reader, json);
+        assert(!c_json_reader_read_string(reader, &string));
+        assert(!c_json_reader_end_read(reader));
+        assert(strlen(string) == n_expected);
+        assert(!memcmp(string, expected, n_expected));
+}
+
+static void test_chunked(void) {
+        _c_cleanup_(c_freep) char *json = NULL, *expected = NULL;
+        size_t n = 3 * C_JSON_CHUNK_MAX + 17;
+
+        assert_chunked("\"\"", "", 0);
+        assert_chunked("\"foo \\u00e4\\n\\ud834\\udd1e\"", "foo ä\n\xf0\x9d\x84\x9e", 11);
+
+        /* multi-byte sequences must never be split across chunks */
+        json = build_string(n, "\xe2\x82\xac");
+        expected = malloc(3 * n);
+        assert(expected);
+        for (size_t i = 0; i < n; i += 1)
+                memcpy(expected + 3 * i, "\xe2\x82\xac", 3);
+        assert_chunked(json, expected, 3 * n);
+        json = c_free(json);
+        expected = c_free(expected);
+
+        json = build_string(n, "\\\"");
+        expected = malloc(n);
+        assert(expected);
+        memset(expected, '"', n);
+        assert_chunked(json, expected, n);
+}
+
+static void test_chunked_errors(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *json = NULL, *output = NULL;
+        Collect collect = { .fail_after = 2 };
+        size_t n_output;
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        c_json_reader_begin_read(reader, "42");
+        assert(c_json_reader_read_string_chunked(reader, collect_chunk, &collect) == C_JSON_E_INVALID_TYPE);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_TYPE);
+
+        c_json_reader_begin_read(reader, "\"foo\\ud800\"");
+        assert(c_json_reader_read_string_chunked(reader, NULL, NULL) == C_JSON_E_INVALID_JSON);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_JSON);
+
+        collect.stream = open_memstream(&output, &n_output);
+        assert(collect.stream);
+
+        json = build_string(4 * C_JSON_CHUNK_MAX, "a");
+        c_json_reader_begin_read(reader, json);
+        assert(c_json_reader_read_string_chunked(reader, collect_chunk, &collect) == -EPIPE);
+        assert(collect.n_chunks == 2);
+        assert(c_json_reader_end_read(reader) == -EPIPE);
+
+        c_fclose(collect.stream);
+}
+
+static void assert_string(const char *json, int expected_r, const char *expected) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *string = NULL;
+
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_begin_read(reader, json);
+        assert(c_json_reader_read_string(reader, &string) == expected_r);
+        assert(c_json_reader_end_read(reader) == expected_r);
+
+        if (!expected_r)
+                assert(!strcmp(string, expected));
+}
+
+static void test_escapes(void) {
+        assert_string("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"", 0, "\"\\/\b\f\n\r\t");
+        assert_string("\"\\u0041\\u00e4\\u00E4\\u20AC\\uD834\\uDD1E\"", 0, "A\xc3\xa4\xc3\xa4\xe2\x82\xac\xf0\x9d\x84\x9e");
+        assert_string("\"a\\u0000b\"", 0, "a");
+
+        assert_string("\"\\a\"", C_JSON_E_INVALID_JSON, NULL);
+        assert_string("\"\\U0041\"", C_JSON_E_INVALID_JSON, NULL);
+        assert_string("\"\\u00g1\"", C_JSON_E_INVALID_JSON, NULL);
+        assert_string("\"\\u00", C_JSON_E_INVALID_JSON, NULL);
+        assert_string("\"\\", C_JSON_E_INVALID_JSON, NULL);
+        assert_string("\"abc", C_JSON_E_INVALID_JSON, NULL);
+        assert_string("\"\\uDD1E\"", C_JSON_E_INVALID_JSON, NULL);
+}
+
+static void test_utf8(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *string = NULL;
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        /* invalid sequences behind valid ones in the same string */
+        c_json_reader_begin_read(reader, "\"\xc3\xa4\xe2\x82\xac\xe2\x82\"");
+        assert(c_json_reader_read_string(reader, NULL) == C_JSON_E_INVALID_JSON);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_JSON);
+
+        c_json_reader_begin_read(reader, "\"\xf0\x9f\x98\x80\xed\xa0\x80\"");
+        assert(c_json_reader_read_string(reader, NULL) == C_JSON_E_INVALID_JSON);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_JSON);
+
+        /* invalid UTF-8 is only reported once it is read */
+        c_json_reader_begin_read(reader, "[ \"\xe2\x82\xac\", \"\xc0\xaf\" ]");
+        assert(!c_json_reader_enter_array(reader));
+        assert(!c_json_reader_read_string(reader, &string));
+        assert(!strcmp(string, "\xe2\x82\xac"));
+        assert(c_json_reader_read_string(reader, NULL) == C_JSON_E_INVALID_JSON);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_JSON);
+}
+
+static void assert_base64(const char *json, int expected_r, const char *expected, size_t n_expected) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *output = NULL;
+        Collect collect = {};
+        size_t n_output;
+
+        collect.stream = open_memstream(&output, &n_output);
+        assert(collect.stream);
+
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_begin_read(reader, json);
+        assert(c_json_reader_read_base64(reader, collect_chunk, &collect) == expected_r);
+        assert(c_json_reader_end_read(reader) == expected_r);
+
+        c_fclose(collect.stream);
+        if (!expected_r) {
+                assert(n_output == n_expected);
+                assert(!memcmp(output, expected, n_expected));
+        }
+}
+
+static void test_base64(void) {
+        _c_cleanup_(c_freep) char *json = NULL;
+        _c_cleanup_(c_freep) char *expected = NULL;
+        size_t n_groups = 5 * C_JSON_CHUNK_MAX / 3;
+
+        assert_base64("\"\"", 0, "", 0);
+        assert_base64("\"Zg==\"", 0, "f", 1);
+        assert_base64("\"Zm8=\"", 0, "fo", 2);
+        assert_base64("\"Zm9v\"", 0, "foo", 3);
+        assert_base64("\"Zm9vYg\"", 0, "foob", 4);
+        assert_base64("\"Zm9vYmE\"", 0, "fooba", 5);
+        assert_base64("\"Zm9vYmFy\"", 0, "foobar", 6);
+        assert_base64("\"Zm9v\\/\\/8=\"", 0, "foo\xff\xff", 5);
+        assert_base64("\"AAEC/w==\"", 0, "\x00\x01\x02\xff", 4);
+
+        assert_base64("\"Z\"", C_JSON_E_INVALID_TYPE, NULL, 0);
+        assert_base64("\"Zg=\"", C_JSON_E_INVALID_TYPE, NULL, 0);
+        assert_base64("\"Zg===\"", C_JSON_E_INVALID_TYPE, NULL, 0);
+        assert_base64("\"Zg==Zg==\"", C_JSON_E_INVALID_TYPE, NULL, 0);
+        assert_base64("\"Zm9v YmFy\"", C_JSON_E_INVALID_TYPE, NULL, 0);
+        assert_base64("\"Zm9v\\n\"", C_JSON_E_INVALID_TYPE, NULL, 0);
+        assert_base64("true", C_JSON_E_INVALID_TYPE, NULL, 0);
+        assert_base64("\"Zm9v", C_JSON_E_INVALID_JSON, NULL, 0);
+
+        /* "////" decodes to 0xff 0xff 0xff */
+        json = build_string(n_groups, "////");
+        expected = malloc(3 * n_groups);
+        assert(expected);
+        memset(expected, 0xff, 3 * n_groups);
+        assert_base64(json, 0, expected, 3 * n_groups);
+}
+
+static void test_lazy(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_freep) char *dup = NULL;
+        CJsonString plain, escaped, nul;
+        char buffer[8];
+        size_t n;
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        c_json_reader_begin_read(reader, "[ \"k\xc3\xa4y\", \"k\\u00e4\\u0079\", \"a\\u0000b\", 1 ]");
+        assert(!c_json_reader_enter_array(reader));
+        assert(!c_json_reader_read_string_lazy(reader, &plain));
+        assert(!c_json_reader_read_string_lazy(reader, &escaped));
+        assert(!c_json_reader_read_string_lazy(reader, &nul));
+        assert(c_json_reader_read_string_lazy(reader, &plain) == C_JSON_E_INVALID_TYPE);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_TYPE);
+
+        /* handles still refer to the input after reading has ended */
+        assert(!plain.escaped && escaped.escaped);
+        assert(c_json_string_length(&plain) == 4);
+        assert(c_json_string_length(&escaped) == 4);
+        assert(c_json_string_length(&nul) == 3);
+
+        assert(!c_json_string_compare(&plain, "k\xc3\xa4y"));
+        assert(!c_json_string_compare(&escaped, "k\xc3\xa4y"));
+        assert(c_json_string_compare(&escaped, "k\xc3\xa4") > 0);
+        assert(c_json_string_compare(&escaped, "k\xc3\xa4yy") < 0);
+        assert(c_json_string_compare(&escaped, "k\xc3\xa5") < 0);
+        assert(c_json_string_compare(&nul, "a") > 0);
+
+        assert(c_json_string_has_prefix(&escaped, ""));
+        assert(c_json_string_has_prefix(&escaped, "k\xc3"));
+        assert(c_json_string_has_prefix(&escaped, "k\xc3\xa4y"));
+        assert(!c_json_string_has_prefix(&escaped, "k\xc3\xa4yy"));
+        assert(!c_json_string_has_prefix(&escaped, "ky"));
+        assert(c_json_string_has_prefix(&nul, "a"));
+
+        assert(c_json_string_hash(&plain) == c_json_string_hash(&escaped));
+        assert(c_json_string_hash(&plain) != c_json_string_hash(&nul));
+
+        assert(!c_json_string_decode(&escaped, buffer, 5, &n));
+        assert(n == 4 && !strcmp(buffer, "k\xc3\xa4y"));
+        assert(c_json_string_decode(&escaped, buffer, 4, &n) == -ENOBUFS);
+        assert(!c_json_string_decode(&nul, buffer, sizeof(buffer), &n));
+        assert(n == 3 && !memcmp(buffer, "a\0b", 4));
+
+        assert(!c_json_string_dup(&escaped, &dup));
+        assert(!strcmp(dup, "k\xc3\xa4y"));
+
+        /* the string is validated when the handle is read */
+        c_json_reader_begin_read(reader, "\"a\\x\"");
+        assert(c_json_reader_read_string_lazy(reader, &plain) == C_JSON_E_INVALID_JSON);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_JSON);
+}
+
+static void test_in_place(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        char input[] = "{\"k\\u00e4y\": [\"plain\", \"\\\"\\n\\uD834\\uDD1E\xc3\xa4\", \"\"]}";
+        char invalid[] = "[\"a\", \"b\\x\"]";
+        char *key, *plain, *escaped, *empty;
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        c_json_reader_begin_read_mutable(reader, input);
+        assert(!c_json_reader_enter_object(reader));
+        assert(!c_json_reader_read_string_in_place(reader, &key));
+        assert(!c_json_reader_enter_array(reader));
+        assert(!c_json_reader_read_string_in_place(reader, &plain));
+        assert(!c_json_reader_read_string_in_place(reader, &escaped));
+        assert(!c_json_reader_read_string_in_place(reader, &empty));
+        assert(!c_json_reader_exit_array(reader));
+        assert(!c_json_reader_exit_object(reader));
+        assert(!c_json_reader_end_read(reader));
+
+        /* strings live in the input and stay valid after reading ended */
+        assert(key == input + 2);
+        assert(!strcmp(key, "k\xc3\xa4y"));
+        assert(!strcmp(plain, "plain"));
+        assert(!strcmp(escaped, "\"\n\xf0\x9d\x84\x9e\xc3\xa4"));
+        assert(!strcmp(empty, ""));
+
+        c_json_reader_begin_read_mutable(reader, invalid);
+        assert(!c_json_reader_enter_array(reader));
+        assert(!c_json_reader_read_string_in_place(reader, &plain));
+        assert(!strcmp(plain, "a"));
+        assert(c_json_reader_read_string_in_place(reader, &plain) == C_JSON_E_INVALID_JSON);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_JSON);
+}
+
+int main(int argc, char **argv) {
+        test_chunked();
+        test_chunked_errors();
+        test_escapes();
+        test_utf8();
+        test_base64();
+        test_lazy();
+        test_in_place();
+        return 0;
+}
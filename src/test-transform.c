@@ -0,0 +1,137 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+
+static void assert_transform(CJsonTransform *transform, const char *input, const char *expected) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        _c_cleanup_(c_fclosep) FILE *stream = NULL;
+        _c_cleanup_(c_freep) char *output = NULL;
+        size_t n_output;
+
+        stream = open_memstream(&output, &n_output);
+        assert(stream);
+
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_begin_read(reader, input);
+        assert(!c_json_transform_run(transform, reader, stream));
+        assert(!c_json_reader_end_read(reader));
+
+        stream = c_fclose(stream);
+        assert(!strcmp(output, expected));
+}
+
+static void test_skip(void) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        const char *number;
+
+        assert(!c_json_reader_new(&reader, 256));
+
+        c_json_reader_begin_read(reader, "[ { \"a\": [ 1, { \"b\": null } ], \"c\": \"d\" }, 42 ]");
+        assert(!c_json_reader_enter_array(reader));
+        assert(!c_json_reader_skip(reader));
+        assert(!c_json_reader_read_number(reader, &number, NULL));
+        assert(!strncmp(number, "42", 2));
+        assert(!c_json_reader_exit_array(reader));
+        assert(!c_json_reader_end_read(reader));
+
+        c_json_reader_begin_read(reader, "[ { \"a\": [ 1, } ]");
+        assert(c_json_reader_skip(reader) == C_JSON_E_INVALID_JSON);
+        assert(c_json_reader_end_read(reader) == C_JSON_E_INVALID_JSON);
+}
+
+static void test_drop(void) {
+        _c_cleanup_(c_json_transform_freep) CJsonTransform *transform = NULL;
+
+        assert(!c_json_transform_new(&transform));
+        assert(!c_json_transform_add(transform, "/password", C_JSON_TRANSFORM_DROP, NULL));
+        assert(!c_json_transform_add(transform, "/users/*/token", C_JSON_TRANSFORM_DROP, NULL));
+
+        assert_transform(transform,
+                         "{ \"user\": \"foo\", \"password\": \"bar\", \"age\": 42 }",
+                         "{ \"user\": \"foo\", \"age\": 42 }");
+        assert_transform(transform,
+                         "{ \"password\": \"bar\", \"user\": \"foo\" }",
+                         "{ \"user\": \"foo\" }");
+        assert_transform(transform,
+                         "{ \"user\": \"foo\", \"password\": \"bar\" }",
+                         "{ \"user\": \"foo\" }");
+        assert_transform(transform,
+                         "{\"password\":[1,2]}",
+                         "{}");
+        assert_transform(transform,
+                         "{ \"users\": [ { \"token\": 1, \"id\": 2 }, { \"id\": 3, \"token\": 4 } ],\n  \"x\": { \"password\": 5 } }\n",
+                         "{ \"users\": [ { \"id\": 2 }, { \"id\": 3 } ],\n  \"x\": { \"password\": 5 } }\n");
+}
+
+static void test_replace(void) {
+        _c_cleanup_(c_json_transform_freep) CJsonTransform *transform = NULL;
+
+        assert(!c_json_transform_new(&transform));
+        assert(c_json_transform_add(transform, "/a", C_JSON_TRANSFORM_REPLACE, "[1,") == C_JSON_E_INVALID_JSON);
+        assert(c_json_transform_add(transform, "a", C_JSON_TRANSFORM_REPLACE, "null") == -EINVAL);
+        assert(!c_json_transform_add(transform, "/a~1b", C_JSON_TRANSFORM_REPLACE, "\"***\""));
+        assert(!c_json_transform_add(transform, "/list/1", C_JSON_TRANSFORM_REPLACE, "null"));
+
+        assert_transform(transform,
+                         " { \"a/b\" : { \"secret\": true } , \"list\": [ 0, [ 1 ], 2 ] } ",
+                         " { \"a/b\" : \"***\" , \"list\": [ 0, null, 2 ] } ");
+        assert_transform(transform, "[ 1, 2 ]", "[ 1, 2 ]");
+}
+
+static char *nested_array(size_t depth) {
+        char *value;
+
+        value = malloc(2 * depth + 1);
+        assert(value);
+
+        memset(value, '[', depth);
+        memset(value + depth, ']', depth);
+        value[2 * depth] = 0;
+
+        return value;
+}
+
+static void test_replace_deep(void) {
+        _c_cleanup_(c_json_transform_freep) CJsonTransform *transform = NULL;
+        _c_cleanup_(c_freep) char *value = NULL;
+        char expected[1024];
+
+        assert(!c_json_transform_new(&transform));
+
+        value = nested_array(C_JSON_VALIDATE_DEPTH_MAX + 1);
+        assert(c_json_transform_add(transform, "/a", C_JSON_TRANSFORM_REPLACE, value) == C_JSON_E_DEPTH_OVERFLOW);
+        value = c_free(value);
+
+        /* replacement values are not limited by the depth of the reader */
+        value = nested_array(300);
+        assert(!c_json_transform_add(transform, "/a", C_JSON_TRANSFORM_REPLACE, value));
+
+        snprintf(expected, sizeof(expected), "{\"a\":%s}", value);
+        assert_transform(transform, "{\"a\":null}", expected);
+}
+
+static void test_rename(void) {
+        _c_cleanup_(c_json_transform_freep) CJsonTransform *transform = NULL;
+
+        assert(!c_json_transform_new(&transform));
+        assert(!c_json_transform_add(transform, "/old", C_JSON_TRANSFORM_RENAME, "new \"key\""));
+        assert(!c_json_transform_add(transform, "/old/inner", C_JSON_TRANSFORM_DROP, NULL));
+
+        assert_transform(transform,
+                         "{ \"old\" :\t{ \"inner\": 1, \"kept\": 2 } }",
+                         "{ \"new \\\"key\\\"\" :\t{ \"kept\": 2 } }");
+}
+
+int main(int argc, char **argv) {
+        test_skip();
+        test_drop();
+        test_replace();
+        test_replace_deep();
+        test_rename();
+        return 0;
+}
@@ -0,0 +1,168 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c-json.h"
+
+static int validate(const char *json, size_t max_depth, size_t *offsetp) {
+        size_t n_json = strlen(json);
+        char *copy;
+        int r;
+
+        /* no 0-terminator, so reading past the end trips the sanitizers */
+        copy = malloc(n_json ?: 1);
+        assert(copy);
+        memcpy(copy, json, n_json);
+
+        r = c_json_validate(copy, n_json, max_depth, offsetp);
+
+        free(copy);
+        return r;
+}
+
+static void assert_valid(const char *json) {
+        _c_cleanup_(c_json_reader_freep) CJsonReader *reader = NULL;
+        size_t offset;
+
+        assert(!validate(json, 256, &offset));
+        assert(offset == strlen(json));
+
+        /* the reader must agree */
+        assert(!c_json_reader_new(&reader, 256));
+        c_json_reader_begin_read(reader, json);
+        assert(!c_json_reader_skip(reader));
+        assert(!c_json_reader_end_read(reader));
+}
+
+static void assert_invalid(const char *json, int expected_r, size_t expected_offset) {
+        size_t offset;
+
+        assert(validate(json, 4, &offset) == expected_r);
+        assert(offset == expected_offset);
+}
+
+static void test_valid(void) {
+        assert_valid("null");
+        assert_valid(" true ");
+        assert_valid("false");
+        assert_valid("-0.5e+10");
+        assert_valid("\"\"");
+        assert_valid("\"foo \\u00e4\\ud834\\udd1e \xe2\x82\xac\"");
+        assert_valid("[]");
+        assert_valid("{}");
+        assert_valid("[ 1, [ 2, { \"a\": [ {} ] } ], \"x\" ]");
+        assert_valid("{ \"a\": 1, \"b\": [ null, true ], \"c\": { \"d\": \"e\" } }\n");
+}
+
+static void test_invalid(void) {
+        assert_invalid("", C_JSON_E_INVALID_JSON, 0);
+        assert_invalid("   ", C_JSON_E_INVALID_JSON, 3);
+        assert_invalid("nul", C_JSON_E_INVALID_JSON, 0);
+        assert_invalid("truex", C_JSON_E_INVALID_JSON, 4);
+        assert_invalid("1 2", C_JSON_E_INVALID_JSON, 2);
+        assert_invalid("01", C_JSON_E_INVALID_JSON, 1);
+        assert_invalid("1.", C_JSON_E_INVALID_JSON, 2);
+        assert_invalid("[1,]", C_JSON_E_INVALID_JSON, 3);
+        assert_invalid("[1 2]", C_JSON_E_INVALID_JSON, 3);
+        assert_invalid("[1}", C_JSON_E_INVALID_JSON, 2);
+        assert_invalid("{]", C_JSON_E_INVALID_JSON, 1);
+        assert_invalid("{\"a\" 1}", C_JSON_E_INVALID_JSON, 5);
+        assert_invalid("{\"a\":}", C_JSON_E_INVALID_JSON, 5);
+        assert_invalid("{\"a\":1,}", C_JSON_E_INVALID_JSON, 7);
+        assert_invalid("{1:1}", C_JSON_E_INVALID_JSON, 1);
+        assert_invalid("[\"abc", C_JSON_E_INVALID_JSON, 5);
+        assert_invalid("\"a\\u12", C_JSON_E_INVALID_JSON, 4);
+        assert_invalid("\"\\ud800\"", C_JSON_E_INVALID_JSON, 7);
+        assert_invalid("\"\\ud800\\u0041\"", C_JSON_E_INVALID_JSON, 13);
+        assert_invalid("\"\xe2\x82\"", C_JSON_E_INVALID_JSON, 1);
+        assert_invalid("\"\t\"", C_JSON_E_INVALID_JSON, 1);
+        assert_invalid("[[[[[1]]]]]", C_JSON_E_DEPTH_OVERFLOW, 4);
+        assert_invalid("{\"a\":{\"b\":{\"c\":{\"d\":{}}}}}", C_JSON_E_DEPTH_OVERFLOW, 20);
+}
+
+static void test_bounds(void) {
+        size_t offset;
+
+        /* the input ends at @n_input, not at the first 0-byte */
+        assert(!c_json_validate("[1]\0", 3, 4, &offset));
+        assert(offset == 3);
+        assert(c_json_validate("[1]\0", 4, 4, &offset) == C_JSON_E_INVALID_JSON);
+        assert(offset == 3);
+        assert(c_json_validate("[\0]", 3, 4, &offset) == C_JSON_E_INVALID_JSON);
+        assert(offset == 1);
+        assert(!c_json_validate("[1] trailing", 3, 4, NULL));
+
+        assert(!validate("[[[[1]]]]", 4, &offset));
+        assert(offset == 9);
+}
+
+static void test_depth(void) {
+        size_t depth = C_JSON_VALIDATE_DEPTH_MAX, offset;
+        _c_cleanup_(c_freep) char *json = NULL;
+
+        json = malloc(2 * depth + 1);
+        assert(json);
+        memset(json, '[', depth);
+        memset(json + depth, ']', depth);
+        json[2 * depth] = '\0';
+
+        assert(!validate(json, depth, &offset));
+        assert(offset == 2 * depth);
+        assert(validate(json, depth - 1, &offset) == C_JSON_E_DEPTH_OVERFLOW);
+        assert(offset == depth - 1);
+        assert(validate(json, depth + 1, NULL) == -EINVAL);
+}
+
+static void test_locate(void) {
+        static const char input[] = "{\n  \"a\": [1, 2],\n\n  \"b\": x\n}";
+        _c_cleanup_(c_freep) char *long_line = NULL;
+        CJsonLocation location;
+        size_t offset;
+
+        assert(validate(input, 256, &offset) == C_JSON_E_INVALID_JSON);
+        assert(input[offset] == 'x');
+
+        c_json_locate(input, strlen(input), offset, &location);
+        assert(location.line == 4);
+        assert(location.column == 8);
+        assert(location.n_context == strlen("  \"b\": x"));
+        assert(!strncmp(location.context, "  \"b\": x", location.n_context));
+        assert(location.context_offset == 7);
+
+        c_json_locate(input, strlen(input), 0, &location);
+        assert(location.line == 1 && location.column == 1);
+        assert(location.n_context == 1 && location.context_offset == 0);
+
+        /* the end of the input, and beyond */
+        c_json_locate(input, strlen(input), SIZE_MAX, &location);
+        assert(location.line == 5 && location.column == 2);
+        assert(location.n_context == 1 && location.context_offset == 1);
+
+        /* newlines are counted 8 bytes at a time, the context is cut short */
+        long_line = malloc(1001);
+        assert(long_line);
+        for (size_t i = 0; i < 1000; i += 1)
+                long_line[i] = i % 10 == 9 ? '\n' : 'a';
+        long_line[1000] = '\0';
+
+        c_json_locate(long_line, 1000, 995, &location);
+        assert(location.line == 100 && location.column == 6);
+
+        memset(long_line, 'a', 1000);
+        c_json_locate(long_line, 1000, 500, &location);
+        assert(location.line == 1 && location.column == 501);
+        assert(location.n_context == 2 * C_JSON_CONTEXT_MAX);
+        assert(location.context == long_line + 500 - C_JSON_CONTEXT_MAX);
+        assert(location.context_offset == C_JSON_CONTEXT_MAX);
+}
+
+int main(int argc, char **argv) {
+        test_valid();
+        test_invalid();
+        test_bounds();
+        test_depth();
+        test_locate();
+        return 0;
+}
@@ -0,0 +1,203 @@
+
+#undef NDEBUG
+#include <assert.h>
+#include <c-stdaux.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "c-json.h"
+
+static FILE *output;
+
+static void begin(CJsonWriter *writer) {
+        output = tmpfile();
+        assert(output);
+
+        c_json_writer_begin_write(writer, fileno(output));
+}
+
+static char * end(CJsonWriter *writer, int expected_r) {
+        char *data;
+        long n_data;
+
+        assert(c_json_writer_end_write(writer) == expected_r);
+
+        assert(!fseek(output, 0, SEEK_END));
+        n_data = ftell(output);
+        rewind(output);
+
+        data = malloc(n_data + 1);
+        assert(data);
+        assert(fread(data, 1, n_data, output) == (size_t)n_data);
+        data[n_data] = '\0';
+
+        fclose(output);
+        return data;
+}
+
+static void test_values(void) {
+        _c_cleanup_(c_json_writer_freep) CJsonWriter *writer = NULL;
+        char *data;
+
+        assert(!c_json_writer_new(&writer, 256, 0));
+
+        begin(writer);
+        assert(!c_json_writer_enter_object(writer));
+        assert(!c_json_writer_write_string(writer, "a", 1));
+        assert(!c_json_writer_enter_array(writer));
+        assert(!c_json_writer_write_null(writer));
+        assert(!c_json_writer_write_bool(writer, true));
+        assert(!c_json_writer_write_bool(writer, false));
+        assert(!c_json_writer_write_number(writer, "-1.5e3", 6));
+        assert(!c_json_writer_write_int64(writer, INT64_MIN));
+        assert(!c_json_writer_write_uint64(writer, UINT64_MAX));
+        assert(!c_json_writer_write_double(writer, 0.1));
+        assert(!c_json_writer_enter_array(writer));
+        assert(!c_json_writer_exit_array(writer));
+        assert(!c_json_writer_enter_object(writer));
+        assert(!c_json_writer_exit_object(writer));
+        assert(!c_json_writer_exit_array(writer));
+        assert(!c_json_writer_write_string(writer, "k\"", 2));
+        assert(!c_json_writer_write_string(writer, "\\\b\f\n\r\t\x01\x7f\xc3\xa4\0", 11));
+        assert(!c_json_writer_exit_object(writer));
+        data = end(writer, 0);
+
+        assert(!strcmp(data,
+                       "{\"a\":[null,true,false,-1.5e3,-9223372036854775808,18446744073709551615,0.1,[],{}],"
+                       "\"k\\\"\":\"\\\\\\b\\f\\n\\r\\t\\u0001\x7f\xc3\xa4\\u0000\"}"));
+        free(data);
+}
+
+static void test_errors(void) {
+        _c_cleanup_(c_json_writer_freep) CJsonWriter *writer = NULL;
+        char *data;
+
+        assert(!c_json_writer_new(&writer, 2, 0));
+
+        /* errors poison the writer until the end */
+        begin(writer);
+        assert(!c_json_writer_enter_object(writer));
+        assert(c_json_writer_write_null(writer) == C_JSON_E_INVALID_TYPE);
+        assert(c_json_writer_write_string(writer, "a", 1) == C_JSON_E_INVALID_TYPE);
+        free(end(writer, C_JSON_E_INVALID_TYPE));
+
+        begin(writer);
+        assert(!c_json_writer_enter_object(writer));
+        assert(!c_json_writer_write_string(writer, "a", 1));
+        assert(c_json_writer_exit_object(writer) == C_JSON_E_INVALID_JSON);
+        free(end(writer, C_JSON_E_INVALID_JSON));
+
+        begin(writer);
+        assert(!c_json_writer_enter_array(writer));
+        assert(c_json_writer_exit_object(writer) == C_JSON_E_INVALID_TYPE);
+        free(end(writer, C_JSON_E_INVALID_TYPE));
+
+        begin(writer);
+        assert(!c_json_writer_enter_array(writer));
+        assert(!c_json_writer_enter_array(writer));
+        assert(c_json_writer_enter_array(writer) == C_JSON_E_DEPTH_OVERFLOW);
+        free(end(writer, C_JSON_E_DEPTH_OVERFLOW));
+
+        begin(writer);
+        assert(!c_json_writer_write_null(writer));
+        assert(c_json_writer_write_null(writer) == C_JSON_E_INVALID_JSON);
+        free(end(writer, C_JSON_E_INVALID_JSON));
+
+        begin(writer);
+        assert(c_json_writer_write_string(writer, "\xc3", 1) == C_JSON_E_INVALID_JSON);
+        free(end(writer, C_JSON_E_INVALID_JSON));
+
+        begin(writer);
+        assert(c_json_writer_write_number(writer, "01", 2) == C_JSON_E_INVALID_JSON);
+        free(end(writer, C_JSON_E_INVALID_JSON));
+
+        begin(writer);
+        assert(c_json_writer_write_double(writer, 1.0 / 0.0) == C_JSON_E_INVALID_TYPE);
+        free(end(writer, C_JSON_E_INVALID_TYPE));
+
+        /* incomplete documents are rejected */
+        begin(writer);
+        free(end(writer, C_JSON_E_INVALID_JSON));
+
+        begin(writer);
+        assert(!c_json_writer_enter_array(writer));
+        free(end(writer, C_JSON_E_INVALID_JSON));
+
+        /* the writer is reusable after errors */
+        begin(writer);
+        assert(!c_json_writer_write_null(writer));
+        data = end(writer, 0);
+        assert(!strcmp(data, "null"));
+        free(data);
+}
+
+static void test_large(unsigned int flags) {
+        _c_cleanup_(c_json_writer_freep) CJsonWriter *writer = NULL;
+        _c_cleanup_(c_freep) char *string = NULL, *expected = NULL;
+        size_t n_string = 5000, n_strings = 300, n_expected;
+        FILE *stream;
+        char *data;
+
+        /* a long run, an escape and a short run */
+        string = malloc(n_string);
+        assert(string);
+        memset(string, 'x', n_string);
+        string[n_string - 10] = '\n';
+
+        stream = open_memstream(&expected, &n_expected);
+        assert(stream);
+        fputc('[', stream);
+        for (size_t i = 0; i < n_strings; i += 1) {
+                fprintf(stream, "%s\"%.*s\\n%.*s\"", i ? "," : "", (int)n_string - 10, string, 9, string);
+                fprintf(stream, ",%zu", i);
+        }
+        fputc(']', stream);
+        fclose(stream);
+
+        assert(!c_json_writer_new(&writer, 256, flags));
+
+        /* referenced and copied strings produce the same output */
+        for (size_t ref = 0; ref < 2; ref += 1) {
+                begin(writer);
+                assert(!c_json_writer_enter_array(writer));
+                for (size_t i = 0; i < n_strings; i += 1) {
+                        if (ref)
+                                assert(!c_json_writer_write_string_ref(writer, string, n_string));
+                        else
+                                assert(!c_json_writer_write_string(writer, string, n_string));
+                        assert(!c_json_writer_write_uint64(writer, i));
+                }
+                assert(!c_json_writer_exit_array(writer));
+                data = end(writer, 0);
+
+                assert(strlen(data) == n_expected);
+                assert(!strcmp(data, expected));
+                free(data);
+        }
+}
+
+static void test_write_error(unsigned int flags) {
+        _c_cleanup_(c_json_writer_freep) CJsonWriter *writer = NULL;
+        int fds[2];
+
+        assert(!c_json_writer_new(&writer, 256, flags));
+        assert(!pipe(fds));
+
+        /* output is only written on flush, errors are reported then */
+        c_json_writer_begin_write(writer, fds[1]);
+        assert(!c_json_writer_write_null(writer));
+        close(fds[1]);
+        assert(c_json_writer_end_write(writer) == -EBADF);
+
+        close(fds[0]);
+}
+
+int main(int argc, char **argv) {
+        test_values();
+        test_errors();
+        test_large(0);
+        test_large(C_JSON_WRITER_ASYNC);
+        test_write_error(0);
+        test_write_error(C_JSON_WRITER_ASYNC);
+        return 0;
+}